@@ -11,9 +11,11 @@
 namespace ddwaf{
 class waf;
 class context;
+class live_handle;
 } // namespace ddwaf
 using ddwaf_handle = ddwaf::waf *;
 using ddwaf_context = ddwaf::context *;
+using ddwaf_live_handle = ddwaf::live_handle *;
 
 extern "C"
 {
@@ -79,13 +81,28 @@ typedef enum
     DDWAF_LOG_OFF,
 } DDWAF_LOG_LEVEL;
 
+/**
+ * @enum DDWAF_TRACE_PHASE
+ *
+ * Phases of an evaluation reported to the trace hooks.
+ **/
+typedef enum
+{
+    DDWAF_TRACE_RULE_FILTERS,
+    DDWAF_TRACE_INPUT_FILTERS,
+    DDWAF_TRACE_COLLECTION,
+    DDWAF_TRACE_SERIALIZATION,
+} DDWAF_TRACE_PHASE;
+
 #ifndef __cplusplus
 typedef struct _ddwaf_handle* ddwaf_handle;
 typedef struct _ddwaf_context* ddwaf_context;
+typedef struct _ddwaf_live_handle* ddwaf_live_handle;
 #endif
 
 typedef struct _ddwaf_object ddwaf_object;
 typedef struct _ddwaf_config ddwaf_config;
+typedef struct _ddwaf_config_ext ddwaf_config_ext;
 typedef struct _ddwaf_result ddwaf_result;
 typedef struct _ddwaf_ruleset_info ddwaf_ruleset_info;
 /**
@@ -147,6 +164,45 @@ struct _ddwaf_config
     ddwaf_object_free_fn free_fn; 
 };
 
+/**
+ * @struct ddwaf_config_ext
+ *
+ * Extended configuration of the WAF, provided through ddwaf_init_ext. The
+ * structure is versioned through its size, new members are only ever appended
+ * and any member beyond the size provided by the caller is treated as zero.
+ **/
+struct _ddwaf_config_ext
+{
+    /** Size of the structure known to the caller, must be initialised to
+     *  sizeof(ddwaf_config_ext). */
+    uint32_t size;
+
+    /** Internal worker threads used by the WAF */
+    struct _ddwaf_config_threads {
+        /** Number of threads used to compile the ruleset during ddwaf_init
+         *  and ddwaf_update, a value lower than 2 disables parallel
+         *  compilation. */
+        uint32_t compile;
+        /** Number of threads used to evaluate contexts in ddwaf_run_batch, a
+         *  value lower than 2 evaluates all contexts on the calling thread. */
+        uint32_t run;
+        /** Evaluate the rule collections of a single ddwaf_run in parallel
+         *  using the run threads, only priority collections are evaluated
+         *  sequentially. Useful when processing large payloads. */
+        bool parallel_match;
+    } threads;
+
+    /** Execution profiling, see ddwaf_get_metrics and ddwaf_get_histograms */
+    struct _ddwaf_config_profiling {
+        /** Collect per-rule, per-condition and per-processor metrics on every
+         *  evaluation, this has a small but measurable runtime cost. */
+        bool enabled;
+        /** Collect latency and input size histograms shared by all contexts
+         *  of the handle, this has a small runtime cost on every call. */
+        bool histograms;
+    } profiling;
+};
+
 /**
  * @struct ddwaf_result
  *
@@ -201,6 +257,59 @@ typedef void (*ddwaf_log_cb)(
     DDWAF_LOG_LEVEL level, const char* function, const char* file, unsigned line,
     const char* message, uint64_t message_len);
 
+/**
+ * @typedef ddwaf_trace_cb
+ *
+ * Callback invoked at the boundaries of each phase of an evaluation.
+ *
+ * @param user_data The user data provided alongside the hooks.
+ * @param phase The phase being evaluated.
+ * @param name The name of the collection for DDWAF_TRACE_COLLECTION, NULL
+ *             otherwise.
+ * @param timestamp_ns Monotonic timestamp of the boundary in nanoseconds.
+ */
+typedef void (*ddwaf_trace_cb)(
+    void *user_data, DDWAF_TRACE_PHASE phase, const char *name, uint64_t timestamp_ns);
+
+/**
+ * @struct ddwaf_trace_hooks
+ *
+ * Callbacks invoked at the start and end of each phase, either can be NULL.
+ **/
+typedef struct _ddwaf_trace_hooks
+{
+    void *user_data;
+    ddwaf_trace_cb begin;
+    ddwaf_trace_cb end;
+} ddwaf_trace_hooks;
+
+/**
+ * @typedef ddwaf_run_cb
+ *
+ * Callback invoked once an asynchronous run has completed.
+ *
+ * @param code Return code of the operation, as returned by ddwaf_run.
+ * @param result Result of the operation, owned by the WAF and only valid until
+ *               the callback returns. (nonnull)
+ * @param user_data Opaque pointer provided to ddwaf_run_async. (nullable)
+ */
+typedef void (*ddwaf_run_cb)(DDWAF_RET_CODE code, const ddwaf_result *result, void *user_data);
+
+/**
+ * @typedef ddwaf_provider_cb
+ *
+ * Callback used to lazily generate the value of an address.
+ *
+ * @param object Object to initialise with the value of the address, its
+ *               ownership is transferred to the context. (nonnull)
+ * @param user_data Opaque pointer provided to ddwaf_context_provide. (nullable)
+ *
+ * @return Whether the object has been initialised, if false the object must
+ *         not contain any allocated memory and the address is considered
+ *         unavailable.
+ */
+typedef bool (*ddwaf_provider_cb)(ddwaf_object *object, void *user_data);
+
 /**
  * ddwaf_init
  *
@@ -218,6 +327,80 @@ typedef void (*ddwaf_log_cb)(
 ddwaf_handle ddwaf_init(const ddwaf_object *ruleset,
     const ddwaf_config* config, ddwaf_ruleset_info *info);
 
+/**
+ * ddwaf_init_ext
+ *
+ * Initialize a ddwaf instance with an extended configuration.
+ *
+ * @param rule ddwaf::object map containing rules, exclusions, rules_override and rules_data. (nonnull)
+ * @param config Optional configuration of the WAF. (nullable)
+ * @param ext Optional extended configuration of the WAF. (nullable)
+ * @param info Optional ruleset parsing diagnostics. (nullable)
+ *
+ * @return Handle to the WAF instance or NULL on error.
+ *
+ * @note Same as ddwaf_init when ext is NULL.
+ **/
+ddwaf_handle ddwaf_init_ext(const ddwaf_object *ruleset, const ddwaf_config *config,
+    const ddwaf_config_ext *ext, ddwaf_ruleset_info *info);
+
+/**
+ * ddwaf_init_from_snapshot
+ *
+ * Initialize a ddwaf instance from a ruleset snapshot generated through
+ * ddwaf_ruleset_serialize.
+ *
+ * @param buffer Buffer containing the snapshot, e.g. a memory-mapped file. (nonnull)
+ * @param size Size of the buffer in bytes.
+ * @param config Optional configuration of the WAF. (nullable)
+ * @param info Optional ruleset parsing diagnostics. (nullable)
+ *
+ * @return Handle to the WAF instance or NULL on error.
+ *
+ * @note The buffer is only required for the duration of the call.
+ * @note The snapshot only contains the ruleset object, it saves the decoding
+ *       of the original ruleset format but the rules are still parsed and
+ *       compiled as with ddwaf_init.
+ **/
+ddwaf_handle ddwaf_init_from_snapshot(const void *buffer, size_t size,
+    const ddwaf_config* config, ddwaf_ruleset_info *info);
+
+/**
+ * ddwaf_init_from_file
+ *
+ * Initialize a ddwaf instance from a file containing either a JSON ruleset or
+ * a ruleset snapshot generated through ddwaf_ruleset_serialize.
+ *
+ * @param path Path to the ruleset file. (nonnull)
+ * @param config Optional configuration of the WAF. (nullable)
+ * @param info Optional ruleset parsing diagnostics. (nullable)
+ *
+ * @return Handle to the WAF instance or NULL on error.
+ *
+ * @note The file is memory-mapped and parsed in place where supported, the
+ *       file itself is never modified.
+ **/
+ddwaf_handle ddwaf_init_from_file(const char *path,
+    const ddwaf_config* config, ddwaf_ruleset_info *info);
+
+/**
+ * ddwaf_ruleset_serialize
+ *
+ * Serialize a ruleset object into a versioned binary snapshot which can be
+ * loaded through ddwaf_init_from_snapshot. Parsed rules and compiled
+ * processors are not part of the snapshot.
+ *
+ * @param ruleset ddwaf::object map containing the ruleset. (nonnull)
+ * @param buffer Buffer in which to write the snapshot. (nullable)
+ * @param size Size of the buffer in bytes.
+ *
+ * @return Size of the snapshot in bytes or 0 if the ruleset is invalid.
+ *
+ * @note If the buffer is NULL or smaller than the size of the snapshot, nothing
+ *       is written and the required size is returned.
+ **/
+size_t ddwaf_ruleset_serialize(const ddwaf_object *ruleset, void *buffer, size_t size);
+
 /**
  * ddwaf_update
  *
@@ -249,6 +432,64 @@ void ddwaf_destroy(ddwaf_handle handle);
  * @param info Ruleset info to free.
  * */
 void ddwaf_ruleset_info_free(ddwaf_ruleset_info *info);
+/**
+ * ddwaf_live_init
+ *
+ * Initialize a live WAF instance, which can be updated in place while other
+ * threads concurrently create contexts from it.
+ *
+ * @param rule ddwaf::object map containing rules, exclusions, rules_override and rules_data. (nonnull)
+ * @param config Optional configuration of the WAF. (nullable)
+ * @param info Optional ruleset parsing diagnostics. (nullable)
+ *
+ * @return Handle to the live WAF instance or NULL on error.
+ **/
+ddwaf_live_handle ddwaf_live_init(const ddwaf_object *ruleset,
+    const ddwaf_config* config, ddwaf_ruleset_info *info);
+
+/**
+ * ddwaf_live_update
+ *
+ * Update a live WAF instance, the new ruleset is atomically published and
+ * used by all subsequent calls to ddwaf_live_context_init. Contexts created
+ * before the update keep using the previous ruleset, which is released once
+ * all of them have been destroyed.
+ *
+ * @param handle Handle to the live WAF instance. (nonnull)
+ * @param rule ddwaf::object map containing rules, exclusions, rules_override and rules_data. (nonnull)
+ * @param info Optional ruleset parsing diagnostics. (nullable)
+ *
+ * @return Whether the update resulted in a new ruleset.
+ *
+ * @note Concurrent updates are serialised, this function blocks until no
+ *       thread can be using the previous instance.
+ **/
+bool ddwaf_live_update(ddwaf_live_handle handle, const ddwaf_object *ruleset,
+    ddwaf_ruleset_info *info);
+
+/**
+ * ddwaf_live_context_init
+ *
+ * Create a context using the latest ruleset published on the live WAF
+ * instance, this function never blocks on ddwaf_live_update.
+ *
+ * @param handle Handle to the live WAF instance. (nonnull)
+ *
+ * @return Handle to the context instance, to be destroyed with ddwaf_context_destroy.
+ **/
+ddwaf_context ddwaf_live_context_init(ddwaf_live_handle handle);
+
+/**
+ * ddwaf_live_destroy
+ *
+ * Destroy a live WAF instance, contexts created from it remain valid.
+ *
+ * @param handle Handle to the live WAF instance.
+ *
+ * @note No other thread should be using the handle at this point.
+ **/
+void ddwaf_live_destroy(ddwaf_live_handle handle);
+
 /**
  * ddwaf_required_addresses
  *
@@ -262,6 +503,116 @@ void ddwaf_ruleset_info_free(ddwaf_ruleset_info *info);
  **/
 const char* const* ddwaf_required_addresses(const ddwaf_handle handle, uint32_t *size);
 
+/**
+ * ddwaf_required_key_paths
+ *
+ * Get the subset of each address referenced by the ruleset, allowing callers
+ * to only generate the parts of an address which will be evaluated. The output
+ * is a map of the form:
+ *
+ *   {address: {full: bool, key_paths: [[key, ...], ...]}}
+ *
+ * If full is true, the whole address is required and key_paths is empty,
+ * otherwise only the values found under each of the key paths are required.
+ *
+ * @param handle Handle to the WAF instance. (nonnull)
+ * @param output Object in which the map will be stored, it must be freed by the
+ *               caller using ddwaf_object_free. (nonnull)
+ *
+ * @return Whether the output has been generated.
+ **/
+bool ddwaf_required_key_paths(const ddwaf_handle handle, ddwaf_object *output);
+
+/**
+ * ddwaf_get_metrics
+ *
+ * Get the execution metrics collected by every context created from the handle,
+ * only available when profiling has been enabled through ddwaf_config. The
+ * output is a map of the form:
+ *
+ *   {
+ *     rules: {id: {calls, total_ns, max_ns, strings, bytes, matches,
+ *                  conditions: [...]}},
+ *     processors: {name: {calls, total_ns, max_ns, strings, bytes, matches}}
+ *   }
+ *
+ * Each condition contains the same counters as a rule, along with the name of
+ * its processor, conditions are listed in the order in which they're defined
+ * in the ruleset. Strings refers to the number of strings inspected, bytes to
+ * the number of bytes transformed before being inspected and matches to the
+ * number of evaluations resulting in a match.
+ *
+ * @param handle Handle to the WAF instance. (nonnull)
+ * @param output Object in which the metrics will be stored, it must be freed
+ *               by the caller using ddwaf_object_free. (nonnull)
+ *
+ * @return Whether the output has been generated.
+ **/
+bool ddwaf_get_metrics(const ddwaf_handle handle, ddwaf_object *output);
+
+/**
+ * ddwaf_get_histograms
+ *
+ * Get the latency and input size histograms of every context created from the
+ * handle since its creation or the last call to ddwaf_reset_histograms. The
+ * output is a map of the form:
+ *
+ *   {
+ *     run: {count, sum, max, p50, p90, p99, p999},
+ *     rule_filters: {...},
+ *     input_filters: {...},
+ *     collections: {...},
+ *     serialization: {...},
+ *     input_size: {...}
+ *   }
+ *
+ * Durations are in nanoseconds, run refers to the wall time of each call to
+ * ddwaf_run while the remaining durations refer to each of its phases. The
+ * input size is the number of objects provided on each call, counting the
+ * root map, its entries and their immediate children. Quantiles have a
+ * relative error of at most 6.25%.
+ *
+ * @param handle Handle to the WAF instance. (nonnull)
+ * @param output Object in which the histograms will be stored, it must be
+ *               freed by the caller using ddwaf_object_free. (nonnull)
+ *
+ * @return Whether the output has been generated, false if the handle wasn't
+ *         initialised with profiling.histograms enabled.
+ **/
+bool ddwaf_get_histograms(const ddwaf_handle handle, ddwaf_object *output);
+
+/**
+ * ddwaf_reset_histograms
+ *
+ * Reset all the histograms of the handle, see ddwaf_get_histograms.
+ *
+ * @param handle Handle to the WAF instance.
+ **/
+void ddwaf_reset_histograms(ddwaf_handle handle);
+
+/**
+ * ddwaf_set_trace_hooks
+ *
+ * Registers the hooks invoked at the boundaries of the rule filters, input
+ * filters, each collection and serialization phases of every call to ddwaf_run
+ * on contexts created from the handle, or from handles derived from it through
+ * ddwaf_update. Hooks are invoked on the thread performing the evaluation,
+ * which might be a worker thread when collections are evaluated in parallel.
+ *
+ * On Linux, the same boundaries are exposed as the USDT probes
+ * libddwaf:phase_begin and libddwaf:phase_end when available at build time.
+ *
+ * @param handle Handle to the WAF instance. (nonnull)
+ * @param hooks Hooks to register, copied by the WAF, or NULL to unregister.
+ *
+ * @return Whether the hooks have been registered.
+ *
+ * @note Hooks only apply to contexts created after the call, this function
+ *       must not be called concurrently with ddwaf_context_init on the same
+ *       handle.
+ **/
+bool ddwaf_set_trace_hooks(ddwaf_handle handle, const ddwaf_trace_hooks *hooks);
+
 /**
  * ddwaf_context_init
  *
@@ -309,6 +660,181 @@ ddwaf_context ddwaf_context_init(const ddwaf_handle handle);
 DDWAF_RET_CODE ddwaf_run(ddwaf_context context, ddwaf_object *data,
                          ddwaf_result *result,  uint64_t timeout);
 
+/**
+ * ddwaf_run_batch
+ *
+ * Perform a matching operation on each of the provided contexts, equivalent to
+ * calling ddwaf_run(contexts[i], data[i], &results[i], timeout) for every i in
+ * [0, count). When the WAF instance of the first context has been configured
+ * with more than one run thread, the contexts are evaluated in parallel.
+ *
+ * @param contexts Array of count WAF contexts, each context must appear only
+ *                 once in the array. (nonnull)
+ * @param data Array of count objects, the ownership of each object follows the
+ *             same semantics as ddwaf_run. (nonnull)
+ * @param results Array of count result structures. (nullable)
+ * @param count Number of elements in each of the arrays.
+ * @param timeout Maximum time budget in microseconds, applied to each context
+ *                individually.
+ *
+ * @return DDWAF_MATCH if any of the contexts matched, DDWAF_OK otherwise. If
+ *         one or more of the individual runs failed, the most severe error
+ *         code is returned instead, the remaining contexts are still evaluated.
+ * @error DDWAF_ERR_INVALID_ARGUMENT The arrays provided were null, or one of
+ *                                   the contexts or objects was null.
+ **/
+DDWAF_RET_CODE ddwaf_run_batch(ddwaf_context *contexts, ddwaf_object **data,
+                               ddwaf_result *results, size_t count, uint64_t timeout);
+
+/**
+ * ddwaf_run_chunk
+ *
+ * Perform a matching operation on a chunk of a string address, allowing large
+ * values such as request bodies to be evaluated as they are received, without
+ * buffering nor truncation. Each chunk is evaluated together with the last
+ * bytes of the previous chunk of the same address (up to 1024 bytes, or half of
+ * the maximum string length if lower), so that matches spanning consecutive
+ * chunks are still detected as long as they fit within that overlap. Chunks
+ * longer than the maximum string length are split internally.
+ *
+ * Since each chunk is evaluated independently, operators which require the
+ * complete value, such as exact matches, only apply to individual chunks.
+ *
+ * @param context WAF context to be used in this run. (nonnull)
+ * @param address NUL-terminated address name. (nonnull)
+ * @param chunk Chunk of the address value, the chunk is copied and remains owned
+ *              by the caller. The copy is retained by the context until it is
+ *              destroyed. (nullable if length is 0)
+ * @param length Length of the chunk.
+ * @param last Whether this is the last chunk of the value, after which the next
+ *             chunk provided for the same address starts a new value.
+ * @param result Structure containing the result of the operation. (nullable)
+ * @param timeout Maximum time budget in microseconds.
+ *
+ * @return Return code of the operation, with the same semantics as ddwaf_run.
+ * @error DDWAF_ERR_INVALID_ARGUMENT The context, address or chunk were null.
+ * @error DDWAF_ERR_INTERNAL There was an unexpected error and the operation did
+ *                           not succeed.
+ **/
+DDWAF_RET_CODE ddwaf_run_chunk(ddwaf_context context, const char *address, const char *chunk,
+                               size_t length, bool last, ddwaf_result *result, uint64_t timeout);
+
+/**
+ * ddwaf_run_async
+ *
+ * Schedule a matching operation on the provided data and return immediately,
+ * the operation is performed on the run threads of the WAF instance. If none
+ * have been configured, or the WAF instance has already been destroyed, the
+ * operation is performed on the calling thread and the callback is invoked
+ * before returning.
+ *
+ * Destroying the WAF instance waits for all pending operations, which means
+ * the WAF instance must not be destroyed from within the callback. The context
+ * itself can be destroyed from within the callback.
+ *
+ * @param context WAF context to be used in this run. The context must not be
+ *                used nor destroyed until the callback has been invoked. (nonnull)
+ * @param data Data on which to perform the pattern matching. The ownership of
+ *             the data is transferred to the context once scheduled and follows
+ *             the same semantics as ddwaf_run from then on, the data must not
+ *             be modified by the caller until the callback has been invoked.
+ *             (nonnull)
+ * @param timeout Maximum time budget in microseconds, the time spent waiting
+ *                for a worker thread isn't accounted for.
+ * @param callback Function invoked on the worker thread with the outcome of
+ *                 the operation. (nonnull)
+ * @param user_data Opaque pointer passed to the callback. (nullable)
+ *
+ * @return DDWAF_OK if the operation has been scheduled, in which case the
+ *         callback will be invoked exactly once.
+ * @error DDWAF_ERR_INVALID_ARGUMENT The context, data or callback was null, the
+ *                                   data will not be freed and the callback
+ *                                   will not be invoked.
+ * @error DDWAF_ERR_INTERNAL The operation couldn't be scheduled, the data will
+ *                           not be freed and the callback will not be invoked.
+ **/
+DDWAF_RET_CODE ddwaf_run_async(ddwaf_context context, ddwaf_object *data, uint64_t timeout,
+                               ddwaf_run_cb callback, void *user_data);
+
+/**
+ * ddwaf_context_provide
+ *
+ * Register a provider for an address, which will only be invoked if and when
+ * the value of the address is required by the evaluation. The address is
+ * treated as new data on the next call to ddwaf_run, just as if it had been
+ * part of the data provided. Registering a provider replaces any value
+ * previously available for the address and vice versa.
+ *
+ * @param context Context on which to register the provider. (nonnull)
+ * @param address NUL-terminated address name. (nonnull)
+ * @param provider Function generating the value of the address, it may be
+ *                 invoked from any of the threads evaluating the context. The
+ *                 object generated will be freed by the context using the
+ *                 free function provided in the configuration. (nonnull)
+ * @param user_data Opaque pointer passed to the provider, it must remain valid
+ *                  until the context is destroyed. (nullable)
+ *
+ * @return Whether the provider has been registered, false if the arguments are
+ *         invalid or if no rule requires the address.
+ **/
+bool ddwaf_context_provide(ddwaf_context context, const char *address,
+                           ddwaf_provider_cb provider, void *user_data);
+
+/**
+ * ddwaf_context_provide_raw
+ *
+ * Register the raw, unparsed, value of an address along with its content type.
+ * The value is only parsed if and when the address is required by the
+ * evaluation, in which case only the key paths referenced by the ruleset are
+ * generated, within the limits provided in the configuration. As with
+ * ddwaf_context_provide, the address is treated as new data on the next call
+ * to ddwaf_run.
+ *
+ * Supported content types are JSON (application/json, text/json and any type
+ * with the +json suffix) and forms (application/x-www-form-urlencoded). If
+ * the value can't be parsed, the address is considered unavailable.
+ *
+ * @param context Context on which to register the value. (nonnull)
+ * @param address NUL-terminated address name. (nonnull)
+ * @param raw Raw value, which is copied by the context. (nullable if length is 0)
+ * @param length Length of the raw value.
+ * @param content_type NUL-terminated content type, including any parameters
+ *                     such as the charset. (nonnull)
+ *
+ * @return Whether the value has been registered, false if the arguments are
+ *         invalid, the content type is unsupported or no rule requires the
+ *         address.
+ **/
+bool ddwaf_context_provide_raw(ddwaf_context context, const char *address, const char *raw,
+                               size_t length, const char *content_type);
+
+/**
+ * ddwaf_context_diagnostics
+ *
+ * Generates the diagnostics of the last call to ddwaf_run, ddwaf_run_chunk or
+ * ddwaf_run_async on the context, which are only available if the call timed
+ * out or skipped rules. It consists of a map of the form:
+ *
+ *   {phase, rule|filter, condition, address, rules_completed, rules_total,
+ *    skipped_rules}
+ *
+ * Where phase is one of rule_filters, input_filters or collections, and
+ * condition refers to the index of the condition within the rule. Each field
+ * is only present when known. Skipped rules is an array with the ids of the
+ * rules without actions which weren't evaluated, as their estimated cost
+ * exceeded the remaining time.
+ *
+ * This function must not be called while a run is in progress on the context,
+ * other than from the callback of ddwaf_run_async.
+ *
+ * @param context Context on which the run was performed. (nonnull)
+ * @param output Object in which the diagnostics will be generated, which must
+ *               be freed by the caller using ddwaf_object_free. (nonnull)
+ *
+ * @return Whether diagnostics were available, otherwise output is invalid.
+ **/
+bool ddwaf_context_diagnostics(ddwaf_context context, ddwaf_object *output);
+
 /**
  * ddwaf_context_destroy
  *
@@ -657,6 +1183,35 @@ const char *ddwaf_get_version();
  **/
 bool ddwaf_set_log_cb(ddwaf_log_cb cb, DDWAF_LOG_LEVEL min_level);
 
+/**
+ * ddwaf_set_log_deferred
+ *
+ * Enables or disables deferred logging. In deferred mode, log messages aren't
+ * formatted nor relayed to the callback when emitted, instead their format and
+ * arguments are stored in a per-thread buffer until ddwaf_log_drain is called.
+ * Messages emitted while a buffer is full are dropped and reported on drain.
+ *
+ * Disabling deferred logging drains any pending messages.
+ *
+ * @param deferred Whether to defer log messages or relay them immediately
+ *
+ * @return whether the operation succeeded or not
+ **/
+bool ddwaf_set_log_deferred(bool deferred);
+
+/**
+ * ddwaf_log_drain
+ *
+ * Formats and relays the log messages pending in deferred mode to the callback
+ * provided through ddwaf_set_log_cb. This function can be called from any
+ * thread, messages emitted by the same thread are relayed in order.
+ *
+ * @param max_messages The maximum number of messages to relay, or 0 for all
+ *
+ * @return the number of messages relayed
+ **/
+size_t ddwaf_log_drain(size_t max_messages);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
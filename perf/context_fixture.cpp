@@ -0,0 +1,43 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog
+// (https://www.datadoghq.com/). Copyright 2022 Datadog, Inc.
+
+#include <memory>
+#include <stdexcept>
+
+#include <context.hpp>
+#include <waf.hpp>
+
+#include "context_fixture.hpp"
+
+namespace ddwaf::benchmark {
+
+context_fixture::context_fixture(ddwaf_handle handle, bool shared_ptr) : handle_(handle)
+{
+    if (shared_ptr) {
+        ruleset_ = handle->get_ruleset();
+    }
+}
+
+uint64_t context_fixture::test_main()
+{
+    auto start = monotonic_clock::now();
+
+    if (ruleset_) {
+        auto ctx = std::make_unique<ddwaf::context>(ruleset_);
+        ctx.reset();
+    } else {
+        ddwaf_context ctx = ddwaf_context_init(handle_);
+        if (ctx == nullptr) {
+            throw std::runtime_error("Failed to initialise context");
+        }
+        ddwaf_context_destroy(ctx);
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(monotonic_clock::now() - start)
+        .count();
+}
+
+} // namespace ddwaf::benchmark
@@ -0,0 +1,37 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog
+// (https://www.datadoghq.com/). Copyright 2022 Datadog, Inc.
+
+#pragma once
+
+#include <ddwaf.h>
+#include <ruleset.hpp>
+
+#include "fixture_base.hpp"
+
+namespace ddwaf::benchmark {
+
+// Measures the creation and destruction of a context, either through the
+// interface or by sharing the ruleset of the handle through a plain shared
+// pointer, which is used as a baseline for the former.
+class context_fixture : public fixture_base {
+public:
+    explicit context_fixture(ddwaf_handle handle, bool shared_ptr = false);
+    ~context_fixture() override = default;
+
+    context_fixture(const context_fixture &) = delete;
+    context_fixture &operator=(const context_fixture &) = delete;
+
+    context_fixture(context_fixture &&) = delete;
+    context_fixture &operator=(context_fixture &&) = delete;
+
+    uint64_t test_main() override;
+
+protected:
+    ddwaf_handle handle_{nullptr};
+    std::shared_ptr<ruleset> ruleset_;
+};
+
+} // namespace ddwaf::benchmark
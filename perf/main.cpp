@@ -19,6 +19,7 @@
 #include <clock.hpp>
 #include <ddwaf.h>
 
+#include "context_fixture.hpp"
 #include "object_generator.hpp"
 #include "output_formatter.hpp"
 #include "random.hpp"
@@ -57,7 +58,9 @@ void print_help_and_exit(std::string_view name, std::string_view error = {})
               << "    --max-objects VALUE   Maximum number of objects to cache per "
                  "test\n"
               << "    --raw                 Include all samples in output (only "
-                 "works with --format=json\n";
+                 "works with --format=json\n"
+              << "    --scaling             Measure context creation and destruction on 1 "
+                 "to --threads threads, compared with plain shared pointers\n";
     // " "
 
     if (!error.empty()) {
@@ -175,6 +178,10 @@ benchmark::settings generate_settings(int argc, char *argv[])
         }
     }
 
+    if (contains(opts, "scaling")) {
+        s.scaling = true;
+    }
+
     if (contains(opts, "raw")) {
         if (s.format != benchmark::output_fmt::json) {
             print_help_and_exit(argv[0], "Raw only works with json format");
@@ -253,9 +260,17 @@ int main(int argc, char *argv[])
     }
 
     benchmark::runner runner(s);
-    initialise_runner(runner, handle, s);
 
-    auto results = runner.run();
+    std::map<std::string_view, benchmark::runner::test_result> results;
+    if (s.scaling) {
+        results = runner.run_scaling("context.init_destroy",
+            [handle]() { return std::make_unique<benchmark::context_fixture>(handle); });
+        results.merge(runner.run_scaling("context.init_destroy_shared_ptr",
+            [handle]() { return std::make_unique<benchmark::context_fixture>(handle, true); }));
+    } else {
+        initialise_runner(runner, handle, s);
+        results = runner.run();
+    }
 
     benchmark::output_results(s, results);
 
@@ -34,6 +34,19 @@ double standard_deviation(const std::vector<uint64_t> &values, double average)
     return sqrt(sd / values.size());
 }
 
+runner::test_result summarise(std::vector<uint64_t> &times, bool store_samples)
+{
+    double average = 0.0;
+    for (auto t : times) { average += t; }
+    average /= times.size();
+
+    auto samples = store_samples ? times : std::vector<uint64_t>();
+    std::sort(times.begin(), times.end());
+    return {average, percentile(times, 0), percentile(times, 50), percentile(times, 75),
+        percentile(times, 90), percentile(times, 95), percentile(times, 99),
+        percentile(times, 100), standard_deviation(times, average), std::move(samples)};
+}
+
 } // namespace
 
 std::map<std::string_view, runner::test_result> runner::run()
@@ -140,5 +153,55 @@ std::map<std::string_view, runner::test_result> runner::run_mt()
 
     return results;
 }
+
+std::map<std::string_view, runner::test_result> runner::run_scaling(
+    const std::string &name, const std::function<std::unique_ptr<fixture_base>()> &factory)
+{
+    std::map<std::string_view, test_result> results;
+
+    unsigned max_threads = std::max(threads_, 1U);
+    for (unsigned count = 1; count <= max_threads;) {
+        std::vector<std::unique_ptr<fixture_base>> fixtures;
+        std::vector<std::vector<uint64_t>> times(count, std::vector<uint64_t>(iterations_));
+        for (unsigned i = 0; i < count; i++) { fixtures.emplace_back(factory()); }
+
+        // All threads start at the same time to maximise contention
+        std::atomic<bool> start{false};
+        std::vector<std::thread> tid;
+        for (unsigned i = 0; i < count; i++) {
+            tid.emplace_back([&, i]() {
+                while (!start) { std::this_thread::yield(); }
+
+                auto &f = fixtures[i];
+                for (std::size_t j = 0; j < iterations_; j++) {
+                    if (!f->set_up()) {
+                        std::cerr << "Failed to initialise iteration " << j << " for fixture "
+                                  << name << std::endl;
+                        break;
+                    }
+                    times[i][j] = f->test_main();
+                    f->tear_down();
+                }
+            });
+        }
+
+        start = true;
+        for (auto &t : tid) { t.join(); }
+
+        std::vector<uint64_t> all_times;
+        all_times.reserve(static_cast<std::size_t>(count) * iterations_);
+        for (auto &t : times) { all_times.insert(all_times.end(), t.begin(), t.end()); }
+
+        const auto &test_name =
+            scaling_names_.emplace_back(name + ".threads_" + std::to_string(count));
+        results.emplace(test_name, summarise(all_times, store_samples));
+
+        // Powers of two, always including the maximum number of threads
+        count = (count < max_threads && count * 2 > max_threads) ? max_threads : count * 2;
+    }
+
+    return results;
+}
+
 // NOLINTEND(*-narrowing-conversions,*-magic-numbers)
 } // namespace ddwaf::benchmark
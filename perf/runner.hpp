@@ -7,6 +7,7 @@
 #pragma once
 
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <utility>
@@ -36,6 +37,11 @@ public:
 
     std::map<std::string_view, test_result> run();
 
+    // Runs the same test concurrently on an increasing number of threads, up
+    // to the configured number, using one fixture per thread.
+    std::map<std::string_view, test_result> run_scaling(
+        const std::string &name, const std::function<std::unique_ptr<fixture_base>()> &factory);
+
 protected:
     std::map<std::string_view, test_result> run_st();
     std::map<std::string_view, test_result> run_mt();
@@ -44,6 +50,7 @@ protected:
     unsigned threads_;
     bool store_samples;
     std::unordered_map<std::string, std::unique_ptr<fixture_base>> tests_;
+    std::list<std::string> scaling_names_;
 };
 
 } // namespace ddwaf::benchmark
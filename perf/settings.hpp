@@ -27,6 +27,7 @@ struct settings {
     unsigned threads{0};
     unsigned max_objects{100};
     bool store_samples{false};
+    bool scaling{false};
 };
 
 } // namespace ddwaf::benchmark
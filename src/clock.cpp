@@ -6,6 +6,13 @@
 
 #include "clock.hpp"
 
+#include <algorithm>
+#include <limits>
+
+#if DDWAF_HAS_TSC && !defined(_MSC_VER)
+#  include <cpuid.h>
+#endif
+
 #ifdef __linux__
 
 #  include <system_error>
@@ -73,3 +80,142 @@ static const VdsoInitializer vdso_initializer;
 
 } // namespace ddwaf
 #endif
+
+namespace ddwaf {
+
+namespace {
+
+#if DDWAF_HAS_TSC
+bool invariant_tsc()
+{
+    // CPUID.80000007H:EDX[8] indicates that the TSC rate is constant across
+    // frequency and power state changes.
+#  ifdef _MSC_VER
+    int regs[4] = {0};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007U) {
+        return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return (static_cast<unsigned>(regs[3]) & (1U << 8)) != 0;
+#  else
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+    return (edx & (1U << 8)) != 0;
+#  endif
+}
+#endif
+
+} // namespace
+
+bool deadline_clock::calibrate() noexcept
+{
+#if DDWAF_HAS_TSC
+    if (!invariant_tsc()) {
+        return false;
+    }
+
+    // The window is short as this delays the creation of the first instance,
+    // the relative error is still well below what's relevant for deadlines.
+    constexpr std::chrono::microseconds window{200};
+    constexpr unsigned max_iterations = 1000000;
+
+    const auto start = monotonic_clock::now();
+    const uint64_t start_ticks = __rdtsc();
+
+    auto end = start;
+    uint64_t end_ticks = start_ticks;
+    for (unsigned i = 0; i < max_iterations && end - start < window; ++i) {
+        end = monotonic_clock::now();
+        end_ticks = __rdtsc();
+    }
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (ns < window.count() * 1000 || end_ticks <= start_ticks) {
+        return false;
+    }
+
+    // Anything outside of [100MHz, 10GHz] is likely the result of a broken
+    // or virtualised counter
+    auto ratio = static_cast<double>(end_ticks - start_ticks) / static_cast<double>(ns);
+    if (ratio < 0.1 || ratio > 10.0) {
+        return false;
+    }
+
+    ticks_per_ns = ratio;
+    return true;
+#else
+    return false;
+#endif
+}
+
+double deadline_clock::ticks_per_ns = 1.0;
+std::atomic<bool> deadline_clock::tsc_enabled{false};
+
+void deadline_clock::initialise() noexcept
+{
+    // The frequency is published by enabling the timestamp counter
+    [[maybe_unused]] static const bool calibrated = [] {
+        if (!calibrate()) {
+            return false;
+        }
+        tsc_enabled.store(true, std::memory_order_release);
+        return true;
+    }();
+}
+
+uint64_t deadline_clock::to_ticks(std::chrono::nanoseconds duration) noexcept
+{
+    if (duration.count() <= 0) {
+        return 0;
+    }
+
+    if (!tsc_enabled.load(std::memory_order_acquire)) {
+        return static_cast<uint64_t>(duration.count());
+    }
+
+    auto ticks = static_cast<double>(duration.count()) * ticks_per_ns;
+    if (ticks >= static_cast<double>(std::numeric_limits<uint64_t>::max())) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(ticks);
+}
+
+std::chrono::nanoseconds deadline_clock::to_duration(uint64_t ticks) noexcept
+{
+    using rep = std::chrono::nanoseconds::rep;
+    constexpr auto max = std::numeric_limits<rep>::max();
+
+    if (!tsc_enabled.load(std::memory_order_acquire)) {
+        return std::chrono::nanoseconds{
+            ticks > static_cast<uint64_t>(max) ? max : static_cast<rep>(ticks)};
+    }
+
+    auto ns = static_cast<double>(ticks) / ticks_per_ns;
+    if (ns >= static_cast<double>(max)) {
+        return std::chrono::nanoseconds{max};
+    }
+    return std::chrono::nanoseconds{static_cast<rep>(ns)};
+}
+
+void timer::adapt(uint64_t now)
+{
+    // Average time per call since the previous clock read
+    const uint64_t per_call = (now - last_check_) / period_;
+    last_check_ = now;
+
+    const uint64_t interval = std::min(deadline_clock::to_ticks(check_interval), (end_ - now) / 2);
+    const uint64_t next = per_call > 0 ? interval / per_call : max_check_period;
+
+    // The period can shrink immediately but only grows gradually, in case
+    // the last calls aren't representative of the following ones.
+    period_ = static_cast<uint32_t>(
+        std::clamp<uint64_t>(next, 1, std::min<uint64_t>(period_ * 2ULL, max_check_period)));
+}
+
+} // namespace ddwaf
@@ -8,6 +8,20 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(DDWAF_DISABLE_TSC)
+#  define DDWAF_HAS_TSC 1
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#else
+#  define DDWAF_HAS_TSC 0
+#endif
+// NOLINTEND(cppcoreguidelines-macro-usage)
 
 namespace ddwaf {
 #ifndef __linux__
@@ -28,23 +42,73 @@ private:
 };
 #endif // __linux__
 
+// Clock used to evaluate deadlines, based on the CPU timestamp counter when
+// available, invariant and successfully calibrated, or on the monotonic_clock
+// otherwise. Ticks are only meaningful within this process.
+class deadline_clock {
+public:
+    static uint64_t now() noexcept
+    {
+#if DDWAF_HAS_TSC
+        if (tsc_enabled.load(std::memory_order_acquire)) {
+            return __rdtsc();
+        }
+#endif
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            monotonic_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    [[nodiscard]] static bool uses_tsc() noexcept
+    {
+        return tsc_enabled.load(std::memory_order_acquire);
+    }
+
+    // Calibrates the timestamp counter on the first call, rather than when the
+    // library is loaded, this is performed when the first WAF instance is
+    // created. Ticks obtained before the first call must not be compared with
+    // those obtained afterwards.
+    static void initialise() noexcept;
+
+    // Conversions saturate rather than overflow
+    static uint64_t to_ticks(std::chrono::nanoseconds duration) noexcept;
+    static std::chrono::nanoseconds to_duration(uint64_t ticks) noexcept;
+
+protected:
+    // Measures the frequency of the timestamp counter against monotonic_clock,
+    // returns false if the counter isn't invariant or the result is implausible.
+    static bool calibrate() noexcept;
+
+    static double ticks_per_ns;
+    static std::atomic<bool> tsc_enabled;
+};
+
 class timer {
 public:
-    // Syscall period refers to the number of calls to expired() before
-    // clock_gettime is called. This approach is only feasible because the
-    // WAF calls expired() quite often, otherwise another solution would be
-    // required to minimise syscalls.
-    explicit timer(std::chrono::microseconds exp, uint32_t syscall_period = default_syscall_period)
-        : start_(monotonic_clock::now()), end_(start_ + exp), syscall_period_(syscall_period)
+    // By default, the number of calls to expired() between two clock reads
+    // adapts to the observed time per call, so that the clock is read about
+    // every check_interval while still reading it at least twice within the
+    // remaining time. As the time per call is only an average, the period
+    // never exceeds max_check_period, so that a single slow call can't delay
+    // the detection of the deadline by more than that many calls. A non-zero
+    // check period disables the adaptation.
+    explicit timer(std::chrono::microseconds exp, uint32_t check_period = 0)
+        : start_(deadline_clock::now()), last_check_(start_),
+          end_(saturated_add(start_, deadline_clock::to_ticks(saturated_cast(exp)))),
+          period_(check_period > 0 ? check_period : 1), adaptive_(check_period == 0)
     {}
 
     bool expired()
     {
         if (!expired_ && --calls_ == 0) {
-            if (end_ <= monotonic_clock::now()) {
+            auto now = deadline_clock::now();
+            if (end_ <= now) {
                 expired_ = true;
             } else {
-                calls_ = syscall_period_;
+                if (adaptive_) {
+                    adapt(now);
+                }
+                calls_ = period_;
             }
         }
         return expired_;
@@ -52,18 +116,51 @@ public:
 
     [[nodiscard]] bool expired_before() const { return expired_; }
 
+    // Copies of a timer share the same deadline but not the expired state,
+    // this is used to propagate an expiration observed through a copy.
+    void expire() { expired_ = true; }
+
+    // Time left until the deadline, this always reads the clock
+    [[nodiscard]] std::chrono::nanoseconds remaining() const
+    {
+        if (expired_) {
+            return std::chrono::nanoseconds{0};
+        }
+
+        auto now = deadline_clock::now();
+        return end_ > now ? deadline_clock::to_duration(end_ - now) : std::chrono::nanoseconds{0};
+    }
+
     [[nodiscard]] monotonic_clock::duration elapsed() const
     {
-        return monotonic_clock::now() - start_;
+        return std::chrono::duration_cast<monotonic_clock::duration>(
+            deadline_clock::to_duration(deadline_clock::now() - start_));
     }
 
+    static constexpr std::chrono::nanoseconds check_interval{10000};
+    static constexpr uint32_t max_check_period{16};
+
 protected:
-    constexpr static uint32_t default_syscall_period{16};
+    static std::chrono::nanoseconds saturated_cast(std::chrono::microseconds value)
+    {
+        constexpr auto max =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds::max());
+        return value >= max ? std::chrono::nanoseconds::max() : std::chrono::nanoseconds{value};
+    }
+
+    static uint64_t saturated_add(uint64_t lhs, uint64_t rhs)
+    {
+        return rhs > UINT64_MAX - lhs ? UINT64_MAX : lhs + rhs;
+    }
+
+    void adapt(uint64_t now);
 
-    monotonic_clock::time_point start_;
-    monotonic_clock::time_point end_;
-    const uint32_t syscall_period_;
+    uint64_t start_;
+    uint64_t last_check_;
+    uint64_t end_;
+    uint32_t period_;
     uint32_t calls_{1};
+    bool adaptive_;
     bool expired_{false};
 };
 } // namespace ddwaf
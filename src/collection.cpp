@@ -4,6 +4,9 @@
 // This product includes software developed at Datadog (https://www.datadoghq.com/).
 // Copyright 2021 Datadog, Inc.
 
+#include <algorithm>
+#include <limits>
+
 #include <collection.hpp>
 #include <exception.hpp>
 #include <log.hpp>
@@ -11,18 +14,25 @@
 namespace ddwaf {
 
 namespace {
-std::optional<event> match_rule(const rule::ptr &rule, const object_store &store,
-    std::unordered_map<rule::ptr, rule::cache_type> &cache,
+// The position of the rule within the collection is used to report the
+// number of rules completed when the deadline expires. Rules with a cost of
+// at least collection::min_skippable_cost are skipped if the remaining time
+// is lower than their cost.
+template <bool Profile>
+std::optional<event> match_rule(const rule::ptr &rule, std::size_t position, uint64_t cost,
+    const object_store &store, collection_cache &cache,
     const std::unordered_set<ddwaf::rule *> &rules_to_exclude,
     const std::unordered_map<ddwaf::rule *, collection::object_set> &objects_to_exclude,
     const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
-    ddwaf::timer &deadline)
+    ddwaf::timer &deadline, [[maybe_unused]] metrics::recorder *recorder)
 {
     const auto &id = rule->id;
 
     if (deadline.expired()) {
         DDWAF_INFO("Ran out of time while running rule %s", id.c_str());
-        throw timeout_exception();
+        timeout_exception e;
+        e.rules_completed = position;
+        throw e;
     }
 
     if (!rule->is_enabled()) {
@@ -37,25 +47,42 @@ std::optional<event> match_rule(const rule::ptr &rule, const object_store &store
     DDWAF_DEBUG("Running the WAF on rule %s", id.c_str());
 
     try {
-        auto it = cache.find(rule);
-        if (it == cache.end()) {
-            auto [new_it, res] = cache.emplace(rule, rule::cache_type{});
+        auto it = cache.rule_cache.find(rule);
+        if (it == cache.rule_cache.end()) {
+            auto [new_it, res] = cache.rule_cache.emplace(rule, rule::cache_type{});
             it = new_it;
         }
 
         rule::cache_type &rule_cache = it->second;
-        std::optional<event> event;
+        if (cost >= collection::min_skippable_cost && !rule_cache.result &&
+            deadline.remaining() < std::chrono::nanoseconds(cost)) {
+            DDWAF_DEBUG("Skipping rule %s, not enough time left", id.c_str());
+            cache.skipped_rules.emplace_back(id);
+            return std::nullopt;
+        }
+
+        static const collection::object_set no_exclusions;
+        const auto *objects_excluded = &no_exclusions;
         auto exclude_it = objects_to_exclude.find(rule.get());
         if (exclude_it != objects_to_exclude.end()) {
-            const auto &objects_excluded = exclude_it->second;
-            event = rule->match(store, rule_cache, objects_excluded, dynamic_processors, deadline);
-        } else {
-            event = rule->match(store, rule_cache, {}, dynamic_processors, deadline);
+            objects_excluded = &exclude_it->second;
         }
 
-        return event;
-    } catch (const ddwaf::timeout_exception &) {
+        // Verdicts can only be shared if the rule sees the same objects
+        rule_cache.verdicts = objects_excluded->empty() ? cache.verdicts : nullptr;
+
+        if constexpr (Profile) {
+            return rule->match(
+                store, rule_cache, *objects_excluded, dynamic_processors, deadline, *recorder);
+        } else {
+            return rule->match(store, rule_cache, *objects_excluded, dynamic_processors, deadline);
+        }
+    } catch (ddwaf::timeout_exception &e) {
         DDWAF_INFO("Ran out of time while processing %s", id.c_str());
+        if (e.id.empty()) {
+            e.id = id;
+        }
+        e.rules_completed += position;
         throw;
     }
 
@@ -68,15 +95,35 @@ void collection::match(std::vector<event> &events,
     collection_cache &cache, const std::unordered_set<rule *> &rules_to_exclude,
     const std::unordered_map<rule *, object_set> &objects_to_exclude,
     const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
-    ddwaf::timer &deadline) const
+    ddwaf::timer &deadline, ddwaf::metrics *metrics) const
 {
     if (cache.result) {
         return;
     }
 
-    for (const auto &rule : rules_) {
-        auto event = match_rule(rule, store, cache.rule_cache, rules_to_exclude, objects_to_exclude,
-            dynamic_processors, deadline);
+    if (metrics == nullptr) {
+        match_rules<false>(events, store, cache, rules_to_exclude, objects_to_exclude,
+            dynamic_processors, deadline, nullptr);
+    } else {
+        metrics::recorder recorder{*metrics};
+        match_rules<true>(events, store, cache, rules_to_exclude, objects_to_exclude,
+            dynamic_processors, deadline, &recorder);
+    }
+}
+
+template <bool Profile>
+void collection::match_rules(std::vector<event> &events, const object_store &store,
+    collection_cache &cache, const std::unordered_set<rule *> &rules_to_exclude,
+    const std::unordered_map<rule *, object_set> &objects_to_exclude,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, metrics::recorder *recorder) const
+{
+    for (std::size_t i = 0; i < rules_.size(); ++i) {
+        const auto &rule = rules_[i];
+        // Rules with actions are never skipped
+        const uint64_t cost = i < costs_.size() && rule->actions.empty() ? costs_[i] : 0;
+        auto event = match_rule<Profile>(rule, i, cost, store, cache, rules_to_exclude,
+            objects_to_exclude, dynamic_processors, deadline, recorder);
         if (event.has_value()) {
             cache.result = true;
             events.emplace_back(std::move(*event));
@@ -91,7 +138,7 @@ void priority_collection::match(std::vector<event> &events,
     collection_cache &cache, const std::unordered_set<rule *> &rules_to_exclude,
     const std::unordered_map<rule *, object_set> &objects_to_exclude,
     const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
-    ddwaf::timer &deadline) const
+    ddwaf::timer &deadline, ddwaf::metrics *metrics) const
 {
     auto &remaining_actions = cache.remaining_actions;
     for (auto it = remaining_actions.begin(); it != remaining_actions.end();) {
@@ -105,14 +152,34 @@ void priority_collection::match(std::vector<event> &events,
     // If there are no remaining actions, we treat this collection as a regular one
     if (remaining_actions.empty()) {
         collection::match(events, seen_actions, store, cache, rules_to_exclude, objects_to_exclude,
-            dynamic_processors, deadline);
+            dynamic_processors, deadline, metrics);
         return;
     }
 
     // If there are still remaining actions, we treat this collection as a priority tone
-    for (const auto &rule : rules_) {
-        auto event = match_rule(rule, store, cache.rule_cache, rules_to_exclude, objects_to_exclude,
-            dynamic_processors, deadline);
+    if (metrics == nullptr) {
+        match_rules<false>(events, seen_actions, store, cache, rules_to_exclude,
+            objects_to_exclude, dynamic_processors, deadline, nullptr);
+    } else {
+        metrics::recorder recorder{*metrics};
+        match_rules<true>(events, seen_actions, store, cache, rules_to_exclude,
+            objects_to_exclude, dynamic_processors, deadline, &recorder);
+    }
+}
+
+template <bool Profile>
+void priority_collection::match_rules(std::vector<event> &events,
+    std::unordered_set<std::string_view> &seen_actions, const object_store &store,
+    collection_cache &cache, const std::unordered_set<rule *> &rules_to_exclude,
+    const std::unordered_map<rule *, object_set> &objects_to_exclude,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, metrics::recorder *recorder) const
+{
+    auto &remaining_actions = cache.remaining_actions;
+    for (std::size_t i = 0; i < rules_.size(); ++i) {
+        const auto &rule = rules_[i];
+        auto event = match_rule<Profile>(rule, i, 0, store, cache, rules_to_exclude,
+            objects_to_exclude, dynamic_processors, deadline, recorder);
         if (event.has_value()) {
             // If there has been a match, we set the result to true to ensure
             // that the equivalent regular collection doesn't attempt to match
@@ -133,4 +200,32 @@ void priority_collection::match(std::vector<event> &events,
     }
 }
 
+void collection::order(const rule_cost_map &costs)
+{
+    auto cost_of = [&costs](const rule::ptr &r) {
+        auto it = costs.find(r.get());
+        return it != costs.end() ? it->second : std::numeric_limits<uint64_t>::max();
+    };
+
+    std::sort(rules_.begin(), rules_.end(), [&](const rule::ptr &lhs, const rule::ptr &rhs) {
+        auto lhs_cost = cost_of(lhs);
+        auto rhs_cost = cost_of(rhs);
+        return lhs_cost != rhs_cost ? lhs_cost < rhs_cost : lhs->id < rhs->id;
+    });
+
+    costs_.clear();
+    costs_.reserve(rules_.size());
+    total_cost_ = 0;
+    for (const auto &rule : rules_) {
+        auto it = costs.find(rule.get());
+        if (it == costs.end()) {
+            // Rules without a cost are never skipped
+            costs_.emplace_back(0);
+            continue;
+        }
+        costs_.emplace_back(it->second);
+        total_cost_ = it->second > UINT64_MAX - total_cost_ ? UINT64_MAX : total_cost_ + it->second;
+    }
+}
+
 } // namespace ddwaf
@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <cost.hpp>
 #include <event.hpp>
+#include <metrics.hpp>
 #include <rule.hpp>
 
 #include <unordered_map>
@@ -33,6 +35,10 @@ struct collection_cache {
     bool result{false};
     std::unordered_map<rule::ptr, rule::cache_type> rule_cache;
     std::unordered_set<std::string_view> remaining_actions;
+    // Rules skipped due to the remaining time, collected after each evaluation
+    std::vector<std::string_view> skipped_rules;
+    // Verdicts of the conditions shared across rules, owned by the context
+    verdict_cache *verdicts{nullptr};
 };
 
 class collection {
@@ -47,7 +53,12 @@ public:
     collection &operator=(const collection &) = default;
     collection &operator=(collection &&) = default;
 
-    virtual void insert(rule::ptr rule) { rules_.emplace_back(std::move(rule)); }
+    virtual void insert(rule::ptr rule)
+    {
+        rules_.emplace_back(std::move(rule));
+        costs_.clear();
+        total_cost_ = 0;
+    }
 
     virtual void match(std::vector<event> &events /* output */,
         std::unordered_set<std::string_view> &seen_actions /* input & output */,
@@ -55,12 +66,39 @@ public:
         const std::unordered_set<ddwaf::rule *> &rules_to_exclude,
         const std::unordered_map<ddwaf::rule *, object_set> &objects_to_exclude,
         const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
-        ddwaf::timer &deadline) const;
+        ddwaf::timer &deadline, ddwaf::metrics *metrics = nullptr) const;
 
     [[nodiscard]] virtual collection_cache get_cache() const { return {}; }
 
+    [[nodiscard]] std::size_t size() const { return rules_.size(); }
+
+    // Orders the rules by increasing cost, so that a match on a cheap rule
+    // avoids the evaluation of the expensive ones. Rules without a cost are
+    // evaluated last and ties are broken by id.
+    void order(const rule_cost_map &costs);
+
+    // Sum of the estimated cost of the rules, only available once ordered
+    [[nodiscard]] uint64_t cost() const { return total_cost_; }
+
+    // Rules estimated to take at least this long, in nanoseconds, are skipped
+    // when the remaining time is lower than their estimated cost, unless the
+    // rule has actions.
+    static constexpr uint64_t min_skippable_cost = 1000;
+
 protected:
+    // Metrics are only recorded when Profile is true, which keeps the regular
+    // evaluation path free of any profiling overhead.
+    template <bool Profile>
+    void match_rules(std::vector<event> &events, const object_store &store,
+        collection_cache &cache, const std::unordered_set<ddwaf::rule *> &rules_to_exclude,
+        const std::unordered_map<ddwaf::rule *, object_set> &objects_to_exclude,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, metrics::recorder *recorder) const;
+
     std::vector<rule::ptr> rules_{};
+    // Estimated cost of each rule, in the same order, empty when unknown
+    std::vector<uint64_t> costs_{};
+    uint64_t total_cost_{0};
 };
 
 class priority_collection : public collection {
@@ -76,6 +114,8 @@ public:
     {
         actions_.insert(rule->actions.begin(), rule->actions.end());
         rules_.emplace_back(std::move(rule));
+        costs_.clear();
+        total_cost_ = 0;
     }
 
     void match(std::vector<event> &events /* output */,
@@ -84,11 +124,19 @@ public:
         const std::unordered_set<ddwaf::rule *> &rules_to_exclude,
         const std::unordered_map<ddwaf::rule *, object_set> &objects_to_exclude,
         const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
-        ddwaf::timer &deadline) const override;
+        ddwaf::timer &deadline, ddwaf::metrics *metrics = nullptr) const override;
 
     [[nodiscard]] collection_cache get_cache() const override { return {false, {}, actions_}; }
 
 protected:
+    template <bool Profile>
+    void match_rules(std::vector<event> &events, std::unordered_set<std::string_view> &seen_actions,
+        const object_store &store, collection_cache &cache,
+        const std::unordered_set<ddwaf::rule *> &rules_to_exclude,
+        const std::unordered_map<ddwaf::rule *, object_set> &objects_to_exclude,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, metrics::recorder *recorder) const;
+
     std::unordered_set<std::string_view> actions_;
 };
 
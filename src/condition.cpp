@@ -15,8 +15,9 @@
 
 namespace ddwaf {
 
-std::optional<event::match> condition::match_object(
-    const ddwaf_object *object, const rule_processor::base::ptr &processor) const
+template <bool Profile>
+std::optional<event::match> condition::match_object(const ddwaf_object *object,
+    const rule_processor::base::ptr &processor, [[maybe_unused]] match_stats *stats) const
 {
     const bool has_transform = !transformers_.empty();
     bool transform_required = false;
@@ -31,12 +32,20 @@ std::optional<event::match> condition::match_object(
     const size_t length =
         find_string_cutoff(object->stringValue, object->nbEntries, limits_.max_string_length);
 
+    if constexpr (Profile) {
+        ++stats->strings;
+    }
+
     // If we don't have transform to perform, or if they're irrelevant, no need to waste time
     // copying and allocating data
     if (!has_transform || !transform_required) {
         return processor->match({object->stringValue, length});
     }
 
+    if constexpr (Profile) {
+        stats->bytes += length;
+    }
+
     ddwaf_object copy;
     ddwaf_object_stringl(&copy, (const char *)object->stringValue, length);
 
@@ -59,9 +68,9 @@ std::optional<event::match> condition::match_object(
     return processor->match_object(&copy);
 }
 
-template <typename T>
-std::optional<event::match> condition::match_target(
-    T &it, const rule_processor::base::ptr &processor, ddwaf::timer &deadline) const
+template <bool Profile, typename T>
+std::optional<event::match> condition::match_target(T &it,
+    const rule_processor::base::ptr &processor, ddwaf::timer &deadline, match_stats *stats) const
 {
     for (; it; ++it) {
         if (deadline.expired()) {
@@ -72,7 +81,7 @@ std::optional<event::match> condition::match_target(
             continue;
         }
 
-        auto optional_match = match_object(*it, processor);
+        auto optional_match = match_object<Profile>(*it, processor, stats);
         if (!optional_match.has_value()) {
             continue;
         }
@@ -100,10 +109,61 @@ const rule_processor::base::ptr &condition::get_processor(
     return it->second;
 }
 
+std::string condition::key() const
+{
+    // Fields are length-prefixed to avoid ambiguities between keys
+    std::string key;
+    auto append = [&key](std::string_view field) {
+        key.append(std::to_string(field.size()));
+        key.push_back(':');
+        key.append(field);
+    };
+
+    append(std::to_string(targets_.size()));
+    for (const auto &target : targets_) {
+        append(std::to_string(target.root));
+        append(std::to_string(target.key_path.size()));
+        for (const auto &key_path : target.key_path) { append(key_path); }
+    }
+
+    append(std::to_string(transformers_.size()));
+    for (auto transformer : transformers_) { append(std::to_string(transformer)); }
+
+    // Processors are identified by their address, which is unique for as
+    // long as the condition is alive.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    append(std::to_string(reinterpret_cast<uintptr_t>(processor_.get())));
+    append(data_id_);
+    append(std::to_string(limits_.max_container_depth));
+    append(std::to_string(limits_.max_container_size));
+    append(std::to_string(limits_.max_string_length));
+    append(std::to_string(static_cast<unsigned>(source_)));
+    return key;
+}
+
 std::optional<event::match> condition::match(const object_store &store,
     const std::unordered_set<const ddwaf_object *> &objects_excluded, bool run_on_new,
     const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
     ddwaf::timer &deadline) const
+{
+    return match_impl<false>(
+        store, objects_excluded, run_on_new, dynamic_processors, deadline, nullptr);
+}
+
+std::optional<event::match> condition::match(const object_store &store,
+    const std::unordered_set<const ddwaf_object *> &objects_excluded, bool run_on_new,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, match_stats &stats) const
+{
+    return match_impl<true>(
+        store, objects_excluded, run_on_new, dynamic_processors, deadline, &stats);
+}
+
+template <bool Profile>
+std::optional<event::match> condition::match_impl(const object_store &store,
+    const std::unordered_set<const ddwaf_object *> &objects_excluded, bool run_on_new,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, match_stats *stats) const
 {
     const auto &processor = get_processor(dynamic_processors);
     if (!processor) {
@@ -113,7 +173,9 @@ std::optional<event::match> condition::match(const object_store &store,
 
     for (const auto &[target, name, key_path] : targets_) {
         if (deadline.expired()) {
-            throw ddwaf::timeout_exception();
+            ddwaf::timeout_exception e;
+            e.address = name;
+            throw e;
         }
 
         // TODO: the conditions should keep track of the targets already
@@ -129,12 +191,17 @@ std::optional<event::match> condition::match(const object_store &store,
         }
 
         std::optional<event::match> optional_match;
-        if (source_ == data_source::keys) {
-            object::key_iterator it(object, key_path, objects_excluded, limits_);
-            optional_match = match_target(it, processor, deadline);
-        } else {
-            object::value_iterator it(object, key_path, objects_excluded, limits_);
-            optional_match = match_target(it, processor, deadline);
+        try {
+            if (source_ == data_source::keys) {
+                object::key_iterator it(object, key_path, objects_excluded, limits_);
+                optional_match = match_target<Profile>(it, processor, deadline, stats);
+            } else {
+                object::value_iterator it(object, key_path, objects_excluded, limits_);
+                optional_match = match_target<Profile>(it, processor, deadline, stats);
+            }
+        } catch (ddwaf::timeout_exception &e) {
+            e.address = name;
+            throw;
         }
 
         if (optional_match.has_value()) {
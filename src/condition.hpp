@@ -18,6 +18,7 @@
 #include <event.hpp>
 #include <iterator.hpp>
 #include <manifest.hpp>
+#include <metrics.hpp>
 #include <object_store.hpp>
 #include <rule_processor/base.hpp>
 
@@ -55,21 +56,46 @@ public:
         const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
         ddwaf::timer &deadline) const;
 
+    // Same as above, while also accumulating the number of strings inspected
+    // and bytes transformed into stats.
+    std::optional<event::match> match(const object_store &store,
+        const std::unordered_set<const ddwaf_object *> &objects_excluded, bool run_on_new,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, match_stats &stats) const;
+
     [[nodiscard]] const std::vector<condition::target_type> &get_targets() const
     {
         return targets_;
     }
 
-protected:
-    std::optional<event::match> match_object(
-        const ddwaf_object *object, const rule_processor::base::ptr &processor) const;
-
-    template <typename T>
-    std::optional<event::match> match_target(
-        T &it, const rule_processor::base::ptr &processor, ddwaf::timer &deadline) const;
+    [[nodiscard]] const std::vector<PW_TRANSFORM_ID> &get_transformers() const
+    {
+        return transformers_;
+    }
 
     [[nodiscard]] const rule_processor::base::ptr &get_processor(
         const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors) const;
+
+    // Generates a key identifying the condition by its targets, transformers,
+    // processor and limits, identical conditions produce the same key as long
+    // as their processors are shared.
+    [[nodiscard]] std::string key() const;
+
+protected:
+    template <bool Profile>
+    std::optional<event::match> match_impl(const object_store &store,
+        const std::unordered_set<const ddwaf_object *> &objects_excluded, bool run_on_new,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, match_stats *stats) const;
+
+    template <bool Profile>
+    std::optional<event::match> match_object(const ddwaf_object *object,
+        const rule_processor::base::ptr &processor, match_stats *stats) const;
+
+    template <bool Profile, typename T>
+    std::optional<event::match> match_target(T &it, const rule_processor::base::ptr &processor,
+        ddwaf::timer &deadline, match_stats *stats) const;
+
     std::vector<condition::target_type> targets_;
     std::vector<PW_TRANSFORM_ID> transformers_;
     std::shared_ptr<rule_processor::base> processor_;
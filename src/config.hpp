@@ -17,4 +17,15 @@ struct object_limits {
     uint32_t max_string_length{DDWAF_MAX_STRING_LENGTH};
 };
 
+struct thread_config {
+    uint32_t compile{0};
+    uint32_t run{0};
+    bool parallel_match{false};
+};
+
+struct profiling_config {
+    bool enabled{false};
+    bool histograms{false};
+};
+
 } // namespace ddwaf
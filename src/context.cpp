@@ -8,6 +8,8 @@
 
 #include <context.hpp>
 #include <exception.hpp>
+#include <algorithm>
+#include <cctype>
 #include <tuple>
 #include <unordered_set>
 #include <utils.hpp>
@@ -15,6 +17,115 @@
 
 namespace ddwaf {
 
+namespace {
+
+enum class content_type { unsupported, json, form };
+
+content_type parse_content_type(std::string_view value)
+{
+    // Parameters such as the charset are irrelevant
+    value = value.substr(0, value.find(';'));
+
+    std::string type;
+    type.reserve(value.size());
+    for (auto c : value) {
+        if (!isspace(static_cast<unsigned char>(c))) {
+            type.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        }
+    }
+
+    if (type == "application/json" || type == "text/json" ||
+        (type.size() > 5 && type.compare(type.size() - 5, 5, "+json") == 0)) {
+        return content_type::json;
+    }
+
+    if (type == "application/x-www-form-urlencoded") {
+        return content_type::form;
+    }
+
+    return content_type::unsupported;
+}
+
+void timeout_to_object(
+    const timeout_exception &timeout, std::size_t rules_total, ddwaf_object &output)
+{
+    ddwaf_object tmp;
+    ddwaf_object_map(&output);
+
+    auto add_string = [&](const char *key, std::string_view value) {
+        if (!value.empty()) {
+            ddwaf_object_map_add(
+                &output, key, ddwaf_object_stringl(&tmp, value.data(), value.size()));
+        }
+    };
+
+    add_string("phase", timeout.phase);
+    add_string(timeout.phase == "collections" ? "rule" : "filter", timeout.id);
+    if (timeout.condition.has_value()) {
+        ddwaf_object_map_add(
+            &output, "condition", ddwaf_object_unsigned_force(&tmp, *timeout.condition));
+    }
+    add_string("address", timeout.address);
+
+    // Rules completed is only meaningful once the collections are evaluated
+    if (timeout.phase == "collections") {
+        ddwaf_object_map_add(&output, "rules_completed",
+            ddwaf_object_unsigned_force(&tmp, timeout.rules_completed));
+    }
+    ddwaf_object_map_add(&output, "rules_total", ddwaf_object_unsigned_force(&tmp, rules_total));
+}
+
+// Adds the rules skipped to the diagnostics, which are only generated if
+// there has been a timeout or a rule has been skipped.
+void skipped_to_object(const std::vector<std::string_view> &skipped, ddwaf_object &output)
+{
+    if (output.type == DDWAF_OBJ_INVALID) {
+        ddwaf_object_map(&output);
+    }
+
+    ddwaf_object tmp;
+    ddwaf_object rules;
+    ddwaf_object_array(&rules);
+    for (auto id : skipped) {
+        ddwaf_object_array_add(&rules, ddwaf_object_stringl(&tmp, id.data(), id.size()));
+    }
+    ddwaf_object_map_add(&output, "skipped_rules", &rules);
+}
+
+// Evaluates a rule or input filter, attributing any timeout to it
+template <typename Filter>
+auto match_filter(const Filter &filter, const object_store &store,
+    typename Filter::cache_type &cache, std::string_view id, ddwaf::timer &deadline)
+{
+    try {
+        return filter.match(store, cache, deadline);
+    } catch (ddwaf::timeout_exception &e) {
+        if (e.id.empty()) {
+            e.id = id;
+        }
+        throw;
+    }
+}
+
+// Records the duration of the enclosing scope
+class scoped_phase {
+public:
+    scoped_phase(histogram_set *histograms, histogram_set::type t) : timer_(histograms), type_(t)
+    {}
+    ~scoped_phase() { timer_.lap(type_); }
+
+    scoped_phase(const scoped_phase &) = delete;
+    scoped_phase &operator=(const scoped_phase &) = delete;
+    scoped_phase(scoped_phase &&) = delete;
+    scoped_phase &operator=(scoped_phase &&) = delete;
+
+protected:
+    phase_timer timer_;
+    histogram_set::type type_;
+};
+
+} // namespace
+
 DDWAF_RET_CODE context::run(
     const ddwaf_object &newParameters, optional_ref<ddwaf_result> res, uint64_t timeLeft)
 {
@@ -22,12 +133,23 @@ DDWAF_RET_CODE context::run(
         ddwaf_result &output = *res;
         output = {false, nullptr, {nullptr, 0}, 0};
     }
+    timeout_.reset();
+    skipped_rules_.clear();
+
+    auto *histograms = ruleset_->histograms.get();
+    const scoped_phase phase(histograms, histogram_set::type::run);
+
+    derive_addresses(newParameters);
 
     if (!store_.insert(newParameters)) {
         DDWAF_WARN("Illegal WAF call: parameter structure invalid!");
         return DDWAF_ERR_INVALID_OBJECT;
     }
 
+    if (histograms != nullptr) {
+        histograms->record(histogram_set::type::input_size, store_.latest_size());
+    }
+
     // If the timeout provided is 0, we need to ensure the parameters are owned
     // by the additive to ensure that the semantics of DDWAF_ERR_TIMEOUT are
     // consistent across all possible timeout scenarios.
@@ -46,17 +168,226 @@ DDWAF_RET_CODE context::run(
         return DDWAF_OK;
     }
 
-    const event_serializer serializer(*ruleset_->event_obfuscator);
+    std::vector<ddwaf::event> events;
+    evaluate(events, deadline);
+
+    return report(events, deadline, res);
+}
 
+DDWAF_RET_CODE context::run_chunk(const std::string &address, std::string_view chunk, bool last,
+    optional_ref<ddwaf_result> res, uint64_t timeLeft)
+{
+    if (res.has_value()) {
+        ddwaf_result &output = *res;
+        output = {false, nullptr, {nullptr, 0}, 0};
+    }
+    timeout_.reset();
+    skipped_rules_.clear();
+
+    const std::size_t limit = ruleset_->limits.max_string_length;
+    const std::size_t overlap = std::min(max_stream_overlap, limit / 2);
+
+    auto it = streams_.try_emplace(address).first;
+    const auto &name = it->first;
+    auto &stream = it->second;
+
+    // Each window consists of the tail of the previous window followed by as
+    // much of the chunk as possible without exceeding the maximum length.
+    ddwaf::timer deadline{std::chrono::microseconds(timeLeft)};
     std::vector<ddwaf::event> events;
+    while (!chunk.empty()) {
+        auto piece = chunk.substr(0, limit - stream.tail.size());
+        chunk.remove_prefix(piece.size());
+
+        auto window = std::make_unique<stream_window>();
+        window->data.reserve(stream.tail.size() + piece.size());
+        window->data.append(stream.tail).append(piece);
+
+        const auto &data = window->data;
+        stream.tail = data.substr(data.size() - std::min(overlap, data.size()));
+
+        if (timeLeft == 0 || deadline.expired_before()) {
+            continue;
+        }
+
+        auto &value = window->value;
+        ddwaf_object_stringl_nc(&value, data.c_str(), data.size());
+        value.parameterName = name.c_str();
+        value.parameterNameLength = name.size();
+
+        auto &root = window->root;
+        ddwaf_object_map(&root);
+        root.array = &value;
+        root.nbEntries = 1;
+
+        store_.insert(root, false);
+        stream_windows_.emplace_back(std::move(window));
+
+        if (is_first_run() || store_.has_new_targets()) {
+            evaluate(events, deadline);
+        }
+    }
+
+    if (last) {
+        stream.tail.clear();
+    }
+
+    if (timeLeft == 0) {
+        if (res.has_value()) {
+            ddwaf_result &output = *res;
+            output.timeout = true;
+        }
+        return DDWAF_OK;
+    }
+
+    return report(events, deadline, res);
+}
+
+bool context::provide_raw(
+    const std::string &address, std::string_view raw, std::string_view content_type)
+{
+    auto type = parse_content_type(content_type);
+    if (type == content_type::unsupported) {
+        DDWAF_DEBUG("Unsupported content type for address %s", address.c_str());
+        return false;
+    }
+
+    auto value = std::make_unique<raw_value>();
+    value->buffer.assign(raw);
+    value->is_json = type == content_type::json;
+
+    const auto &limits = ruleset_->limits;
+    value->options.max_depth = limits.max_container_depth;
+    value->options.max_container_size = limits.max_container_size;
+
+    auto it = ruleset_->key_paths.find(address);
+    if (it != ruleset_->key_paths.end() && !it->second.full) {
+        value->options.key_paths = &it->second.paths;
+    }
+
+    // The value is owned by the context rather than the store
+    auto provider = [value = value.get()](ddwaf_object &object) {
+        try {
+            auto &buffer = value->buffer;
+            if (value->is_json) {
+                value->tree = json::parse_insitu(buffer.data(), buffer.size(), value->options);
+            } else {
+                value->tree =
+                    json::parse_form_insitu(buffer.data(), buffer.size(), value->options);
+            }
+        } catch (const parsing_error &e) {
+            DDWAF_DEBUG("Failed to parse raw value: %s", e.what());
+            return false;
+        }
+
+        object = value->tree.root();
+        return object.type != DDWAF_OBJ_INVALID;
+    };
+
+    if (!store_.insert_provider(address, std::move(provider), false)) {
+        return false;
+    }
+
+    raw_values_.emplace_back(std::move(value));
+    return true;
+}
+
+void context::derive_addresses(const ddwaf_object &input)
+{
+    if (input.type != DDWAF_OBJ_MAP || input.array == nullptr) {
+        return;
+    }
+
+    auto entries = static_cast<std::size_t>(input.nbEntries);
+    for (const auto &derived : ddwaf::derived_addresses()) {
+        const ddwaf_object *source = nullptr;
+        bool has_destination = false;
+        for (std::size_t i = 0; i < entries; ++i) {
+            const auto &entry = input.array[i];
+            if (entry.parameterName == nullptr) {
+                continue;
+            }
+
+            std::string_view key{entry.parameterName, entry.parameterNameLength};
+            if (key == derived.source && entry.type == DDWAF_OBJ_STRING) {
+                source = &entry;
+            } else if (key == derived.destination) {
+                has_destination = true;
+            }
+        }
+
+        if (source == nullptr || has_destination) {
+            continue;
+        }
+
+        // The source is owned by the store, or the caller, for the lifetime of
+        // the context, so the derived value can reference it.
+        auto value = std::make_unique<decomposed_object>();
+        std::string_view raw{source->stringValue, static_cast<std::size_t>(source->nbEntries)};
+        auto provider = [value = value.get(), raw, decompose = derived.decompose](
+                            ddwaf_object &object) {
+            if (!decompose(raw, *value)) {
+                return false;
+            }
+            object = value->root;
+            return true;
+        };
+
+        if (store_.insert_provider(derived.destination, std::move(provider), false)) {
+            derived_values_.emplace_back(std::move(value));
+        }
+    }
+}
+
+void context::evaluate(std::vector<event> &events, ddwaf::timer &deadline)
+{
+    phase_timer timer(ruleset_->histograms.get());
+    std::string_view phase = "rule_filters";
+    timeout_.reset();
+    if (verdicts_) {
+        verdicts_->clear();
+    }
     try {
         const auto &rules_to_exclude = filter_rules(deadline);
+        timer.lap(histogram_set::type::rule_filters);
+
+        phase = "input_filters";
         const auto &objects_to_exclude = filter_inputs(rules_to_exclude, deadline);
-        events = match(rules_to_exclude, objects_to_exclude, deadline);
-    } catch (const ddwaf::timeout_exception &) {}
+        timer.lap(histogram_set::type::input_filters);
 
+        phase = "collections";
+        auto new_events = match(rules_to_exclude, objects_to_exclude, deadline);
+        timer.lap(histogram_set::type::collections);
+        if (events.empty()) {
+            events = std::move(new_events);
+        } else {
+            for (auto &event : new_events) { events.emplace_back(std::move(event)); }
+        }
+    } catch (ddwaf::timeout_exception &e) {
+        e.phase = phase;
+        timeout_.emplace(std::move(e));
+    }
+
+    for (auto &[type, cache] : collection_cache_) {
+        for (auto id : cache.skipped_rules) {
+            if (std::find(skipped_rules_.begin(), skipped_rules_.end(), id) ==
+                skipped_rules_.end()) {
+                skipped_rules_.emplace_back(id);
+            }
+        }
+        cache.skipped_rules.clear();
+    }
+}
+
+DDWAF_RET_CODE context::report(
+    const std::vector<event> &events, ddwaf::timer &deadline, optional_ref<ddwaf_result> res)
+{
     const DDWAF_RET_CODE code = events.empty() ? DDWAF_OK : DDWAF_MATCH;
     if (res.has_value()) {
+        const scoped_phase phase(ruleset_->histograms.get(), histogram_set::type::serialization);
+        const trace_scope trace(hooks_, DDWAF_TRACE_SERIALIZATION);
+        const event_serializer serializer(*ruleset_->event_obfuscator);
+
         ddwaf_result &output = *res;
         serializer.serialize(events, seen_actions_, output);
         output.total_runtime = deadline.elapsed().count();
@@ -66,12 +397,29 @@ DDWAF_RET_CODE context::run(
     return code;
 }
 
+bool context::diagnostics(ddwaf_object &output) const
+{
+    ddwaf_object_invalid(&output);
+    if (timeout_.has_value()) {
+        timeout_to_object(*timeout_, ruleset_->rules.size(), output);
+    }
+
+    if (!skipped_rules_.empty()) {
+        skipped_to_object(skipped_rules_, output);
+    }
+
+    return output.type != DDWAF_OBJ_INVALID;
+}
+
 const std::unordered_set<rule *> &context::filter_rules(ddwaf::timer &deadline)
 {
+    const trace_scope trace(hooks_, DDWAF_TRACE_RULE_FILTERS);
     for (const auto &[id, filter] : ruleset_->rule_filters) {
         if (deadline.expired()) {
             DDWAF_INFO("Ran out of time while evaluating rule filters");
-            throw timeout_exception();
+            timeout_exception e;
+            e.id = id;
+            throw e;
         }
 
         auto it = rule_filter_cache_.find(filter);
@@ -81,7 +429,7 @@ const std::unordered_set<rule *> &context::filter_rules(ddwaf::timer &deadline)
         }
 
         rule_filter::cache_type &cache = it->second;
-        auto exclusion = filter->match(store_, cache, deadline);
+        auto exclusion = match_filter(*filter, store_, cache, id, deadline);
         rules_to_exclude_.merge(exclusion);
     }
     return rules_to_exclude_;
@@ -90,10 +438,13 @@ const std::unordered_set<rule *> &context::filter_rules(ddwaf::timer &deadline)
 const std::unordered_map<rule *, context::object_set> &context::filter_inputs(
     const std::unordered_set<rule *> &rules_to_exclude, ddwaf::timer &deadline)
 {
+    const trace_scope trace(hooks_, DDWAF_TRACE_INPUT_FILTERS);
     for (const auto &[id, filter] : ruleset_->input_filters) {
         if (deadline.expired()) {
             DDWAF_INFO("Ran out of time while evaluating input filters");
-            throw timeout_exception();
+            timeout_exception e;
+            e.id = id;
+            throw e;
         }
 
         auto it = input_filter_cache_.find(filter);
@@ -103,7 +454,7 @@ const std::unordered_map<rule *, context::object_set> &context::filter_inputs(
         }
 
         input_filter::cache_type &cache = it->second;
-        auto exclusion = filter->match(store_, cache, deadline);
+        auto exclusion = match_filter(*filter, store_, cache, id, deadline);
         if (exclusion.has_value()) {
             for (const auto &rule : exclusion->rules) {
                 if (rules_to_exclude.find(rule) != rules_to_exclude.end()) {
@@ -127,29 +478,100 @@ std::vector<event> context::match(const std::unordered_set<rule *> &rules_to_exc
     for (const auto &[id, proc] : ruleset_->dynamic_processors) {
         DDWAF_DEBUG("PROCESSORS: %s", id.c_str());
     }
+    // Number of rules in the collections already evaluated, used to report
+    // the progress of the evaluation on timeout
+    std::size_t rules_completed = 0;
     auto eval_collection = [&](const auto &type, const auto &collection) {
         auto it = collection_cache_.find(type);
         if (it == collection_cache_.end()) {
             auto [new_it, res] = collection_cache_.emplace(type, collection.get_cache());
             it = new_it;
+            it->second.verdicts = verdicts_.get();
+        }
+
+        const trace_scope trace(hooks_, DDWAF_TRACE_COLLECTION, type.data());
+        try {
+            collection.match(events, seen_actions_, store_, it->second, rules_to_exclude,
+                objects_to_exclude, ruleset_->dynamic_processors, deadline,
+                ruleset_->rule_metrics.get());
+        } catch (ddwaf::timeout_exception &e) {
+            e.rules_completed += rules_completed;
+            throw;
         }
-        collection.match(events, seen_actions_, store_, it->second, rules_to_exclude,
-            objects_to_exclude, ruleset_->dynamic_processors, deadline);
+        rules_completed += collection.size();
     };
 
     // Evaluate priority collections first
-    for (auto &[type, collection] : ruleset_->priority_collections) {
+    for (const auto &[type, collection] : ruleset_->priority_schedule) {
         DDWAF_DEBUG("Evaluating priority collection %s", type.data());
-        eval_collection(type, collection);
+        eval_collection(type, *collection);
+    }
+
+    if (ruleset_->parallel_match && ruleset_->collections.size() > 1) {
+        auto [pool, pool_ref] = ruleset_->run_pool.lock();
+        if (pool != nullptr) {
+            try {
+                match_parallel(*pool, events, rules_to_exclude, objects_to_exclude, deadline);
+            } catch (ddwaf::timeout_exception &e) {
+                e.rules_completed += rules_completed;
+                throw;
+            }
+            return events;
+        }
     }
 
     // Evalaute regular collection after
-    for (auto &[type, collection] : ruleset_->collections) {
+    for (const auto &[type, collection] : ruleset_->schedule) {
         DDWAF_DEBUG("Evaluating collection %s", type.data());
-        eval_collection(type, collection);
+        eval_collection(type, *collection);
     }
 
     return events;
 }
 
+void context::match_parallel(thread_pool &pool, std::vector<event> &events,
+    const std::unordered_set<rule *> &rules_to_exclude,
+    const std::unordered_map<rule *, object_set> &objects_to_exclude, ddwaf::timer &deadline)
+{
+    // Regular collections are independent of each other and don't modify
+    // seen_actions_, so they can be evaluated concurrently as long as the
+    // caches are created beforehand.
+    std::vector<std::pair<const collection *, collection::cache_type *>> work;
+    std::vector<const char *> names;
+    work.reserve(ruleset_->schedule.size());
+    names.reserve(ruleset_->schedule.size());
+    for (const auto &[type, collection] : ruleset_->schedule) {
+        names.emplace_back(type.data());
+        auto it = collection_cache_.find(type);
+        if (it == collection_cache_.end()) {
+            auto [new_it, res] = collection_cache_.emplace(type, collection->get_cache());
+            it = new_it;
+            it->second.verdicts = verdicts_.get();
+        }
+        work.emplace_back(collection, &it->second);
+    }
+
+    // Each worker has its own copy of the timer, all of them sharing the same
+    // deadline, and produces its events separately so that they can be merged
+    // in the same order as a sequential evaluation.
+    std::vector<std::vector<event>> results(work.size());
+    std::vector<ddwaf::timer> timers(work.size(), deadline);
+    try {
+        pool.parallel_for(work.size(), [&](std::size_t i) {
+            auto [collection, cache] = work[i];
+            const trace_scope trace(hooks_, DDWAF_TRACE_COLLECTION, names[i]);
+            collection->match(results[i], seen_actions_, store_, *cache, rules_to_exclude,
+                objects_to_exclude, ruleset_->dynamic_processors, timers[i],
+                ruleset_->rule_metrics.get());
+        });
+    } catch (const ddwaf::timeout_exception &) {
+        deadline.expire();
+        throw;
+    }
+
+    for (auto &result : results) {
+        for (auto &event : result) { events.emplace_back(std::move(event)); }
+    }
+}
+
 } // namespace ddwaf
@@ -11,14 +11,20 @@
 
 #include <config.hpp>
 #include <ddwaf.h>
+#include <derived_addresses.hpp>
 #include <event.hpp>
+#include <exception.hpp>
 #include <exclusion/input_filter.hpp>
 #include <exclusion/rule_filter.hpp>
+#include <json_loader.hpp>
 #include <obfuscator.hpp>
 #include <rule.hpp>
 #include <ruleset.hpp>
+#include <ruleset_ref.hpp>
+#include <trace.hpp>
 #include <utility>
 #include <utils.hpp>
+#include <verdict_cache.hpp>
 
 namespace ddwaf {
 
@@ -26,12 +32,20 @@ class context {
 public:
     using object_set = std::unordered_set<const ddwaf_object *>;
 
-    explicit context(std::shared_ptr<ruleset> ruleset)
-        : ruleset_(std::move(ruleset)), store_(ruleset_->manifest, ruleset_->free_fn)
+    explicit context(std::shared_ptr<ruleset> ruleset) : context(ruleset_ref{std::move(ruleset)})
+    {}
+
+    explicit context(ruleset_ref ruleset, ddwaf_trace_hooks hooks = {})
+        : ruleset_(std::move(ruleset)), store_(ruleset_->manifest, ruleset_->free_fn),
+          hooks_(hooks)
     {
         rule_filter_cache_.reserve(ruleset_->rule_filters.size());
         input_filter_cache_.reserve(ruleset_->input_filters.size());
         collection_cache_.reserve(ruleset_->collections.size());
+
+        if (!ruleset_->shared_conditions.empty()) {
+            verdicts_ = std::make_unique<verdict_cache>(ruleset_->shared_conditions);
+        }
     }
 
     context(const context &) = delete;
@@ -42,6 +56,36 @@ public:
 
     DDWAF_RET_CODE run(const ddwaf_object &, optional_ref<ddwaf_result> res, uint64_t);
 
+    // Evaluates a chunk of a string address as a sequence of windows, each of
+    // them overlapping the previous one by up to max_stream_overlap bytes.
+    DDWAF_RET_CODE run_chunk(const std::string &address, std::string_view chunk, bool last,
+        optional_ref<ddwaf_result> res, uint64_t);
+
+    bool provide(const std::string &address, object_store::provider_fn provider)
+    {
+        return store_.insert_provider(address, std::move(provider));
+    }
+
+    // Registers the raw value of an address, which is only parsed according to
+    // its content type once required, retaining only the key paths referenced
+    // by the ruleset. Returns false if the content type isn't supported or the
+    // address isn't required.
+    bool provide_raw(
+        const std::string &address, std::string_view raw, std::string_view content_type);
+
+    // Generates the diagnostics of the last run, consisting of the attribution
+    // of its timeout and the rules skipped, if any. Returns false otherwise.
+    bool diagnostics(ddwaf_object &output) const;
+
+    // Pool available to evaluate this context alongside others, along with
+    // the reference keeping it alive, if any. The pool is null if the WAF
+    // instance wasn't configured with multiple run threads or if it has
+    // already been destroyed.
+    [[nodiscard]] std::pair<thread_pool *, thread_pool::ptr> run_pool() const
+    {
+        return ruleset_->run_pool.lock();
+    }
+
     // These two functions below return references to internal objects,
     // however using them this way helps with testing
     const std::unordered_set<rule *> &filter_rules(ddwaf::timer &deadline);
@@ -51,11 +95,26 @@ public:
     std::vector<event> match(const std::unordered_set<rule *> &rules_to_exclude,
         const std::unordered_map<rule *, object_set> &objects_to_exclude, ddwaf::timer &deadline);
 
+    static constexpr std::size_t max_stream_overlap = 1024;
+
 protected:
     bool is_first_run() const { return collection_cache_.empty(); }
 
-    std::shared_ptr<ruleset> ruleset_;
+    // Registers providers for the derived addresses whose source is present
+    // in the input, unless the input already contains the derived address.
+    void derive_addresses(const ddwaf_object &input);
+
+    void evaluate(std::vector<event> &events, ddwaf::timer &deadline);
+    DDWAF_RET_CODE report(
+        const std::vector<event> &events, ddwaf::timer &deadline, optional_ref<ddwaf_result> res);
+
+    void match_parallel(thread_pool &pool, std::vector<event> &events,
+        const std::unordered_set<rule *> &rules_to_exclude,
+        const std::unordered_map<rule *, object_set> &objects_to_exclude, ddwaf::timer &deadline);
+
+    ruleset_ref ruleset_;
     ddwaf::object_store store_;
+    ddwaf_trace_hooks hooks_;
 
     using input_filter = exclusion::input_filter;
     using rule_filter = exclusion::rule_filter;
@@ -70,8 +129,43 @@ protected:
     // Cache of collections to avoid processing once a result has been obtained
     std::unordered_map<std::string_view, collection::cache_type> collection_cache_;
     std::unordered_set<std::string_view> seen_actions_;
+    // Verdicts of the conditions shared across rules within an evaluation,
+    // only available if the ruleset contains shared conditions.
+    std::unique_ptr<verdict_cache> verdicts_;
+
+    // Attribution of the timeout of the last run, if any
+    std::optional<timeout_exception> timeout_;
+    // Rules skipped during the current run due to the remaining time
+    std::vector<std::string_view> skipped_rules_;
 
     std::shared_ptr<waf> handle_;
+
+    struct stream_window {
+        std::string data;
+        ddwaf_object value;
+        ddwaf_object root;
+    };
+
+    struct stream_state {
+        std::string tail;
+    };
+
+    // Streamed addresses, the key is used as the parameter name of the windows
+    std::unordered_map<std::string, stream_state> streams_;
+    // Windows evaluated so far, these are kept for the lifetime of the context
+    // as the filter and rule caches might still reference their objects.
+    std::vector<std::unique_ptr<stream_window>> stream_windows_;
+
+    struct raw_value {
+        std::string buffer;
+        json::object_tree tree;
+        json::parse_options options;
+        bool is_json;
+    };
+
+    // Raw values referenced by the lazy providers registered in the store
+    std::vector<std::unique_ptr<raw_value>> raw_values_;
+    std::vector<std::unique_ptr<decomposed_object>> derived_values_;
 };
 
 } // namespace ddwaf
@@ -0,0 +1,201 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include <cost.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+// Approximate cost of evaluating a single value with each processor
+constexpr std::array<std::pair<std::string_view, uint64_t>, 6> processor_costs{{
+    {"exact_match", 20},
+    {"ip_match", 30},
+    {"phrase_match", 60},
+    {"match_regex", 200},
+    {"is_xss", 300},
+    {"is_sqli", 400},
+}};
+
+// Processors which can't be resolved are likely to be missing rule data
+constexpr uint64_t unknown_processor_cost = 200;
+constexpr uint64_t transformer_cost = 50;
+
+// Number of values assumed to be reached by a target without a key path,
+// which refers to the whole object rather than a single value
+constexpr uint64_t unbounded_target_values = 8;
+
+// Fraction of the evaluations which are assumed to go past a condition, as
+// conditions are expected to be selective
+constexpr uint64_t pass_through_divisor = 4;
+
+// Number of calls required for the samples of a rule to be relevant
+constexpr uint64_t min_sample_calls = 16;
+
+} // namespace
+
+uint64_t estimate_cost(const condition &cond, const processor_map &dynamic_processors)
+{
+    uint64_t per_value = unknown_processor_cost;
+    const auto &processor = cond.get_processor(dynamic_processors);
+    if (processor) {
+        auto name = processor->name();
+        for (const auto &[processor_name, cost] : processor_costs) {
+            if (processor_name == name) {
+                per_value = cost;
+                break;
+            }
+        }
+    }
+
+    per_value += cond.get_transformers().size() * transformer_cost;
+
+    uint64_t values = 0;
+    for (const auto &target : cond.get_targets()) {
+        values += target.key_path.empty() ? unbounded_target_values : 1;
+    }
+
+    return per_value * std::max<uint64_t>(values, 1);
+}
+
+uint64_t estimate_cost(const rule &r, const processor_map &dynamic_processors)
+{
+    const auto &order = r.evaluation_order;
+
+    uint64_t cost = 0;
+    uint64_t divisor = 1;
+    for (std::size_t i = 0; i < r.conditions.size(); ++i) {
+        const auto &cond = r.conditions[order.empty() ? i : order[i]];
+        cost += estimate_cost(*cond, dynamic_processors) / divisor;
+        divisor *= pass_through_divisor;
+    }
+    return cost;
+}
+
+std::vector<std::size_t> condition_order(
+    const rule &r, const processor_map &dynamic_processors, const metrics::rule_sample *observed)
+{
+    const auto size = r.conditions.size();
+    if (size < 2) {
+        return {};
+    }
+
+    if (observed != nullptr && observed->conditions.size() != size) {
+        observed = nullptr;
+    }
+
+    struct estimate {
+        double cost;
+        double pass_through;
+        bool sampled;
+    };
+
+    // As in estimate_costs, static estimates are scaled to be comparable to
+    // the observed costs of the other conditions.
+    std::vector<estimate> estimates;
+    estimates.reserve(size);
+    double observed_total = 0;
+    double estimated_total = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        auto cost = static_cast<double>(estimate_cost(*r.conditions[i], dynamic_processors));
+        estimate current{cost, 1.0 / pass_through_divisor, false};
+
+        if (observed != nullptr) {
+            const auto &sample = observed->conditions[i];
+            if (sample.calls >= min_sample_calls) {
+                const auto calls = static_cast<double>(sample.calls);
+                current = {static_cast<double>(sample.total_ns) / calls,
+                    static_cast<double>(sample.matches) / calls, true};
+                observed_total += current.cost;
+                estimated_total += cost;
+            }
+        }
+        estimates.emplace_back(current);
+    }
+
+    if (observed_total > 0 && estimated_total > 0) {
+        const double scale = observed_total / estimated_total;
+        for (auto &current : estimates) {
+            if (!current.sampled) {
+                current.cost *= scale;
+            }
+        }
+    }
+
+    // The expected cost of a sequence of conditions which stops at the first
+    // failure is minimised by evaluating them in increasing order of cost per
+    // probability of failure.
+    auto rank = [&](std::size_t i) {
+        const auto &current = estimates[i];
+        const double rejection = std::max(1.0 - current.pass_through, 1e-6);
+        return current.cost / rejection;
+    };
+
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i) { order[i] = i; }
+    std::stable_sort(order.begin(), order.end(),
+        [&](std::size_t lhs, std::size_t rhs) { return rank(lhs) < rank(rhs); });
+
+    for (std::size_t i = 0; i < size; ++i) {
+        if (order[i] != i) {
+            return order;
+        }
+    }
+    return {};
+}
+
+rule_cost_map estimate_costs(const std::unordered_map<std::string_view, rule::ptr> &rules,
+    const processor_map &dynamic_processors,
+    const std::unordered_map<std::string_view, metrics::rule_sample> *observed)
+{
+    rule_cost_map costs;
+    costs.reserve(rules.size());
+
+    // Observed costs are in nanoseconds, so static estimates are scaled by
+    // the ratio between both for the rules with samples.
+    uint64_t observed_total = 0;
+    uint64_t estimated_total = 0;
+    std::unordered_map<const rule *, uint64_t> samples;
+    for (const auto &[id, r] : rules) {
+        auto cost = estimate_cost(*r, dynamic_processors);
+        costs.emplace(r.get(), cost);
+
+        if (observed == nullptr) {
+            continue;
+        }
+
+        auto it = observed->find(id);
+        if (it != observed->end() && it->second.calls >= min_sample_calls) {
+            auto mean = it->second.total_ns / it->second.calls;
+            samples.emplace(r.get(), mean);
+            observed_total += mean;
+            estimated_total += cost;
+        }
+    }
+
+    if (samples.empty() || estimated_total == 0) {
+        return costs;
+    }
+
+    const double scale =
+        static_cast<double>(observed_total) / static_cast<double>(estimated_total);
+    for (auto &[r, cost] : costs) {
+        auto it = samples.find(r);
+        if (it != samples.end()) {
+            cost = it->second;
+        } else {
+            cost = static_cast<uint64_t>(static_cast<double>(cost) * scale);
+        }
+    }
+
+    return costs;
+}
+
+} // namespace ddwaf
@@ -0,0 +1,50 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <condition.hpp>
+#include <metrics.hpp>
+#include <rule.hpp>
+#include <rule_processor/base.hpp>
+
+namespace ddwaf {
+
+using processor_map = std::unordered_map<std::string, rule_processor::base::ptr>;
+using rule_cost_map = std::unordered_map<const rule *, uint64_t>;
+
+// Static estimate of the cost of evaluating a condition, in arbitrary units
+// roughly proportional to nanoseconds, based on the processor, the number of
+// transformers and the breadth of the targets.
+uint64_t estimate_cost(const condition &cond, const processor_map &dynamic_processors);
+
+// Static estimate of the cost of evaluating a rule, assuming that only a
+// fraction of the evaluations go past each condition, in evaluation order.
+uint64_t estimate_cost(const rule &r, const processor_map &dynamic_processors);
+
+// Order in which the conditions of a rule should be evaluated, so that the
+// conditions most likely to reject the evaluation at the lowest cost are
+// evaluated first. The cost and selectivity of conditions with enough calls
+// are obtained from the samples provided, otherwise the static estimate is
+// used. Returns an empty vector if the conditions should be evaluated in the
+// order in which they're defined.
+std::vector<std::size_t> condition_order(const rule &r, const processor_map &dynamic_processors,
+    const metrics::rule_sample *observed = nullptr);
+
+// Estimates the cost of every rule. When provided, observed samples take
+// precedence over the static estimate of rules with enough calls, the cost of
+// the remaining rules is scaled to be comparable to the observed ones.
+rule_cost_map estimate_costs(const std::unordered_map<std::string_view, rule::ptr> &rules,
+    const processor_map &dynamic_processors,
+    const std::unordered_map<std::string_view, metrics::rule_sample> *observed = nullptr);
+
+} // namespace ddwaf
@@ -0,0 +1,145 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <derived_addresses.hpp>
+#include <utils.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+// Returns the component as is unless it needs decoding, in which case the
+// decoded string is stored in the output.
+std::string_view decode(std::string_view value, bool plus_as_space, decomposed_object &output)
+{
+    auto needs_decoding = [plus_as_space](char c) {
+        return c == '%' || (plus_as_space && c == '+');
+    };
+    if (std::none_of(value.begin(), value.end(), needs_decoding)) {
+        return value;
+    }
+
+    auto &decoded = output.decoded.emplace_back(value.size(), '\0');
+    decoded.resize(percent_decode(
+        value.data(), value.data() + value.size(), decoded.data(), plus_as_space));
+    return decoded;
+}
+
+std::string_view trim(std::string_view value)
+{
+    auto begin = value.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    auto end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+// Splits the string into key-value pairs and groups the values by key, in
+// order of appearance.
+bool decompose(std::string_view raw, char separator, bool plus_as_space, decomposed_object &output)
+{
+    std::unordered_map<std::string_view, std::size_t> index;
+    std::vector<std::string_view> keys;
+
+    while (!raw.empty()) {
+        auto end = raw.find(separator);
+        auto pair = raw.substr(0, end);
+        raw.remove_prefix(end == std::string_view::npos ? raw.size() : end + 1);
+
+        if (separator == ';') {
+            pair = trim(pair);
+        }
+
+        if (pair.empty()) {
+            continue;
+        }
+
+        auto equal = pair.find('=');
+        auto key = decode(pair.substr(0, equal), plus_as_space, output);
+        auto value = equal == std::string_view::npos
+                         ? std::string_view{""}
+                         : decode(pair.substr(equal + 1), plus_as_space, output);
+
+        auto [it, inserted] = index.emplace(key, keys.size());
+        if (inserted) {
+            keys.emplace_back(key);
+            output.values.emplace_back();
+        }
+
+        ddwaf_object object;
+        ddwaf_object_stringl_nc(&object, value.data(), value.size());
+        output.values[it->second].emplace_back(object);
+    }
+
+    if (keys.empty()) {
+        return false;
+    }
+
+    output.entries.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        auto &values = output.values[i];
+
+        ddwaf_object entry;
+        ddwaf_object_array(&entry);
+        entry.array = values.data();
+        entry.nbEntries = values.size();
+        entry.parameterName = keys[i].data();
+        entry.parameterNameLength = keys[i].size();
+        output.entries.emplace_back(entry);
+    }
+
+    ddwaf_object_map(&output.root);
+    output.root.array = output.entries.data();
+    output.root.nbEntries = output.entries.size();
+
+    return true;
+}
+
+} // namespace
+
+bool decompose_query(std::string_view uri, decomposed_object &output)
+{
+    auto fragment = uri.find('#');
+    if (fragment != std::string_view::npos) {
+        uri = uri.substr(0, fragment);
+    }
+
+    auto query = uri.find('?');
+    if (query == std::string_view::npos) {
+        return false;
+    }
+
+    return decompose(uri.substr(query + 1), '&', true, output);
+}
+
+bool decompose_cookies(std::string_view header, decomposed_object &output)
+{
+    return decompose(header, ';', false, output);
+}
+
+const std::vector<derived_address> &derived_addresses()
+{
+    static const std::vector<derived_address> addresses{
+        {"server.request.uri.raw", "server.request.query", decompose_query},
+        {"server.request.cookies.raw", "server.request.cookies", decompose_cookies},
+    };
+    return addresses;
+}
+
+void insert_derived_sources(manifest &m)
+{
+    for (const auto &derived : derived_addresses()) {
+        if (m.find(derived.destination).has_value()) {
+            m.insert(std::string{derived.source});
+        }
+    }
+}
+
+} // namespace ddwaf
@@ -0,0 +1,56 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ddwaf.h>
+#include <manifest.hpp>
+
+namespace ddwaf {
+
+// Map of the form {key: [value, ...]} generated from a raw string, keys and
+// values reference the raw string unless they had to be decoded, in which case
+// they reference the decoded strings owned by this object.
+struct decomposed_object {
+    decomposed_object() = default;
+    ~decomposed_object() = default;
+    decomposed_object(const decomposed_object &) = delete;
+    decomposed_object(decomposed_object &&) = delete;
+    decomposed_object &operator=(const decomposed_object &) = delete;
+    decomposed_object &operator=(decomposed_object &&) = delete;
+
+    ddwaf_object root{};
+    std::vector<ddwaf_object> entries;
+    std::vector<std::vector<ddwaf_object>> values;
+    std::deque<std::string> decoded;
+};
+
+// Decomposes the query string of a raw URI, e.g. /path?a=1&b=2&a=3#fragment
+// results in {a: [1, 3], b: [2]}. Returns false if the URI has no query.
+bool decompose_query(std::string_view uri, decomposed_object &output);
+
+// Decomposes the value of a Cookie header, e.g. "a=1; b=2".
+bool decompose_cookies(std::string_view header, decomposed_object &output);
+
+// Addresses which can be derived from another one when not provided.
+struct derived_address {
+    std::string_view source;
+    std::string destination;
+    bool (*decompose)(std::string_view, decomposed_object &);
+};
+
+const std::vector<derived_address> &derived_addresses();
+
+// Adds the source of every derived address present in the manifest, so that
+// they are reported as required and retained by the object store.
+void insert_derived_sources(manifest &m);
+
+} // namespace ddwaf
@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace ddwaf {
@@ -32,6 +34,11 @@ public:
     explicit parsing_error(const std::string &what) : exception(what) {}
 };
 
+class file_error : public exception {
+public:
+    explicit file_error(const std::string &what) : exception(what) {}
+};
+
 class malformed_object : public exception {
 public:
     explicit malformed_object(const std::string &what) : exception("malformed object," + what) {}
@@ -71,6 +78,16 @@ public:
 class timeout_exception : public exception {
 public:
     timeout_exception() : exception({}) {}
+
+    // Location of the evaluation when the deadline expired, each component
+    // fills in its own part, if not already known, as the exception
+    // propagates. All views refer to data owned by the ruleset.
+    std::string_view phase;
+    // Identifier of the rule or filter being evaluated
+    std::string_view id;
+    std::optional<std::size_t> condition;
+    std::string_view address;
+    std::size_t rules_completed{0};
 };
 
 } // namespace ddwaf
@@ -39,6 +39,7 @@ public:
         const object_store &store, cache_type &cache, ddwaf::timer &deadline) const;
 
     std::string_view get_id() { return id_; }
+    const std::vector<condition::ptr> &get_conditions() const { return conditions_; }
 
 protected:
     std::string id_;
@@ -100,17 +100,18 @@ std::unordered_set<const ddwaf_object *> object_filter::match(
             throw ddwaf::timeout_exception();
         }
 
-        if (cache.find(target) != cache.end()) {
+        const auto *object = store.get_target(target);
+        if (object == nullptr) {
             continue;
         }
 
-        const auto *object = store.get_target(target);
-        if (object == nullptr) {
+        auto &cached = cache[target];
+        if (cached == object) {
             continue;
         }
         iterate_object(filter.get_traverser(), object, objects_to_exclude, limits_);
 
-        cache.emplace(target);
+        cached = object;
     }
 
     return objects_to_exclude;
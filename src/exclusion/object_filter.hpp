@@ -14,6 +14,7 @@
 #include <stack>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -237,7 +238,9 @@ inline std::ostream &operator<<(std::ostream &os, const path_trie::traverser::st
 
 class object_filter {
 public:
-    using cache_type = std::unordered_set<manifest::target_type>;
+    // Last object filtered for each target, streamed values replace the
+    // object of a target, in which case the new object is filtered as well.
+    using cache_type = std::unordered_map<manifest::target_type, const ddwaf_object *>;
 
     explicit object_filter(const ddwaf::object_limits &limits = {}) : limits_(limits) {}
 
@@ -0,0 +1,146 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <histogram.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+unsigned highest_bit(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while ((value >>= 1) != 0) { ++bit; }
+    return bit;
+#endif
+}
+
+constexpr std::array<std::pair<const char *, histogram_set::type>,
+    static_cast<std::size_t>(histogram_set::type::count)>
+    type_names{{
+        {"run", histogram_set::type::run},
+        {"rule_filters", histogram_set::type::rule_filters},
+        {"input_filters", histogram_set::type::input_filters},
+        {"collections", histogram_set::type::collections},
+        {"serialization", histogram_set::type::serialization},
+        {"input_size", histogram_set::type::input_size},
+    }};
+
+} // namespace
+
+std::size_t histogram::index(uint64_t value)
+{
+    if (value < sub_bucket_count) {
+        return static_cast<std::size_t>(value);
+    }
+
+    // The sub-bucket is given by the bits following the most significant one
+    const unsigned shift = highest_bit(value) - sub_bucket_bits;
+    return static_cast<std::size_t>(
+        (shift + 1) * sub_bucket_count + ((value >> shift) & (sub_bucket_count - 1)));
+}
+
+uint64_t histogram::lowest_equivalent(std::size_t index)
+{
+    if (index < sub_bucket_count) {
+        return index;
+    }
+
+    const auto shift = index / sub_bucket_count - 1;
+    return (sub_bucket_count + index % sub_bucket_count) << shift;
+}
+
+uint64_t histogram::highest_equivalent(std::size_t index)
+{
+    if (index < sub_bucket_count) {
+        return index;
+    }
+
+    const auto shift = index / sub_bucket_count - 1;
+    return lowest_equivalent(index) + ((1ULL << shift) - 1);
+}
+
+void histogram::record(uint64_t value)
+{
+    buckets_[index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    auto current = max_.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+void histogram::reset()
+{
+    for (auto &bucket : buckets_) { bucket.store(0, std::memory_order_relaxed); }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t histogram::quantile(double q) const
+{
+    // Buckets are read individually, so the total is recomputed rather than
+    // relying on count_ which might be out of sync with the buckets.
+    uint64_t total = 0;
+    for (const auto &bucket : buckets_) { total += bucket.load(std::memory_order_relaxed); }
+    if (total == 0) {
+        return 0;
+    }
+
+    q = std::min(std::max(q, 0.0), 1.0);
+    auto rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(highest_equivalent(i), max());
+        }
+    }
+
+    return max();
+}
+
+void histogram::to_object(ddwaf_object &output) const
+{
+    ddwaf_object tmp;
+    ddwaf_object_map(&output);
+    ddwaf_object_map_add(&output, "count", ddwaf_object_unsigned_force(&tmp, count()));
+    ddwaf_object_map_add(&output, "sum",
+        ddwaf_object_unsigned_force(&tmp, sum_.load(std::memory_order_relaxed)));
+    ddwaf_object_map_add(&output, "max", ddwaf_object_unsigned_force(&tmp, max()));
+    ddwaf_object_map_add(&output, "p50", ddwaf_object_unsigned_force(&tmp, quantile(0.5)));
+    ddwaf_object_map_add(&output, "p90", ddwaf_object_unsigned_force(&tmp, quantile(0.9)));
+    ddwaf_object_map_add(&output, "p99", ddwaf_object_unsigned_force(&tmp, quantile(0.99)));
+    ddwaf_object_map_add(&output, "p999", ddwaf_object_unsigned_force(&tmp, quantile(0.999)));
+}
+
+void histogram_set::reset()
+{
+    for (auto &h : histograms_) { h.reset(); }
+}
+
+void histogram_set::to_object(ddwaf_object &output) const
+{
+    ddwaf_object_map(&output);
+    for (const auto &[name, t] : type_names) {
+        ddwaf_object value;
+        get(t).to_object(value);
+        ddwaf_object_map_add(&output, name, &value);
+    }
+}
+
+} // namespace ddwaf
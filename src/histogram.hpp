@@ -0,0 +1,120 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <clock.hpp>
+#include <ddwaf.h>
+
+namespace ddwaf {
+
+// Log-linear histogram, values are grouped by their power of two and each
+// power of two is divided into a fixed number of linear sub-buckets, which
+// bounds the relative error of any quantile to 1 / sub_bucket_count. All
+// operations are lock-free and can be performed concurrently.
+class histogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 4;
+    static constexpr uint64_t sub_bucket_count = 1ULL << sub_bucket_bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    histogram() = default;
+    ~histogram() = default;
+    histogram(const histogram &) = delete;
+    histogram &operator=(const histogram &) = delete;
+    histogram(histogram &&) = delete;
+    histogram &operator=(histogram &&) = delete;
+
+    void record(uint64_t value);
+
+    // Concurrent records might be lost or partially reset
+    void reset();
+
+    [[nodiscard]] uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    // Returns the highest value equivalent to the quantile q in [0, 1], or 0
+    // if the histogram is empty.
+    [[nodiscard]] uint64_t quantile(double q) const;
+
+    // Generates a map of the form {count, sum, max, p50, p90, p99, p999}
+    void to_object(ddwaf_object &output) const;
+
+    static std::size_t index(uint64_t value);
+    static uint64_t lowest_equivalent(std::size_t index);
+    static uint64_t highest_equivalent(std::size_t index);
+
+protected:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Histograms collected by every context of a handle
+class histogram_set {
+public:
+    using ptr = std::shared_ptr<histogram_set>;
+
+    // Durations are in nanoseconds, the input size refers to the number of
+    // objects, including containers, provided on each call to ddwaf_run.
+    enum class type : uint8_t {
+        run,
+        rule_filters,
+        input_filters,
+        collections,
+        serialization,
+        input_size,
+        count
+    };
+
+    void record(type t, uint64_t value) { histograms_[static_cast<std::size_t>(t)].record(value); }
+
+    [[nodiscard]] const histogram &get(type t) const
+    {
+        return histograms_[static_cast<std::size_t>(t)];
+    }
+
+    void reset();
+
+    // Generates a map of histograms indexed by type
+    void to_object(ddwaf_object &output) const;
+
+protected:
+    std::array<histogram, static_cast<std::size_t>(type::count)> histograms_;
+};
+
+// Records the time elapsed since the previous lap, or the construction of the
+// timer, into the provided histogram. Without a histogram set, the clock isn't
+// queried at all.
+class phase_timer {
+public:
+    explicit phase_timer(histogram_set *histograms)
+        : histograms_(histograms),
+          last_(histograms != nullptr ? monotonic_clock::now() : monotonic_clock::time_point{})
+    {}
+
+    void lap(histogram_set::type t)
+    {
+        if (histograms_ != nullptr) {
+            auto now = monotonic_clock::now();
+            histograms_->record(t, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count()));
+            last_ = now;
+        }
+    }
+
+protected:
+    histogram_set *histograms_;
+    monotonic_clock::time_point last_;
+};
+
+} // namespace ddwaf
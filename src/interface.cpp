@@ -4,15 +4,25 @@
 // This product includes software developed at Datadog (https://www.datadoghq.com/).
 // Copyright 2021 Datadog, Inc.
 
+#include <algorithm>
+#include <clock.hpp>
 #include <context.hpp>
+#include <cstring>
 #include <exception.hpp>
+#include <json_loader.hpp>
+#include <key_paths.hpp>
+#include <live_handle.hpp>
+#include <mapped_file.hpp>
 #include <memory>
 #include <mutex>
 #include <obfuscator.hpp>
 #include <ruleset_info.hpp>
 #include <shared_mutex>
+#include <snapshot.hpp>
 #include <string>
+#include <thread_pool.hpp>
 #include <unordered_map>
+#include <vector>
 #include <waf.hpp>
 
 #include <log.hpp>
@@ -78,6 +88,55 @@ ddwaf::object_limits limits_from_config(const ddwaf_config *config)
     return limits;
 }
 
+// Copies the extended configuration provided by the caller, which might be
+// older and therefore smaller than the one known to the library.
+ddwaf_config_ext normalise_config_ext(const ddwaf_config_ext *ext)
+{
+    ddwaf_config_ext normalised{};
+    if (ext != nullptr) {
+        memcpy(&normalised, ext, std::min<std::size_t>(ext->size, sizeof(ddwaf_config_ext)));
+    }
+    normalised.size = sizeof(ddwaf_config_ext);
+    return normalised;
+}
+
+ddwaf::thread_config threads_from_config(const ddwaf_config_ext &ext)
+{
+    ddwaf::thread_config threads;
+    threads.compile = ext.threads.compile;
+    threads.run = ext.threads.run;
+    threads.parallel_match = ext.threads.parallel_match;
+    return threads;
+}
+
+ddwaf::profiling_config profiling_from_config(const ddwaf_config_ext &ext)
+{
+    ddwaf::profiling_config profiling;
+    profiling.enabled = ext.profiling.enabled;
+    profiling.histograms = ext.profiling.histograms;
+    return profiling;
+}
+
+DDWAF_RET_CODE run_context(
+    ddwaf::context &context, ddwaf_object &data, ddwaf_result *result, uint64_t timeout)
+{
+    try {
+        optional_ref<ddwaf_result> res{std::nullopt};
+        if (result != nullptr) {
+            res = *result;
+        }
+
+        return context.run(data, res, timeout);
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return DDWAF_ERR_INTERNAL;
+}
+
 } // namespace
 
 #endif
@@ -85,14 +144,24 @@ ddwaf::object_limits limits_from_config(const ddwaf_config *config)
 extern "C" {
 ddwaf::waf *ddwaf_init(
     const ddwaf_object *ruleset, const ddwaf_config *config, ddwaf_ruleset_info *info)
+{
+    return ddwaf_init_ext(ruleset, config, nullptr, info);
+}
+
+ddwaf::waf *ddwaf_init_ext(const ddwaf_object *ruleset, const ddwaf_config *config,
+    const ddwaf_config_ext *ext, ddwaf_ruleset_info *info)
 {
     try {
+        ddwaf::deadline_clock::initialise();
+
         ddwaf::ruleset_info ri(info);
         if (ruleset != nullptr) {
+            auto normalised = normalise_config_ext(ext);
             ddwaf::parameter input = *ruleset;
             return new ddwaf::waf(input, ri, limits_from_config(config),
                 config != nullptr ? config->free_fn : ddwaf_object_free,
-                obfuscator_from_config(config));
+                obfuscator_from_config(config), threads_from_config(normalised),
+                profiling_from_config(normalised));
         }
     } catch (const std::exception &e) {
         DDWAF_ERROR("%s", e.what());
@@ -103,6 +172,61 @@ ddwaf::waf *ddwaf_init(
     return nullptr;
 }
 
+ddwaf::waf *ddwaf_init_from_snapshot(
+    const void *buffer, size_t size, const ddwaf_config *config, ddwaf_ruleset_info *info)
+{
+    try {
+        if (buffer != nullptr) {
+            auto view = ddwaf::snapshot::load(buffer, size);
+            return ddwaf_init(&view.root(), config, info);
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return nullptr;
+}
+
+ddwaf::waf *ddwaf_init_from_file(
+    const char *path, const ddwaf_config *config, ddwaf_ruleset_info *info)
+{
+    try {
+        if (path != nullptr) {
+            ddwaf::mapped_file file(path);
+            if (ddwaf::snapshot::is_snapshot(file.data(), file.size())) {
+                auto view = ddwaf::snapshot::load(file.data(), file.size());
+                return ddwaf_init(&view.root(), config, info);
+            }
+
+            auto tree = ddwaf::json::parse_insitu(file.data(), file.size());
+            return ddwaf_init(&tree.root(), config, info);
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return nullptr;
+}
+
+size_t ddwaf_ruleset_serialize(const ddwaf_object *ruleset, void *buffer, size_t size)
+{
+    try {
+        if (ruleset != nullptr && ruleset->type == DDWAF_OBJ_MAP) {
+            return ddwaf::snapshot::serialize(*ruleset, buffer, size);
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return 0;
+}
+
 ddwaf::waf *ddwaf_update(ddwaf::waf *handle, const ddwaf_object *ruleset, ddwaf_ruleset_info *info)
 {
     try {
@@ -134,6 +258,69 @@ void ddwaf_destroy(ddwaf::waf *handle)
     }
 }
 
+ddwaf::live_handle *ddwaf_live_init(
+    const ddwaf_object *ruleset, const ddwaf_config *config, ddwaf_ruleset_info *info)
+{
+    try {
+        std::unique_ptr<ddwaf::waf> instance{ddwaf_init(ruleset, config, info)};
+        if (instance) {
+            return new ddwaf::live_handle(instance.release());
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return nullptr;
+}
+
+bool ddwaf_live_update(
+    ddwaf::live_handle *handle, const ddwaf_object *ruleset, ddwaf_ruleset_info *info)
+{
+    try {
+        ddwaf::ruleset_info ri(info);
+        if (handle != nullptr && ruleset != nullptr) {
+            ddwaf::parameter input = *ruleset;
+            return handle->update(input, ri);
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+    return false;
+}
+
+ddwaf_context ddwaf_live_context_init(ddwaf::live_handle *handle)
+{
+    try {
+        if (handle != nullptr) {
+            return handle->create_context();
+        }
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+    return nullptr;
+}
+
+void ddwaf_live_destroy(ddwaf::live_handle *handle)
+{
+    if (handle == nullptr) {
+        return;
+    }
+
+    try {
+        delete handle;
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+}
+
 const char *const *ddwaf_required_addresses(ddwaf::waf *handle, uint32_t *size)
 {
     if (handle == nullptr) {
@@ -151,6 +338,79 @@ const char *const *ddwaf_required_addresses(ddwaf::waf *handle, uint32_t *size)
     return addresses.data();
 }
 
+bool ddwaf_required_key_paths(ddwaf::waf *handle, ddwaf_object *output)
+{
+    if (handle == nullptr || output == nullptr) {
+        return false;
+    }
+
+    try {
+        ddwaf::key_paths_to_object(handle->get_required_key_paths(), *output);
+        return true;
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return false;
+}
+
+bool ddwaf_get_metrics(ddwaf::waf *handle, ddwaf_object *output)
+{
+    if (handle == nullptr || output == nullptr) {
+        return false;
+    }
+
+    try {
+        return handle->get_metrics(*output);
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return false;
+}
+
+bool ddwaf_get_histograms(ddwaf::waf *handle, ddwaf_object *output)
+{
+    if (handle == nullptr || output == nullptr) {
+        return false;
+    }
+
+    try {
+        return handle->get_histograms(*output);
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return false;
+}
+
+void ddwaf_reset_histograms(ddwaf::waf *handle)
+{
+    if (handle == nullptr) {
+        DDWAF_WARN("Illegal WAF call: handle was null");
+        return;
+    }
+
+    handle->reset_histograms();
+}
+
+bool ddwaf_set_trace_hooks(ddwaf::waf *handle, const ddwaf_trace_hooks *hooks)
+{
+    if (handle == nullptr) {
+        DDWAF_WARN("Illegal WAF call: handle was null");
+        return false;
+    }
+
+    handle->set_trace_hooks(hooks != nullptr ? *hooks : ddwaf_trace_hooks{});
+    return true;
+}
+
 ddwaf_context ddwaf_context_init(ddwaf::waf *handle)
 {
     try {
@@ -176,13 +436,87 @@ DDWAF_RET_CODE ddwaf_run(
         DDWAF_WARN("Illegal WAF call: context or data was null");
         return DDWAF_ERR_INVALID_ARGUMENT;
     }
+
+    return run_context(*context, *data, result, timeout);
+}
+
+DDWAF_RET_CODE ddwaf_run_batch(ddwaf_context *contexts, ddwaf_object **data,
+    ddwaf_result *results, size_t count, uint64_t timeout)
+{
+    if (contexts == nullptr || data == nullptr) {
+        DDWAF_WARN("Illegal WAF call: contexts or data was null");
+        return DDWAF_ERR_INVALID_ARGUMENT;
+    }
+
+    bool valid = true;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (results != nullptr) {
+            results[i] = {false, nullptr, {nullptr, 0}, 0};
+        }
+        valid = valid && contexts[i] != nullptr && data[i] != nullptr;
+    }
+
+    if (!valid) {
+        DDWAF_WARN("Illegal WAF call: context or data was null");
+        return DDWAF_ERR_INVALID_ARGUMENT;
+    }
+
+    if (count == 0) {
+        return DDWAF_OK;
+    }
+
+    try {
+        std::vector<DDWAF_RET_CODE> codes(count, DDWAF_OK);
+        auto run_one = [&](std::size_t i) {
+            codes[i] = run_context(
+                *contexts[i], *data[i], results != nullptr ? &results[i] : nullptr, timeout);
+        };
+
+        auto [pool, pool_ref] = contexts[0]->run_pool();
+        if (pool != nullptr && count > 1) {
+            pool->parallel_for(count, run_one);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) { run_one(i); }
+        }
+
+        // Errors are negative and more severe the lower their value, they
+        // take precedence over matches which in turn take precedence over OK.
+        DDWAF_RET_CODE code = DDWAF_OK;
+        for (auto current : codes) {
+            if (current < DDWAF_OK ? current < code : code == DDWAF_OK) {
+                code = current;
+            }
+        }
+        return code;
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return DDWAF_ERR_INTERNAL;
+}
+
+DDWAF_RET_CODE ddwaf_run_chunk(ddwaf_context context, const char *address, const char *chunk,
+    size_t length, bool last, ddwaf_result *result, uint64_t timeout)
+{
+    if (result != nullptr) {
+        *result = {false, nullptr, {nullptr, 0}, 0};
+    }
+
+    if (context == nullptr || address == nullptr || (chunk == nullptr && length > 0)) {
+        DDWAF_WARN("Illegal WAF call: context, address or chunk was null");
+        return DDWAF_ERR_INVALID_ARGUMENT;
+    }
+
     try {
         optional_ref<ddwaf_result> res{std::nullopt};
         if (result != nullptr) {
             res = *result;
         }
 
-        return context->run(*data, res, timeout);
+        return context->run_chunk(address, {chunk, length}, last, res, timeout);
     } catch (const std::exception &e) {
         // catch-all to avoid std::terminate
         DDWAF_ERROR("%s", e.what());
@@ -193,6 +527,105 @@ DDWAF_RET_CODE ddwaf_run(
     return DDWAF_ERR_INTERNAL;
 }
 
+DDWAF_RET_CODE ddwaf_run_async(ddwaf_context context, ddwaf_object *data, uint64_t timeout,
+    ddwaf_run_cb callback, void *user_data)
+{
+    if (context == nullptr || data == nullptr || callback == nullptr) {
+        DDWAF_WARN("Illegal WAF call: context, data or callback was null");
+        return DDWAF_ERR_INVALID_ARGUMENT;
+    }
+
+    try {
+        auto task = [context, data, timeout, callback, user_data]() {
+            ddwaf_result result{false, nullptr, {nullptr, 0}, 0};
+            auto code = run_context(*context, *data, &result, timeout);
+            callback(code, &result, user_data);
+            ddwaf_result_free(&result);
+        };
+
+        // The task doesn't keep the pool alive, the pool is owned by the WAF
+        // instance and its destruction waits for all pending tasks.
+        auto [pool, pool_ref] = context->run_pool();
+        if (pool != nullptr) {
+            pool->push(std::move(task));
+        } else {
+            task();
+        }
+
+        return DDWAF_OK;
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return DDWAF_ERR_INTERNAL;
+}
+
+bool ddwaf_context_provide(
+    ddwaf_context context, const char *address, ddwaf_provider_cb provider, void *user_data)
+{
+    if (context == nullptr || address == nullptr || provider == nullptr) {
+        DDWAF_WARN("Illegal WAF call: context, address or provider was null");
+        return false;
+    }
+
+    try {
+        return context->provide(address,
+            [provider, user_data](ddwaf_object &object) { return provider(&object, user_data); });
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return false;
+}
+
+bool ddwaf_context_provide_raw(ddwaf_context context, const char *address, const char *raw,
+    size_t length, const char *content_type)
+{
+    if (context == nullptr || address == nullptr || (raw == nullptr && length > 0) ||
+        content_type == nullptr) {
+        DDWAF_WARN("Illegal WAF call: context, address, raw value or content type was null");
+        return false;
+    }
+
+    try {
+        return context->provide_raw(address, {raw, length}, content_type);
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return false;
+}
+
+bool ddwaf_context_diagnostics(ddwaf_context context, ddwaf_object *output)
+{
+    if (context == nullptr || output == nullptr) {
+        DDWAF_WARN("Illegal WAF call: context or output was null");
+        return false;
+    }
+
+    try {
+        return context->diagnostics(*output);
+    } catch (const std::exception &e) {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    ddwaf_object_free(output);
+    ddwaf_object_invalid(output);
+    return false;
+}
+
 void ddwaf_context_destroy(ddwaf_context context)
 {
     if (context == nullptr) {
@@ -218,6 +651,34 @@ bool ddwaf_set_log_cb(ddwaf_log_cb cb, DDWAF_LOG_LEVEL min_level)
     return true;
 }
 
+bool ddwaf_set_log_deferred(bool deferred)
+{
+    try {
+        ddwaf::logger::set_deferred(deferred);
+        if (!deferred) {
+            ddwaf::logger::drain(0);
+        }
+        return true;
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+    return false;
+}
+
+size_t ddwaf_log_drain(size_t max_messages)
+{
+    try {
+        return ddwaf::logger::drain(max_messages);
+    } catch (const std::exception &e) {
+        DDWAF_ERROR("%s", e.what());
+    } catch (...) {
+        DDWAF_ERROR("unknown exception");
+    }
+    return 0;
+}
+
 void ddwaf_result_free(ddwaf_result *result)
 {
     // NOLINTNEXTLINE
@@ -0,0 +1,344 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <exception.hpp>
+#include <json_loader.hpp>
+#include <string>
+#include <utils.hpp>
+
+#include <rapidjson/error/en.h>
+#include <rapidjson/reader.h>
+
+namespace ddwaf::json {
+
+namespace {
+
+// In-situ stream over a buffer which isn't necessarily NUL-terminated, the
+// end of the buffer is reported as a NUL character. Decoded strings are
+// always shorter than their encoded form, so writes never overtake reads.
+class bounded_insitu_stream {
+public:
+    using Ch = char;
+
+    bounded_insitu_stream(char *buffer, std::size_t size)
+        : begin_(buffer), src_(buffer), end_(buffer + size)
+    {}
+
+    [[nodiscard]] Ch Peek() const { return src_ < end_ ? *src_ : '\0'; }
+    Ch Take() { return src_ < end_ ? *src_++ : '\0'; }
+    [[nodiscard]] std::size_t Tell() const { return static_cast<std::size_t>(src_ - begin_); }
+
+    Ch *PutBegin() { return dst_ = src_; }
+    void Put(Ch c) { *dst_++ = c; }
+    void Flush() {}
+    std::size_t PutEnd(Ch *begin) { return static_cast<std::size_t>(dst_ - begin); }
+
+protected:
+    char *begin_;
+    char *src_;
+    char *end_;
+    char *dst_{nullptr};
+};
+
+// Decodes a percent-encoded form component in place, returning the decoded
+// length, the result is NUL-terminated. Invalid escape sequences are copied
+// verbatim.
+std::size_t decode_insitu(char *begin, char *end)
+{
+    auto length = percent_decode(begin, end, begin, true);
+    begin[length] = '\0';
+    return length;
+}
+
+} // namespace
+
+// SAX handler generating a ddwaf_object tree, values are accumulated in a
+// stack until their container is closed, at which point they are moved into
+// a single allocation owned by the tree. Values excluded by the parse options
+// are skipped, along with their children.
+class tree_builder : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, tree_builder> {
+public:
+    tree_builder(object_tree &tree, const parse_options &options) : tree_(tree), options_(options)
+    {}
+
+    bool Null() { return push(DDWAF_OBJ_INVALID); }
+    bool Bool(bool value)
+    {
+        auto *object = push_object(DDWAF_OBJ_BOOL);
+        if (object != nullptr) {
+            object->boolean = value;
+        }
+        return true;
+    }
+    bool Int(int value) { return Int64(value); }
+    bool Uint(unsigned value) { return Uint64(value); }
+    bool Int64(int64_t value)
+    {
+        auto *object = push_object(DDWAF_OBJ_SIGNED);
+        if (object != nullptr) {
+            object->intValue = value;
+        }
+        return true;
+    }
+    bool Uint64(uint64_t value)
+    {
+        auto *object = push_object(DDWAF_OBJ_UNSIGNED);
+        if (object != nullptr) {
+            object->uintValue = value;
+        }
+        return true;
+    }
+    // Floating point numbers can't be represented by ddwaf_object
+    bool Double(double /*value*/) { return push(DDWAF_OBJ_INVALID); }
+
+    bool String(const char *str, rapidjson::SizeType length, bool /*copy*/)
+    {
+        return String(str, static_cast<std::size_t>(length));
+    }
+
+    bool String(const char *str, std::size_t length)
+    {
+        auto *object = push_object(DDWAF_OBJ_STRING);
+        if (object != nullptr) {
+            object->stringValue = str;
+            object->nbEntries = length;
+        }
+        return true;
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool /*copy*/)
+    {
+        return Key(str, static_cast<std::size_t>(length));
+    }
+
+    bool Key(const char *str, std::size_t length)
+    {
+        key_ = str;
+        key_length_ = length;
+        return true;
+    }
+
+    bool StartObject() { return start(DDWAF_OBJ_MAP); }
+    bool EndObject(rapidjson::SizeType /*count*/) { return end(); }
+    bool StartArray() { return start(DDWAF_OBJ_ARRAY); }
+    bool EndArray(rapidjson::SizeType /*count*/) { return end(); }
+
+    void finalize()
+    {
+        if (values_.size() == 1) {
+            tree_.root_ = values_[0];
+        }
+    }
+
+protected:
+    enum class verdict { skip, keep, keep_filtered };
+
+    struct frame {
+        // Index of the first child within values_
+        std::size_t start;
+        // Number of children encountered, including those skipped
+        std::size_t count{0};
+        bool is_map;
+        // False if the container is deeper than the maximum depth
+        bool keep_children;
+        // Whether the children are subject to the key path restrictions
+        bool filtered;
+        // Whether the key of this container has been added to prefix_
+        bool in_prefix;
+    };
+
+    // Decides whether the next value should be generated, a value is filtered
+    // when it lies on a key path but isn't the last key of any of them.
+    verdict evaluate()
+    {
+        if (frames_.empty()) {
+            return options_.key_paths != nullptr ? verdict::keep_filtered : verdict::keep;
+        }
+
+        auto &parent = frames_.back();
+        if (parent.count++ >= options_.max_container_size || !parent.keep_children) {
+            return verdict::skip;
+        }
+
+        if (!parent.filtered) {
+            return verdict::keep;
+        }
+
+        if (!parent.is_map || key_ == nullptr) {
+            return verdict::skip;
+        }
+
+        // Paths are ordered, so the first path not lower than the current one
+        // is the only candidate for having it as a prefix.
+        prefix_.emplace_back(key_, key_length_);
+        const auto &paths = *options_.key_paths;
+        auto it = paths.lower_bound(prefix_);
+
+        verdict result = verdict::skip;
+        if (it != paths.end() && it->size() >= prefix_.size() &&
+            std::equal(prefix_.begin(), prefix_.end(), it->begin())) {
+            result = it->size() == prefix_.size() ? verdict::keep : verdict::keep_filtered;
+        }
+        prefix_.pop_back();
+
+        return result;
+    }
+
+    void skip()
+    {
+        key_ = nullptr;
+        key_length_ = 0;
+    }
+
+    ddwaf_object *push_object(DDWAF_OBJ_TYPE type)
+    {
+        // Scalars can't contain the rest of a key path
+        if (skip_depth_ > 0 || evaluate() != verdict::keep) {
+            skip();
+            return nullptr;
+        }
+        return &emplace_object(type);
+    }
+
+    ddwaf_object &emplace_object(DDWAF_OBJ_TYPE type)
+    {
+        ddwaf_object object;
+        object.parameterName = key_;
+        object.parameterNameLength = key_length_;
+        object.uintValue = 0;
+        object.nbEntries = 0;
+        object.type = type;
+
+        skip();
+
+        return values_.emplace_back(object);
+    }
+
+    bool push(DDWAF_OBJ_TYPE type)
+    {
+        push_object(type);
+        return true;
+    }
+
+    bool start(DDWAF_OBJ_TYPE type)
+    {
+        if (skip_depth_ > 0) {
+            ++skip_depth_;
+            return true;
+        }
+
+        auto result = evaluate();
+        if (result == verdict::skip) {
+            skip();
+            skip_depth_ = 1;
+            return true;
+        }
+
+        bool in_prefix = false;
+        if (result == verdict::keep_filtered && !frames_.empty()) {
+            prefix_.emplace_back(key_, key_length_);
+            in_prefix = true;
+        }
+
+        emplace_object(type).array = nullptr;
+
+        // The root container is at depth 1
+        const bool keep_children = frames_.size() < options_.max_depth;
+        frames_.push_back({values_.size(), 0, type == DDWAF_OBJ_MAP, keep_children,
+            result == verdict::keep_filtered, in_prefix});
+        return true;
+    }
+
+    bool end()
+    {
+        if (skip_depth_ > 0) {
+            --skip_depth_;
+            return true;
+        }
+
+        auto current = frames_.back();
+        frames_.pop_back();
+        if (current.in_prefix) {
+            prefix_.pop_back();
+        }
+
+        auto start = current.start;
+        auto count = values_.size() - start;
+        auto &container = values_[start - 1];
+        if (count > 0) {
+            auto &children = tree_.containers_.emplace_back(new ddwaf_object[count]);
+            std::copy(values_.begin() + static_cast<std::ptrdiff_t>(start), values_.end(),
+                children.get());
+            container.array = children.get();
+            container.nbEntries = count;
+            values_.resize(start);
+        }
+        return true;
+    }
+
+    object_tree &tree_;
+    const parse_options &options_;
+    std::vector<ddwaf_object> values_;
+    std::vector<frame> frames_;
+    std::vector<std::string> prefix_;
+    std::size_t skip_depth_{0};
+    const char *key_{nullptr};
+    std::size_t key_length_{0};
+};
+
+object_tree parse_insitu(char *buffer, std::size_t size, const parse_options &options)
+{
+    object_tree tree;
+    tree_builder builder(tree, options);
+    bounded_insitu_stream stream(buffer, size);
+
+    rapidjson::Reader reader;
+    auto result = reader.Parse<rapidjson::kParseInsituFlag | rapidjson::kParseIterativeFlag>(
+        stream, builder);
+    if (result.IsError()) {
+        throw parsing_error(std::string("invalid json: ") +
+                            rapidjson::GetParseError_En(result.Code()) + " at offset " +
+                            std::to_string(result.Offset()));
+    }
+
+    builder.finalize();
+    return tree;
+}
+
+object_tree parse_form_insitu(char *buffer, std::size_t size, const parse_options &options)
+{
+    object_tree tree;
+    tree_builder builder(tree, options);
+
+    builder.StartObject();
+
+    char *end = buffer + size;
+    for (char *pair = buffer; pair < end;) {
+        char *pair_end = std::find(pair, end, '&');
+        char *separator = std::find(pair, pair_end, '=');
+
+        // Empty pairs, e.g. a&&b, are ignored
+        if (pair != pair_end) {
+            char *key = pair;
+            auto key_length = decode_insitu(key, separator);
+
+            char *value = separator < pair_end ? separator + 1 : pair_end;
+            auto value_length = decode_insitu(value, pair_end);
+
+            builder.Key(key, key_length);
+            builder.String(value, value_length);
+        }
+
+        pair = pair_end + 1;
+    }
+
+    builder.EndObject(0);
+    builder.finalize();
+    return tree;
+}
+
+} // namespace ddwaf::json
@@ -0,0 +1,64 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <ddwaf.h>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ddwaf::json {
+
+// Object tree generated from a JSON document parsed in place. Strings and
+// keys reference the original buffer, which must outlive the tree, while
+// containers are owned by the tree itself.
+class object_tree {
+public:
+    object_tree() = default;
+    ~object_tree() = default;
+    object_tree(const object_tree &) = delete;
+    object_tree(object_tree &&) = default;
+    object_tree &operator=(const object_tree &) = delete;
+    object_tree &operator=(object_tree &&) = default;
+
+    [[nodiscard]] const ddwaf_object &root() const { return root_; }
+
+protected:
+    friend class tree_builder;
+
+    ddwaf_object root_{};
+    std::vector<std::unique_ptr<ddwaf_object[]>> containers_;
+};
+
+// Restrictions on the parts of a document materialised in the object tree,
+// the whole document is still parsed and validated.
+struct parse_options {
+    // Containers nested deeper than max_depth, with the root at depth 1, are
+    // generated without their children.
+    std::size_t max_depth{std::numeric_limits<std::size_t>::max()};
+    // Children of a container after the first max_container_size are dropped.
+    std::size_t max_container_size{std::numeric_limits<std::size_t>::max()};
+    // If not null, only the values found under any of these map key paths,
+    // and the containers leading to them, are retained.
+    const std::set<std::vector<std::string>> *key_paths{nullptr};
+};
+
+// Parses the JSON document contained in the buffer, which is modified in the
+// process, throws parsing_error if the document is invalid. The buffer
+// doesn't need to be NUL-terminated.
+object_tree parse_insitu(char *buffer, std::size_t size, const parse_options &options = {});
+
+// Parses an application/x-www-form-urlencoded string into a map, keys and
+// values are decoded and NUL-terminated within the buffer, which must be
+// followed by at least one writable byte. Repeated keys result in multiple
+// entries with the same key.
+object_tree parse_form_insitu(char *buffer, std::size_t size, const parse_options &options = {});
+
+} // namespace ddwaf::json
@@ -0,0 +1,101 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+
+#include <key_paths.hpp>
+#include <ruleset.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+void insert_conditions(key_path_map &interest, const std::vector<condition::ptr> &conditions)
+{
+    for (const auto &cond : conditions) {
+        for (const auto &target : cond->get_targets()) {
+            auto &entry = interest[target.name];
+            if (entry.full) {
+                continue;
+            }
+
+            if (target.key_path.empty()) {
+                entry.full = true;
+                entry.paths.clear();
+            } else {
+                entry.paths.emplace(target.key_path);
+            }
+        }
+    }
+}
+
+bool is_prefix(const std::vector<std::string> &prefix, const std::vector<std::string> &path)
+{
+    return prefix.size() <= path.size() && std::equal(prefix.begin(), prefix.end(), path.begin());
+}
+
+} // namespace
+
+key_path_map collect_key_paths(const ruleset &rs)
+{
+    key_path_map interest;
+
+    for (const auto &[id, rule] : rs.rules) {
+        if (rule->is_enabled()) {
+            insert_conditions(interest, rule->conditions);
+        }
+    }
+
+    for (const auto &[id, filter] : rs.rule_filters) {
+        insert_conditions(interest, filter->get_conditions());
+    }
+
+    for (const auto &[id, filter] : rs.input_filters) {
+        insert_conditions(interest, filter->get_conditions());
+    }
+
+    // Paths are ordered lexicographically, so all the paths having another one
+    // as a prefix are found immediately after it.
+    for (auto &[address, entry] : interest) {
+        auto &paths = entry.paths;
+        auto it = paths.begin();
+        while (it != paths.end()) {
+            auto next = std::next(it);
+            while (next != paths.end() && is_prefix(*it, *next)) { next = paths.erase(next); }
+            it = next;
+        }
+    }
+
+    return interest;
+}
+
+void key_paths_to_object(const key_path_map &interest, ddwaf_object &output)
+{
+    ddwaf_object_map(&output);
+
+    for (const auto &[address, entry] : interest) {
+        ddwaf_object tmp;
+        ddwaf_object paths;
+        ddwaf_object_array(&paths);
+        for (const auto &path : entry.paths) {
+            ddwaf_object keys;
+            ddwaf_object_array(&keys);
+            for (const auto &key : path) {
+                ddwaf_object_array_add(&keys, ddwaf_object_stringl(&tmp, key.c_str(), key.size()));
+            }
+            ddwaf_object_array_add(&paths, &keys);
+        }
+
+        ddwaf_object value;
+        ddwaf_object_map(&value);
+        ddwaf_object_map_add(&value, "full", ddwaf_object_bool(&tmp, entry.full));
+        ddwaf_object_map_add(&value, "key_paths", &paths);
+
+        ddwaf_object_map_addl(&output, address.c_str(), address.size(), &value);
+    }
+}
+
+} // namespace ddwaf
@@ -0,0 +1,39 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ddwaf.h>
+
+namespace ddwaf {
+
+struct ruleset;
+
+// Subset of an address referenced by the conditions of a ruleset. When full
+// is true, the entire address is required and paths is always empty,
+// otherwise paths contains the minimal set of key paths required, i.e. no
+// path is a prefix of another.
+struct key_path_interest {
+    bool full{false};
+    std::set<std::vector<std::string>> paths;
+};
+
+using key_path_map = std::map<std::string, key_path_interest>;
+
+// Collects the key paths referenced by enabled rules, rule filters and input
+// filters. Object filters only remove data from evaluation, so they never
+// broaden the set of required paths.
+key_path_map collect_key_paths(const ruleset &rs);
+
+// Generates an object of the form {address: {full: bool, key_paths: [[key, ...], ...]}}
+void key_paths_to_object(const key_path_map &interest, ddwaf_object &output);
+
+} // namespace ddwaf
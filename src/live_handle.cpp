@@ -0,0 +1,66 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <live_handle.hpp>
+#include <ruleset_ref.hpp>
+#include <thread>
+
+namespace ddwaf {
+
+live_handle::~live_handle()
+{
+    // No readers can be active at this point
+    delete current_.load();
+}
+
+context *live_handle::create_context()
+{
+    auto &current = shards_[thread_shard_index(shard_count)];
+    auto epoch = epoch_.load() & 1U;
+
+    current.readers[epoch].fetch_add(1);
+
+    struct guard {
+        std::atomic<uint64_t> &counter;
+        ~guard() { counter.fetch_sub(1, std::memory_order_release); }
+    } exit_guard{current.readers[epoch]};
+
+    return new context{current_.load()->create_context()};
+}
+
+bool live_handle::update(parameter input, ruleset_info &info)
+{
+    const std::lock_guard<std::mutex> lock(update_mtx_);
+
+    waf *new_instance = current_.load()->update(input, info);
+    if (new_instance == nullptr) {
+        return false;
+    }
+
+    waf *old_instance = current_.exchange(new_instance);
+    synchronize();
+    delete old_instance;
+
+    return true;
+}
+
+void live_handle::synchronize()
+{
+    // Readers which loaded the epoch before the flip might register on the
+    // old counters after they have been observed as drained, those readers
+    // are guaranteed to see the new instance but they might still be in
+    // flight on the next update, hence the epoch is flipped twice.
+    for (unsigned i = 0; i < 2; ++i) {
+        auto previous = epoch_.fetch_add(1) & 1U;
+        for (auto &current : shards_) {
+            while (current.readers[previous].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+} // namespace ddwaf
@@ -0,0 +1,57 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <waf.hpp>
+
+namespace ddwaf {
+
+// Handle which atomically publishes new WAF instances, RCU-style.
+//
+// Readers (context creation) never block: they register themselves on a
+// per-thread shard of in-flight counters, load the current instance and
+// copy its ruleset into the new context. Writers (updates) are serialised,
+// publish the new instance and wait for a grace period, i.e. until all
+// readers which could have observed the previous instance have completed,
+// before destroying it. Rulesets themselves are reference counted, so they
+// remain alive until the last context using them is destroyed.
+class live_handle {
+public:
+    explicit live_handle(waf *instance) : current_(instance) {}
+    ~live_handle();
+
+    live_handle(const live_handle &) = delete;
+    live_handle(live_handle &&) = delete;
+    live_handle &operator=(const live_handle &) = delete;
+    live_handle &operator=(live_handle &&) = delete;
+
+    // Returns false if the update didn't result in a new instance
+    bool update(parameter input, ruleset_info &info);
+
+    context *create_context();
+
+protected:
+    static constexpr std::size_t shard_count = 32;
+
+    struct alignas(64) shard {
+        std::array<std::atomic<uint64_t>, 2> readers{};
+    };
+
+    void synchronize();
+
+    std::atomic<waf *> current_;
+    std::atomic<unsigned> epoch_{0};
+    std::array<shard, shard_count> shards_{};
+    std::mutex update_mtx_;
+};
+
+} // namespace ddwaf
@@ -12,6 +12,7 @@ namespace ddwaf {
 
 ddwaf_log_cb logger::cb = nullptr;
 DDWAF_LOG_LEVEL logger::min_level = DDWAF_LOG_OFF;
+std::atomic<bool> logger::deferred_mode{false};
 
 void logger::init(ddwaf_log_cb cb, DDWAF_LOG_LEVEL min_level)
 {
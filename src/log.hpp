@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cinttypes>
 #include <ddwaf.h>
+#include <log_ring.hpp>
 #include <string>
 #include <type_traits>
 
@@ -53,14 +55,18 @@ constexpr const char *base_name(const char *path)
     {                                                                                              \
       if (ddwaf::logger::valid(level)) {                                                           \
         constexpr const char *filename = base_name(file);                                          \
-        int _bytes = snprintf(nullptr, 0, fmt, ##__VA_ARGS__);                                     \
-        if (_bytes > 0) {                                                                          \
-          size_t bytes = (size_t)_bytes;                                                           \
-          char *message = (char *)malloc(bytes + 1);                                               \
-          if (message != nullptr) {                                                                \
-            snprintf(message, bytes + 1, fmt, ##__VA_ARGS__);                                      \
-            ddwaf::logger::log(level, function, filename, line, message, bytes);                   \
-            free((void *)message);                                                                 \
+        if (ddwaf::logger::deferred()) {                                                           \
+          ddwaf::log_ring::push(level, function, filename, line, fmt, ##__VA_ARGS__);              \
+        } else {                                                                                   \
+          int _bytes = snprintf(nullptr, 0, fmt, ##__VA_ARGS__);                                   \
+          if (_bytes > 0) {                                                                        \
+            size_t bytes = (size_t)_bytes;                                                         \
+            char *message = (char *)malloc(bytes + 1);                                             \
+            if (message != nullptr) {                                                              \
+              snprintf(message, bytes + 1, fmt, ##__VA_ARGS__);                                    \
+              ddwaf::logger::log(level, function, filename, line, message, bytes);                 \
+              free((void *)message);                                                               \
+            }                                                                                      \
           }                                                                                        \
         }                                                                                          \
       }                                                                                            \
@@ -102,12 +108,20 @@ class logger {
 public:
     static void init(ddwaf_log_cb cb, DDWAF_LOG_LEVEL min_level);
     static bool valid(DDWAF_LOG_LEVEL level) { return cb != nullptr && level >= min_level; }
+
+    // In deferred mode, log records are stored in a per-thread ring buffer
+    // and only formatted and relayed to the callback on drain.
+    static void set_deferred(bool value) { deferred_mode.store(value, std::memory_order_relaxed); }
+    static bool deferred() { return deferred_mode.load(std::memory_order_relaxed); }
+    static std::size_t drain(std::size_t max_records) { return log_ring::drain(cb, max_records); }
+
     static void log(DDWAF_LOG_LEVEL level, const char *function, const char *file, unsigned line,
         const char *message, size_t length);
 
 private:
     static ddwaf_log_cb cb;
     static DDWAF_LOG_LEVEL min_level;
+    static std::atomic<bool> deferred_mode;
 };
 
 } // namespace ddwaf
@@ -0,0 +1,143 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <log_ring.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+// Rings are shared between the owning thread and the registry, so that
+// records pushed by a thread which has since exited can still be drained.
+struct registry {
+    std::mutex mtx;
+    std::vector<std::shared_ptr<log_ring>> rings;
+};
+
+registry &get_registry()
+{
+    // Intentionally leaked, thread-local destructors might run after static ones
+    static auto *instance = new registry();
+    return *instance;
+}
+
+std::mutex &drain_mutex()
+{
+    static std::mutex mtx;
+    return mtx;
+}
+
+} // namespace
+
+log_ring &log_ring::local()
+{
+    thread_local std::shared_ptr<log_ring> ring;
+    if (!ring) {
+        ring = std::make_shared<log_ring>();
+
+        auto &reg = get_registry();
+        const std::lock_guard<std::mutex> lock(reg.mtx);
+        reg.rings.emplace_back(ring);
+    }
+    return *ring;
+}
+
+std::size_t log_ring::consume(ddwaf_log_cb cb, std::size_t max_records)
+{
+    std::array<char, 512> buffer{};
+    std::string message;
+
+    std::size_t relayed = 0;
+    auto tail = tail_.load(std::memory_order_relaxed);
+    const auto head = head_.load(std::memory_order_acquire);
+    for (; tail != head && relayed < max_records; ++tail, ++relayed) {
+        const auto &current = records_[tail % capacity];
+
+        int bytes =
+            current.format(current.fmt, current.payload.data(), buffer.data(), buffer.size());
+        if (bytes < 0) {
+            continue;
+        }
+
+        const char *data = buffer.data();
+        auto length = static_cast<std::size_t>(bytes);
+        if (length >= buffer.size()) {
+            message.resize(length);
+            current.format(current.fmt, current.payload.data(), message.data(), length + 1);
+            data = message.data();
+        }
+
+        cb(current.level, current.function, current.file, current.line, data, length);
+    }
+
+    // The slots can only be reused by the producer once fully consumed
+    tail_.store(tail, std::memory_order_release);
+
+    auto dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        int bytes = snprintf(buffer.data(), buffer.size(),
+            "%" PRIu64 " log records dropped, the log buffer was full", dropped);
+        if (bytes > 0) {
+            cb(DDWAF_LOG_WARN, __func__, "log_ring.cpp", __LINE__, buffer.data(),
+                std::min(static_cast<std::size_t>(bytes), buffer.size() - 1));
+        }
+    }
+
+    return relayed;
+}
+
+std::size_t log_ring::drain(ddwaf_log_cb cb, std::size_t max_records)
+{
+    if (cb == nullptr) {
+        return 0;
+    }
+
+    if (max_records == 0) {
+        max_records = static_cast<std::size_t>(-1);
+    }
+
+    const std::lock_guard<std::mutex> drain_lock(drain_mutex());
+
+    std::vector<std::shared_ptr<log_ring>> rings;
+    {
+        auto &reg = get_registry();
+        const std::lock_guard<std::mutex> lock(reg.mtx);
+        rings = reg.rings;
+    }
+
+    std::size_t relayed = 0;
+    for (const auto &ring : rings) {
+        if (relayed >= max_records) {
+            break;
+        }
+        relayed += ring->consume(cb, max_records - relayed);
+    }
+    rings.clear();
+
+    // Release the rings of threads which have exited once they're empty
+    auto &reg = get_registry();
+    const std::lock_guard<std::mutex> lock(reg.mtx);
+    for (auto it = reg.rings.begin(); it != reg.rings.end();) {
+        const auto &ring = *it;
+        if (ring.use_count() == 1 && ring->head_.load(std::memory_order_acquire) ==
+                                         ring->tail_.load(std::memory_order_relaxed)) {
+            it = reg.rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    return relayed;
+}
+
+} // namespace ddwaf
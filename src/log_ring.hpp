@@ -0,0 +1,278 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include <ddwaf.h>
+
+namespace ddwaf {
+
+namespace log_detail {
+
+template <typename T>
+constexpr bool is_string_v = std::is_same_v<T, const char *> || std::is_same_v<T, char *>;
+
+constexpr uint16_t null_string = UINT16_MAX;
+
+// Strings are stored as a length, followed by the characters and a null
+// terminator, everything else is stored as is.
+template <typename T> constexpr std::size_t fixed_size()
+{
+    static_assert(std::is_trivially_copyable_v<T>, "unsupported log argument");
+    if constexpr (is_string_v<T>) {
+        return sizeof(uint16_t) + 1;
+    } else {
+        return sizeof(T);
+    }
+}
+
+// Tracks the conversions of a format string as its arguments are written, in
+// order to identify the width and precision provided as arguments.
+class format_cursor {
+public:
+    enum class role : uint8_t { value, width, precision };
+
+    explicit format_cursor(const char *fmt) : fmt_(fmt) {}
+
+    // Role of the next argument consumed by the format string
+    role next()
+    {
+        if (!in_conversion_) {
+            parse();
+        }
+
+        if (width_) {
+            width_ = false;
+            return role::width;
+        }
+
+        if (precision_) {
+            precision_ = false;
+            return role::precision;
+        }
+
+        in_conversion_ = false;
+        return role::value;
+    }
+
+protected:
+    // Advances to the next conversion, past its flags, width and precision
+    void parse()
+    {
+        in_conversion_ = true;
+        while (*fmt_ != '\0') {
+            if (*fmt_++ != '%') {
+                continue;
+            }
+
+            if (*fmt_ == '%') {
+                ++fmt_;
+                continue;
+            }
+
+            while (*fmt_ != '\0' && strchr("-+ #0", *fmt_) != nullptr) { ++fmt_; }
+
+            width_ = *fmt_ == '*';
+            skip_number();
+
+            if (*fmt_ == '.') {
+                ++fmt_;
+                precision_ = *fmt_ == '*';
+                skip_number();
+            }
+            return;
+        }
+    }
+
+    void skip_number()
+    {
+        if (*fmt_ == '*') {
+            ++fmt_;
+            return;
+        }
+        while (*fmt_ >= '0' && *fmt_ <= '9') { ++fmt_; }
+    }
+
+    const char *fmt_;
+    bool in_conversion_{false};
+    bool width_{false};
+    bool precision_{false};
+};
+
+inline void write_args(
+    format_cursor & /*cursor*/, int /*precision*/, char * /*pos*/, std::size_t /*available*/)
+{}
+
+// The precision is that of the current argument if provided as the previous
+// one, or negative otherwise.
+template <typename T, typename... Rest>
+void write_args(format_cursor &cursor, int precision, char *pos, std::size_t available,
+    const T &value, const Rest &...rest)
+{
+    const auto role = cursor.next();
+    int next_precision = -1;
+    std::size_t used = 0;
+    if constexpr (is_string_v<T>) {
+        // Strings are truncated to leave enough space for the rest of the
+        // arguments, as their lifetime can't be guaranteed until formatting.
+        constexpr std::size_t reserved = fixed_size<T>() + (fixed_size<Rest>() + ... + 0);
+        uint16_t length = null_string;
+        if (value != nullptr) {
+            std::size_t limit = std::min(available - reserved, std::size_t{null_string - 1});
+            // Strings with a precision aren't necessarily null-terminated
+            if (role == format_cursor::role::value && precision >= 0) {
+                limit = std::min(limit, static_cast<std::size_t>(precision));
+            }
+
+            const auto *end = static_cast<const char *>(memchr(value, '\0', limit));
+            length = static_cast<uint16_t>(end != nullptr ? end - value : limit);
+            memcpy(pos + sizeof(uint16_t), value, length);
+            pos[sizeof(uint16_t) + length] = '\0';
+            used = length;
+        }
+        memcpy(pos, &length, sizeof(uint16_t));
+        used += fixed_size<T>();
+    } else {
+        if constexpr (std::is_integral_v<T>) {
+            if (role == format_cursor::role::precision) {
+                next_precision = static_cast<int>(value);
+            }
+        }
+        memcpy(pos, &value, sizeof(T));
+        used = sizeof(T);
+    }
+    write_args(cursor, next_precision, pos + used, available - used, rest...);
+}
+
+template <typename T> T read_arg(const char *&pos)
+{
+    if constexpr (is_string_v<T>) {
+        uint16_t length;
+        memcpy(&length, pos, sizeof(uint16_t));
+        pos += sizeof(uint16_t);
+        if (length == null_string) {
+            pos += 1;
+            return "(null)";
+        }
+
+        const char *value = pos;
+        pos += length + 1;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        return const_cast<T>(value);
+    } else {
+        T value;
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+}
+
+template <typename... Args>
+int format(const char *fmt, const char *payload, char *buffer, std::size_t size)
+{
+    const char *pos = payload;
+    // Brace initialisation guarantees the order in which arguments are read
+    std::tuple<Args...> args{read_arg<Args>(pos)...};
+    (void)pos;
+    return std::apply(
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+        [&](const auto &...values) { return snprintf(buffer, size, fmt, values...); }, args);
+}
+
+} // namespace log_detail
+
+// Per-thread single-producer single-consumer ring of log records, the format
+// string and raw arguments of each record are stored as is and only formatted
+// when the records are drained. When the ring is full, new records are
+// dropped and accounted for.
+class log_ring {
+public:
+    static constexpr std::size_t capacity = 256;
+    static constexpr std::size_t payload_size = 216;
+
+    using format_fn = int (*)(const char *fmt, const char *payload, char *buffer, std::size_t size);
+
+    struct record {
+        DDWAF_LOG_LEVEL level;
+        unsigned line;
+        const char *function;
+        const char *file;
+        const char *fmt;
+        format_fn format;
+        std::array<char, payload_size> payload;
+    };
+
+    log_ring() = default;
+    ~log_ring() = default;
+    log_ring(const log_ring &) = delete;
+    log_ring &operator=(const log_ring &) = delete;
+    log_ring(log_ring &&) = delete;
+    log_ring &operator=(log_ring &&) = delete;
+
+    // The function, file and format must have static storage duration
+    template <typename... Args>
+    static void push(DDWAF_LOG_LEVEL level, const char *function, const char *file,
+        unsigned line, const char *fmt, Args... args)
+    {
+        static_assert((log_detail::fixed_size<Args>() + ... + 0) <= payload_size,
+            "too many log arguments");
+
+        auto &ring = local();
+        auto *slot = ring.reserve();
+        if (slot == nullptr) {
+            return;
+        }
+
+        *slot = {level, line, function, file, fmt, &log_detail::format<Args...>, {}};
+        log_detail::format_cursor cursor{fmt};
+        log_detail::write_args(cursor, -1, slot->payload.data(), payload_size, args...);
+        ring.commit();
+    }
+
+    // Formats and relays the records of every thread to the callback, in
+    // order for each thread, up to max_records if not zero. Returns the number
+    // of records relayed, dropped records are reported through an additional
+    // warning.
+    static std::size_t drain(ddwaf_log_cb cb, std::size_t max_records = 0);
+
+protected:
+    static log_ring &local();
+
+    record *reserve()
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == capacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &records_[head % capacity];
+    }
+
+    void commit()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Formats and relays the pending records, up to max_records, returns the
+    // number of records relayed.
+    std::size_t consume(ddwaf_log_cb cb, std::size_t max_records);
+
+    std::array<record, capacity> records_{};
+    std::atomic<std::size_t> head_{0};
+    std::atomic<std::size_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace ddwaf
@@ -0,0 +1,89 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <cerrno>
+#include <cstring>
+#include <exception.hpp>
+#include <mapped_file.hpp>
+#include <string>
+
+#ifdef _WIN32
+#  include <fstream>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace ddwaf {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const char *path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw file_error(std::string("unable to open ") + path);
+    }
+
+    auto size = file.tellg();
+    if (size < 0) {
+        throw file_error(std::string("unable to read ") + path);
+    }
+
+    buffer_.resize(static_cast<std::size_t>(size));
+    file.seekg(0);
+    if (!file.read(buffer_.data(), size)) {
+        throw file_error(std::string("unable to read ") + path);
+    }
+
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+mapped_file::~mapped_file() = default;
+
+#else
+
+mapped_file::mapped_file(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw file_error(std::string("unable to open ") + path + ": " + strerror(errno));
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw file_error(std::string("unable to stat ") + path + ": " + strerror(errno));
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+        // The mapping is private and writable so that the contents can be
+        // parsed in place without modifying the underlying file.
+        void *ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            throw file_error(std::string("unable to map ") + path + ": " + strerror(errno));
+        }
+        data_ = static_cast<char *>(ptr);
+    }
+
+    close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+#endif
+
+} // namespace ddwaf
@@ -0,0 +1,38 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ddwaf {
+
+// Read-write private view of a file, changes are never written back to the
+// file itself. On POSIX systems the file is memory-mapped, so pages are only
+// loaded as they're accessed, otherwise the contents are read into memory.
+class mapped_file {
+public:
+    explicit mapped_file(const char *path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file(mapped_file &&) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    mapped_file &operator=(mapped_file &&) = delete;
+
+    [[nodiscard]] char *data() { return data_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+protected:
+    char *data_{nullptr};
+    std::size_t size_{0};
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
+
+} // namespace ddwaf
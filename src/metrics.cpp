@@ -0,0 +1,224 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <array>
+#include <map>
+
+#include <metrics.hpp>
+#include <ruleset.hpp>
+
+namespace ddwaf {
+
+namespace {
+
+// Counters are only written by a single thread, so a read-modify-write
+// operation isn't required.
+void add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct totals {
+    uint64_t calls{0};
+    uint64_t total_ns{0};
+    uint64_t max_ns{0};
+    uint64_t strings{0};
+    uint64_t bytes{0};
+    uint64_t matches{0};
+
+    totals &operator+=(const totals &other)
+    {
+        calls += other.calls;
+        total_ns += other.total_ns;
+        max_ns = std::max(max_ns, other.max_ns);
+        strings += other.strings;
+        bytes += other.bytes;
+        matches += other.matches;
+        return *this;
+    }
+};
+
+void totals_to_object(const totals &value, ddwaf_object &output)
+{
+    ddwaf_object tmp;
+    ddwaf_object_map_add(&output, "calls", ddwaf_object_unsigned_force(&tmp, value.calls));
+    ddwaf_object_map_add(&output, "total_ns", ddwaf_object_unsigned_force(&tmp, value.total_ns));
+    ddwaf_object_map_add(&output, "max_ns", ddwaf_object_unsigned_force(&tmp, value.max_ns));
+    ddwaf_object_map_add(&output, "strings", ddwaf_object_unsigned_force(&tmp, value.strings));
+    ddwaf_object_map_add(&output, "bytes", ddwaf_object_unsigned_force(&tmp, value.bytes));
+    ddwaf_object_map_add(&output, "matches", ddwaf_object_unsigned_force(&tmp, value.matches));
+}
+
+} // namespace
+
+void metrics::shard::record(std::size_t index, uint64_t ns, const match_stats &stats)
+{
+    auto &entry = counters_[index];
+    add(entry.calls, 1);
+    add(entry.total_ns, ns);
+    add(entry.strings, stats.strings);
+    add(entry.bytes, stats.bytes);
+    add(entry.matches, stats.matches);
+    if (ns > entry.max_ns.load(std::memory_order_relaxed)) {
+        entry.max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+metrics::metrics(const std::unordered_map<std::string_view, std::shared_ptr<rule>> &rules)
+{
+    static std::atomic<uint64_t> next_id{1};
+    id_ = next_id++;
+
+    for (const auto &[id, rule] : rules) {
+        index_.emplace(rule.get(), entities_.size());
+        entities_.push_back({rule.get(), npos});
+
+        for (std::size_t i = 0; i < rule->conditions.size(); ++i) {
+            index_.emplace(rule->conditions[i].get(), entities_.size());
+            entities_.push_back({rule.get(), i});
+        }
+    }
+}
+
+metrics::shard &metrics::local_shard()
+{
+    // A few shards are cached per thread, so that threads alternating
+    // between instances, e.g. during an update, don't take the lock on every
+    // call. Identifiers are never reused, so entries of instances which no
+    // longer exist are never matched.
+    struct cache_entry {
+        uint64_t id{0};
+        shard *local{nullptr};
+    };
+    thread_local std::array<cache_entry, 4> cache{};
+    thread_local std::size_t next_entry{0};
+
+    for (const auto &entry : cache) {
+        if (entry.id == id_) {
+            return *entry.local;
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(mtx_);
+    auto &local = shards_[std::this_thread::get_id()];
+    if (!local) {
+        local = std::make_unique<shard>(entities_.size());
+    }
+
+    cache[next_entry] = {id_, local.get()};
+    next_entry = (next_entry + 1) % cache.size();
+    return *local;
+}
+
+void metrics::to_object(const ruleset &rs, ddwaf_object &output)
+{
+    std::vector<totals> merged(entities_.size());
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        for (const auto &[thread_id, local] : shards_) {
+            for (std::size_t i = 0; i < entities_.size(); ++i) {
+                const auto &entry = (*local)[i];
+                merged[i] += {entry.calls.load(std::memory_order_relaxed),
+                    entry.total_ns.load(std::memory_order_relaxed),
+                    entry.max_ns.load(std::memory_order_relaxed),
+                    entry.strings.load(std::memory_order_relaxed),
+                    entry.bytes.load(std::memory_order_relaxed),
+                    entry.matches.load(std::memory_order_relaxed)};
+            }
+        }
+    }
+
+    ddwaf_object rules;
+    ddwaf_object_map(&rules);
+    std::map<std::string_view, totals> processors;
+
+    // Conditions always follow their rule, so the rule object is completed
+    // before moving on to the next one.
+    ddwaf_object rule_object;
+    ddwaf_object conditions;
+    const rule *current = nullptr;
+    auto flush = [&]() {
+        if (current != nullptr) {
+            ddwaf_object_map_add(&rule_object, "conditions", &conditions);
+            ddwaf_object_map_addl(&rules, current->id.c_str(), current->id.size(), &rule_object);
+        }
+    };
+
+    for (std::size_t i = 0; i < entities_.size(); ++i) {
+        const auto &[parent, position] = entities_[i];
+        if (position == npos) {
+            flush();
+            current = parent;
+            ddwaf_object_map(&rule_object);
+            ddwaf_object_array(&conditions);
+            totals_to_object(merged[i], rule_object);
+            continue;
+        }
+
+        ddwaf_object condition_object;
+        ddwaf_object_map(&condition_object);
+
+        std::string_view name{""};
+        const auto &processor = parent->conditions[position]->get_processor(rs.dynamic_processors);
+        if (processor) {
+            name = processor->name();
+            processors[name] += merged[i];
+        }
+
+        ddwaf_object tmp;
+        ddwaf_object_map_add(
+            &condition_object, "processor", ddwaf_object_stringl(&tmp, name.data(), name.size()));
+        totals_to_object(merged[i], condition_object);
+        ddwaf_object_array_add(&conditions, &condition_object);
+    }
+    flush();
+
+    ddwaf_object processor_map;
+    ddwaf_object_map(&processor_map);
+    for (const auto &[name, value] : processors) {
+        ddwaf_object processor_object;
+        ddwaf_object_map(&processor_object);
+        totals_to_object(value, processor_object);
+        ddwaf_object_map_addl(&processor_map, name.data(), name.size(), &processor_object);
+    }
+
+    ddwaf_object_map(&output);
+    ddwaf_object_map_add(&output, "rules", &rules);
+    ddwaf_object_map_add(&output, "processors", &processor_map);
+}
+
+std::unordered_map<std::string_view, metrics::rule_sample> metrics::rule_samples()
+{
+    std::unordered_map<std::string_view, rule_sample> samples;
+
+    const std::lock_guard<std::mutex> lock(mtx_);
+    rule_sample *current = nullptr;
+    for (std::size_t i = 0; i < entities_.size(); ++i) {
+        const auto &[parent, position] = entities_[i];
+
+        sample value;
+        for (const auto &[thread_id, local] : shards_) {
+            const auto &entry = (*local)[i];
+            value.calls += entry.calls.load(std::memory_order_relaxed);
+            value.total_ns += entry.total_ns.load(std::memory_order_relaxed);
+            value.matches += entry.matches.load(std::memory_order_relaxed);
+        }
+
+        // Conditions always follow their rule
+        if (position == npos) {
+            current = &samples[parent->id];
+            static_cast<sample &>(*current) = value;
+            current->conditions.reserve(parent->conditions.size());
+        } else if (current != nullptr) {
+            current->conditions.emplace_back(value);
+        }
+    }
+
+    return samples;
+}
+
+} // namespace ddwaf
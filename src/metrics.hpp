@@ -0,0 +1,155 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <ddwaf.h>
+
+namespace ddwaf {
+
+class rule;
+struct ruleset;
+
+// Work performed by a single condition evaluation
+struct match_stats {
+    uint64_t strings{0};
+    uint64_t bytes{0};
+    uint64_t matches{0};
+};
+
+// Execution metrics of every rule and condition of a ruleset, only collected
+// when profiling is enabled. Each thread accumulates its own counters, which
+// are merged when the metrics are read, so that evaluations on different
+// threads don't contend on the same cache lines.
+class metrics {
+public:
+    using ptr = std::shared_ptr<metrics>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    struct counters {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        std::atomic<uint64_t> strings{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> matches{0};
+    };
+
+    // Counters of a single thread, these are only written by the owning
+    // thread but can be read at any time by any other thread.
+    class shard {
+    public:
+        explicit shard(std::size_t size) : counters_(new counters[size]) {}
+
+        void record(std::size_t index, uint64_t ns, const match_stats &stats);
+
+        [[nodiscard]] const counters &operator[](std::size_t index) const
+        {
+            return counters_[index];
+        }
+
+    protected:
+        std::unique_ptr<counters[]> counters_;
+    };
+
+    // Records the metrics of the calling thread, it should only be used
+    // within the scope of a single evaluation.
+    class recorder {
+    public:
+        explicit recorder(metrics &m) : metrics_(m), shard_(m.local_shard()) {}
+
+        void record(const void *entity, uint64_t ns, const match_stats &stats = {})
+        {
+            auto index = metrics_.index(entity);
+            if (index != npos) {
+                shard_.record(index, ns, stats);
+            }
+        }
+
+        // Conditions are identified by their rule and position, as the same
+        // condition can be shared by multiple rules.
+        void record(const rule *parent, std::size_t position, uint64_t ns,
+            const match_stats &stats = {})
+        {
+            auto index = metrics_.index(parent);
+            if (index != npos) {
+                shard_.record(index + 1 + position, ns, stats);
+            }
+        }
+
+    protected:
+        const metrics &metrics_;
+        shard &shard_;
+    };
+
+    // Aggregate of the counters of a rule or condition across all threads
+    struct sample {
+        uint64_t calls{0};
+        uint64_t total_ns{0};
+        uint64_t matches{0};
+    };
+
+    // Conditions are in the same order as in the rule
+    struct rule_sample : sample {
+        std::vector<sample> conditions;
+    };
+
+    explicit metrics(const std::unordered_map<std::string_view, std::shared_ptr<rule>> &rules);
+
+    // Returns the index of the rule or condition provided, or npos if unknown,
+    // conditions shared by multiple rules are indexed within one of them.
+    [[nodiscard]] std::size_t index(const void *entity) const
+    {
+        auto it = index_.find(entity);
+        return it != index_.end() ? it->second : npos;
+    }
+
+    // Merges the counters of all threads into an object of the form:
+    //
+    //   {
+    //     rules: {id: {calls, total_ns, max_ns, strings, bytes, matches,
+    //                  conditions: [{processor, calls, total_ns, ...}]}},
+    //     processors: {name: {calls, total_ns, max_ns, strings, bytes, matches}}
+    //   }
+    //
+    // Processor metrics are the aggregate of all the conditions using them.
+    void to_object(const ruleset &rs, ddwaf_object &output);
+
+    // Returns the samples of each rule and its conditions indexed by rule id,
+    // which is owned by the rule and must therefore outlive the result.
+    std::unordered_map<std::string_view, rule_sample> rule_samples();
+
+protected:
+    shard &local_shard();
+
+    // Conditions are identified by their position within the parent rule,
+    // rules themselves have a position of npos.
+    struct entity {
+        const rule *parent;
+        std::size_t position;
+    };
+
+    // Unique across all instances so that thread-local caches can't refer to
+    // a destroyed instance allocated at the same address.
+    uint64_t id_;
+    std::vector<entity> entities_;
+    std::unordered_map<const void *, std::size_t> index_;
+
+    std::mutex mtx_;
+    std::unordered_map<std::thread::id, std::unique_ptr<shard>> shards_;
+};
+
+} // namespace ddwaf
@@ -6,6 +6,7 @@
 
 #include <log.hpp>
 #include <object_store.hpp>
+#include <utils.hpp>
 #include <vector>
 
 namespace ddwaf {
@@ -24,21 +25,29 @@ object_store::~object_store()
         return;
     }
     for (auto &obj : objects_to_free_) { obj_free_(&obj); }
+    for (auto &[target, lazy] : providers_) {
+        if (lazy->available && lazy->owned) {
+            obj_free_(&lazy->value);
+        }
+    }
 }
 
-bool object_store::insert(const ddwaf_object &input)
+bool object_store::insert(const ddwaf_object &input, bool take_ownership)
 {
-    if (obj_free_ != nullptr) {
+    if (obj_free_ != nullptr && take_ownership) {
         objects_to_free_.emplace_back(input);
     }
 
     latest_batch_.clear();
+    latest_batch_.swap(pending_providers_);
+    latest_size_ = 0;
 
     if (input.type != DDWAF_OBJ_MAP) {
         return false;
     }
 
     std::size_t entries = static_cast<std::size_t>(input.nbEntries);
+    latest_size_ = 1;
     if (entries == 0) {
         // Objects with no addresses are considered valid as they are harmless
         return true;
@@ -56,6 +65,11 @@ bool object_store::insert(const ddwaf_object &input)
     latest_batch_.reserve(entries);
 
     for (std::size_t i = 0; i < entries; ++i) {
+        latest_size_ += 1;
+        if ((array[i].type & PWI_CONTAINER_TYPES) != 0) {
+            latest_size_ += static_cast<std::size_t>(array[i].nbEntries);
+        }
+
         auto length = static_cast<std::size_t>(array[i].parameterNameLength);
         if (array[i].parameterName == nullptr || length == 0) {
             continue;
@@ -70,15 +84,70 @@ bool object_store::insert(const ddwaf_object &input)
         auto target = *opt_target;
         objects_[target] = &array[i];
         latest_batch_.emplace(target);
+        remove_provider(target);
+    }
+
+    return true;
+}
+
+bool object_store::insert_provider(
+    const std::string &address, provider_fn provider, bool take_ownership)
+{
+    auto opt_target = manifest_.find(address);
+    if (!opt_target.has_value()) {
+        return false;
     }
 
+    auto target = *opt_target;
+    remove_provider(target);
+    objects_.erase(target);
+
+    auto lazy = std::make_unique<lazy_object>();
+    lazy->provider = std::move(provider);
+    lazy->owned = take_ownership;
+    providers_.emplace(target, std::move(lazy));
+    pending_providers_.emplace(target);
+
     return true;
 }
 
 const ddwaf_object *object_store::get_target(manifest::target_type target) const
 {
     auto it = objects_.find(target);
-    return it != objects_.end() ? it->second : nullptr;
+    if (it != objects_.end()) {
+        return it->second;
+    }
+
+    auto provider_it = providers_.find(target);
+    if (provider_it == providers_.end()) {
+        return nullptr;
+    }
+
+    auto &lazy = *provider_it->second;
+    std::call_once(lazy.once, [&lazy]() {
+        try {
+            lazy.available = lazy.provider(lazy.value);
+        } catch (...) {
+            DDWAF_WARN("Address provider failed with an exception");
+        }
+    });
+
+    return lazy.available ? &lazy.value : nullptr;
+}
+
+void object_store::remove_provider(manifest::target_type target)
+{
+    auto it = providers_.find(target);
+    if (it == providers_.end()) {
+        return;
+    }
+
+    // The value might still be referenced by filter or condition caches
+    if (it->second->available && it->second->owned && obj_free_ != nullptr) {
+        objects_to_free_.emplace_back(it->second->value);
+    }
+    providers_.erase(it);
+    pending_providers_.erase(target);
 }
 
 } // namespace ddwaf
@@ -7,7 +7,10 @@
 #pragma once
 
 #include <ddwaf.h>
+#include <functional>
 #include <manifest.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -16,10 +19,29 @@ namespace ddwaf {
 
 class object_store {
 public:
+    // Providers generate the value of an address on demand, returning false if
+    // the value couldn't be produced.
+    using provider_fn = std::function<bool(ddwaf_object &)>;
+
     explicit object_store(const manifest &m, ddwaf_object_free_fn free_fn = ddwaf_object_free);
     ~object_store();
 
-    bool insert(const ddwaf_object &input);
+    object_store(const object_store &) = delete;
+    object_store &operator=(const object_store &) = delete;
+    object_store(object_store &&) = default;
+    object_store &operator=(object_store &&) = delete;
+
+    // Unless take_ownership is false, the input is freed on destruction using
+    // the free function provided.
+    bool insert(const ddwaf_object &input, bool take_ownership = true);
+
+    // Registers a lazily-provided address, the provider is only invoked the
+    // first time the target is requested through get_target and, unless
+    // take_ownership is false, the value produced is owned by the store. The
+    // address is considered new on the next call to insert. Returns false if
+    // the address isn't required.
+    bool insert_provider(
+        const std::string &address, provider_fn provider, bool take_ownership = true);
 
     const ddwaf_object *get_target(const manifest::target_type target) const;
 
@@ -30,16 +52,36 @@ public:
 
     bool has_new_targets() const { return !latest_batch_.empty(); }
 
-    operator bool() const { return !objects_.empty(); }
+    // Number of objects in the latest input, counting the root map, its
+    // entries and their immediate children.
+    [[nodiscard]] std::size_t latest_size() const { return latest_size_; }
+
+    operator bool() const { return !objects_.empty() || !providers_.empty(); }
 
 protected:
     const ddwaf::manifest &manifest_;
 
     std::unordered_set<manifest::target_type> latest_batch_;
+    std::size_t latest_size_{0};
     std::unordered_map<manifest::target_type, const ddwaf_object *> objects_;
 
+    struct lazy_object {
+        provider_fn provider;
+        std::once_flag once;
+        ddwaf_object value{};
+        bool available{false};
+        bool owned{true};
+    };
+
+    // Providers are resolved from get_target, which can be called concurrently
+    // while the store is otherwise immutable, hence the once_flag.
+    std::unordered_map<manifest::target_type, std::unique_ptr<lazy_object>> providers_;
+    std::unordered_set<manifest::target_type> pending_providers_;
+
     std::vector<ddwaf_object> objects_to_free_;
     ddwaf_object_free_fn obj_free_;
+
+    void remove_provider(manifest::target_type target);
 };
 
 } // namespace ddwaf
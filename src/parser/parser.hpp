@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "parser/processor_cache.hpp"
 #include "parser/specification.hpp"
 #include <manifest.hpp>
 #include <parameter.hpp>
@@ -13,6 +14,7 @@
 #include <ruleset.hpp>
 #include <ruleset_info.hpp>
 #include <string>
+#include <thread_pool.hpp>
 #include <unordered_map>
 #include <vector>
 
@@ -27,10 +29,10 @@ void parse(parameter::map &ruleset, ruleset_info &info, ddwaf::ruleset &rs, obje
 namespace v2 {
 rule_spec_container parse_rules(parameter::vector &rule_array, ddwaf::ruleset_info &info,
     manifest &target_manifest, std::unordered_map<std::string, std::string> &rule_data_ids,
-    const object_limits &limits);
+    const object_limits &limits, thread_pool *pool = nullptr, processor_cache *cache = nullptr);
 
-rule_data_container parse_rule_data(
-    parameter::vector &rule_data, std::unordered_map<std::string, std::string> &rule_data_ids);
+rule_data_container parse_rule_data(parameter::vector &rule_data,
+    std::unordered_map<std::string, std::string> &rule_data_ids, thread_pool *pool = nullptr);
 
 override_spec_container parse_overrides(parameter::vector &override_array);
 
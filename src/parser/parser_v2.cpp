@@ -13,6 +13,7 @@
 #include <parameter.hpp>
 #include <parser/common.hpp>
 #include <parser/parser.hpp>
+#include <parser/processor_cache.hpp>
 #include <parser/rule_data_parser.hpp>
 #include <parser/specification.hpp>
 #include <rule.hpp>
@@ -26,6 +27,8 @@
 #include <ruleset_info.hpp>
 #include <set>
 #include <string>
+#include <thread_pool.hpp>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -36,8 +39,19 @@ namespace ddwaf::parser::v2 {
 namespace {
 
 std::pair<std::string, rule_processor::base::ptr> parse_processor(
-    std::string_view operation, const parameter::map &params)
+    std::string_view operation, const parameter::map &params, processor_cache *cache = nullptr)
 {
+    std::string key;
+    if (cache != nullptr) {
+        key = processor_cache::make_key(operation, params);
+        if (!key.empty()) {
+            auto processor = cache->find(key);
+            if (processor) {
+                return {std::string(), std::move(processor)};
+            }
+        }
+    }
+
     parameter::map options;
     std::shared_ptr<base> processor;
     std::string rule_data_id;
@@ -97,17 +111,124 @@ std::pair<std::string, rule_processor::base::ptr> parse_processor(
         throw ddwaf::parsing_error("unknown processor: " + std::string(operation));
     }
 
+    if (cache != nullptr && !key.empty() && processor) {
+        processor = cache->insert(key, std::move(processor));
+    }
+
     return {std::move(rule_data_id), std::move(processor)};
 }
 
+// FNV-1a hash of a raw object, maps are hashed in their original order so
+// the same input always produces the same fingerprint.
+void hash_object(const ddwaf_object &object, uint64_t &hash)
+{
+    auto mix = [&hash](const void *data, std::size_t size) {
+        constexpr uint64_t prime = 0x100000001b3ULL;
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= prime;
+        }
+    };
+
+    mix(&object.type, sizeof(object.type));
+    if (object.parameterName != nullptr) {
+        mix(&object.parameterNameLength, sizeof(object.parameterNameLength));
+        mix(object.parameterName, object.parameterNameLength);
+    }
+
+    switch (object.type) {
+    case DDWAF_OBJ_SIGNED:
+        mix(&object.intValue, sizeof(object.intValue));
+        break;
+    case DDWAF_OBJ_UNSIGNED:
+        mix(&object.uintValue, sizeof(object.uintValue));
+        break;
+    case DDWAF_OBJ_BOOL:
+        mix(&object.boolean, sizeof(object.boolean));
+        break;
+    case DDWAF_OBJ_STRING:
+        mix(&object.nbEntries, sizeof(object.nbEntries));
+        if (object.stringValue != nullptr) {
+            mix(object.stringValue, object.nbEntries);
+        }
+        break;
+    case DDWAF_OBJ_ARRAY:
+    case DDWAF_OBJ_MAP:
+        mix(&object.nbEntries, sizeof(object.nbEntries));
+        for (std::size_t i = 0; i < object.nbEntries; ++i) { hash_object(object.array[i], hash); }
+        break;
+    case DDWAF_OBJ_INVALID:
+        break;
+    }
+}
+
+uint64_t rule_fingerprint(const parameter::map &rule)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto *key : {"conditions", "transformers"}) {
+        auto it = rule.find(key);
+        if (it != rule.end()) {
+            hash_object(it->second, hash);
+        }
+    }
+    return hash;
+}
+
+// Processors are the most expensive component of a rule to generate, so when
+// a thread pool is available they are compiled ahead of the rest of the rule.
+// Any error is stored and rethrown once the relevant condition is parsed, so
+// that errors are reported exactly as in the sequential case.
+struct compiled_processor {
+    std::string rule_data_id;
+    rule_processor::base::ptr processor;
+    std::exception_ptr error;
+};
+
+std::vector<compiled_processor> compile_rule_processors(
+    const parameter::map &rule, processor_cache *cache)
+{
+    std::vector<compiled_processor> compiled;
+
+    auto conditions_array = at<parameter::vector>(rule, "conditions");
+    compiled.reserve(conditions_array.size());
+
+    for (const auto &cond_param : conditions_array) {
+        compiled_processor current;
+        try {
+            auto cond = static_cast<parameter::map>(cond_param);
+            auto operation = at<std::string_view>(cond, "operator");
+            auto params = at<parameter::map>(cond, "parameters");
+            std::tie(current.rule_data_id, current.processor) =
+                parse_processor(operation, params, cache);
+        } catch (...) {
+            current.error = std::current_exception();
+        }
+        compiled.emplace_back(std::move(current));
+    }
+
+    return compiled;
+}
+
 condition::ptr parse_rule_condition(const parameter::map &root, manifest &target_manifest,
     std::unordered_map<std::string, std::string> &rule_data_ids, condition::data_source source,
-    std::vector<PW_TRANSFORM_ID> transformers, const object_limits &limits)
+    std::vector<PW_TRANSFORM_ID> transformers, const object_limits &limits,
+    const compiled_processor *compiled = nullptr, processor_cache *cache = nullptr)
 {
     auto operation = at<std::string_view>(root, "operator");
     auto params = at<parameter::map>(root, "parameters");
 
-    auto [rule_data_id, processor] = parse_processor(operation, params);
+    std::string rule_data_id;
+    rule_processor::base::ptr processor;
+    if (compiled != nullptr) {
+        if (compiled->error) {
+            std::rethrow_exception(compiled->error);
+        }
+        rule_data_id = compiled->rule_data_id;
+        processor = compiled->processor;
+    } else {
+        std::tie(rule_data_id, processor) = parse_processor(operation, params, cache);
+    }
     if (!processor && !rule_data_id.empty()) {
         rule_data_ids.emplace(rule_data_id, operation);
     }
@@ -145,7 +266,8 @@ condition::ptr parse_rule_condition(const parameter::map &root, manifest &target
 }
 
 rule_spec parse_rule(parameter::map &rule, manifest &target_manifest,
-    std::unordered_map<std::string, std::string> &rule_data_ids, const object_limits &limits)
+    std::unordered_map<std::string, std::string> &rule_data_ids, const object_limits &limits,
+    const std::vector<compiled_processor> *compiled = nullptr, processor_cache *cache = nullptr)
 {
     std::vector<PW_TRANSFORM_ID> rule_transformers;
     auto source = ddwaf::condition::data_source::values;
@@ -173,10 +295,14 @@ rule_spec parse_rule(parameter::map &rule, manifest &target_manifest,
     auto conditions_array = at<parameter::vector>(rule, "conditions");
     conditions.reserve(conditions_array.size());
 
-    for (const auto &cond_param : conditions_array) {
-        auto cond = static_cast<parameter::map>(cond_param);
-        conditions.push_back(parse_rule_condition(
-            cond, target_manifest, rule_data_ids, source, rule_transformers, limits));
+    for (std::size_t i = 0; i < conditions_array.size(); ++i) {
+        auto cond = static_cast<parameter::map>(conditions_array[i]);
+        const compiled_processor *compiled_cond = nullptr;
+        if (compiled != nullptr && i < compiled->size()) {
+            compiled_cond = &(*compiled)[i];
+        }
+        conditions.push_back(parse_rule_condition(cond, target_manifest, rule_data_ids, source,
+            rule_transformers, limits, compiled_cond, cache));
     }
 
     std::unordered_map<std::string, std::string> tags;
@@ -193,7 +319,8 @@ rule_spec parse_rule(parameter::map &rule, manifest &target_manifest,
     }
 
     return {at<bool>(rule, "enabled", true), at<std::string>(rule, "name"), std::move(tags),
-        std::move(conditions), at<std::vector<std::string>>(rule, "on_match", {})};
+        std::move(conditions), at<std::vector<std::string>>(rule, "on_match", {}),
+        rule_fingerprint(rule)};
 }
 
 rule_target_spec parse_rules_target(const parameter::map &target)
@@ -394,11 +521,26 @@ rule_filter_spec parse_rule_filter(
 
 rule_spec_container parse_rules(parameter::vector &rule_array, ddwaf::ruleset_info &info,
     manifest &target_manifest, std::unordered_map<std::string, std::string> &rule_data_ids,
-    const object_limits &limits)
+    const object_limits &limits, thread_pool *pool, processor_cache *cache)
 {
+    // Compile all processors in parallel, the resulting vector is indexed
+    // in the same order as rule_array so the outcome is deterministic.
+    std::vector<std::optional<std::vector<compiled_processor>>> compiled;
+    if (pool != nullptr && pool->size() > 0 && rule_array.size() > 1) {
+        compiled.resize(rule_array.size());
+        pool->parallel_for(rule_array.size(), [&](std::size_t i) {
+            try {
+                auto rule_map = static_cast<parameter::map>(rule_array[i]);
+                compiled[i] = compile_rule_processors(rule_map, cache);
+            } catch (const std::exception &) {
+                // The error will be reported once the rule is parsed
+            }
+        });
+    }
+
     rule_spec_container rules;
-    for (const auto &rule_param : rule_array) {
-        auto rule_map = static_cast<parameter::map>(rule_param);
+    for (std::size_t i = 0; i < rule_array.size(); ++i) {
+        auto rule_map = static_cast<parameter::map>(rule_array[i]);
         std::string id;
         try {
             id = at<std::string>(rule_map, "id");
@@ -408,7 +550,13 @@ rule_spec_container parse_rules(parameter::vector &rule_array, ddwaf::ruleset_in
                 continue;
             }
 
-            auto rule = parse_rule(rule_map, target_manifest, rule_data_ids, limits);
+            const std::vector<compiled_processor> *compiled_rule = nullptr;
+            if (i < compiled.size() && compiled[i].has_value()) {
+                compiled_rule = &compiled[i].value();
+            }
+
+            auto rule = parse_rule(
+                rule_map, target_manifest, rule_data_ids, limits, compiled_rule, cache);
             rules.emplace(std::move(id), std::move(rule));
             info.add_loaded();
         } catch (const std::exception &e) {
@@ -425,14 +573,15 @@ rule_spec_container parse_rules(parameter::vector &rule_array, ddwaf::ruleset_in
     return rules;
 }
 
-rule_data_container parse_rule_data(
-    parameter::vector &rule_data, std::unordered_map<std::string, std::string> &rule_data_ids)
+rule_data_container parse_rule_data(parameter::vector &rule_data,
+    std::unordered_map<std::string, std::string> &rule_data_ids, thread_pool *pool)
 {
-    rule_data_container processors;
-    for (ddwaf::parameter object : rule_data) {
+    using entry_type = std::optional<std::pair<std::string, rule_processor::base::ptr>>;
+
+    auto parse_entry = [&rule_data, &rule_data_ids](std::size_t i) -> entry_type {
         std::string id;
         try {
-            auto entry = static_cast<ddwaf::parameter::map>(object);
+            auto entry = static_cast<ddwaf::parameter::map>(rule_data[i]);
 
             id = at<std::string>(entry, "id");
 
@@ -466,14 +615,31 @@ rule_data_container parse_rule_data(
             } else {
                 DDWAF_WARN("Processor %.*s doesn't support dynamic rule data",
                     static_cast<int>(operation.length()), operation.data());
-                continue;
+                return std::nullopt;
             }
 
-            processors.emplace(std::move(id), std::move(processor));
+            return {{std::move(id), std::move(processor)}};
         } catch (const ddwaf::exception &e) {
             DDWAF_ERROR("Failed to parse data id '%s': %s",
                 (!id.empty() ? id.c_str() : "(unknown)"), e.what());
         }
+        return std::nullopt;
+    };
+
+    std::vector<entry_type> entries(rule_data.size());
+    if (pool != nullptr && pool->size() > 0 && rule_data.size() > 1) {
+        pool->parallel_for(rule_data.size(), [&](std::size_t i) { entries[i] = parse_entry(i); });
+    } else {
+        for (std::size_t i = 0; i < rule_data.size(); ++i) { entries[i] = parse_entry(i); }
+    }
+
+    // Insertion is always performed in order so that, in the presence of
+    // duplicate IDs, the first valid entry is always the one used.
+    rule_data_container processors;
+    for (auto &entry : entries) {
+        if (entry.has_value()) {
+            processors.emplace(std::move(entry->first), std::move(entry->second));
+        }
     }
 
     return processors;
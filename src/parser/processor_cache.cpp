@@ -0,0 +1,116 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <exception.hpp>
+#include <parser/common.hpp>
+#include <parser/processor_cache.hpp>
+
+namespace ddwaf::parser {
+
+namespace {
+
+// Fields are length-prefixed to avoid ambiguities between keys
+void append_field(std::string &key, std::string_view field)
+{
+    key.append(std::to_string(field.size()));
+    key.push_back(':');
+    key.append(field);
+}
+
+bool append_list(std::string &key, const parameter &list)
+{
+    if (list.type != DDWAF_OBJ_ARRAY) {
+        return false;
+    }
+
+    auto items = static_cast<parameter::vector>(list);
+    append_field(key, std::to_string(items.size()));
+    for (const auto &item : items) {
+        if (item.type != DDWAF_OBJ_STRING || item.stringValue == nullptr) {
+            return false;
+        }
+        append_field(key, {item.stringValue, static_cast<std::size_t>(item.nbEntries)});
+    }
+    return true;
+}
+
+} // namespace
+
+std::string processor_cache::make_key(std::string_view operation, const parameter::map &params)
+{
+    std::string key;
+    append_field(key, operation);
+
+    try {
+        if (operation == "match_regex") {
+            parameter::map options;
+            auto regex = at<std::string_view>(params, "regex");
+            options = at<parameter::map>(params, "options", options);
+
+            auto case_sensitive = at<bool>(options, "case_sensitive", false);
+            auto min_length = at<int64_t>(options, "min_length", 0);
+
+            append_field(key, case_sensitive ? "1" : "0");
+            append_field(key, std::to_string(min_length));
+            append_field(key, regex);
+        } else if (operation == "phrase_match") {
+            if (!append_list(key, params.at("list"))) {
+                return {};
+            }
+        } else if (operation == "ip_match" || operation == "exact_match") {
+            // Processors based on rule data can't be shared
+            auto it = params.find("list");
+            if (it == params.end() || !append_list(key, it->second)) {
+                return {};
+            }
+        } else if (operation != "is_xss" && operation != "is_sqli") {
+            return {};
+        }
+    } catch (const std::exception &) {
+        // The error will be reported when the processor is compiled
+        return {};
+    }
+
+    return key;
+}
+
+rule_processor::base::ptr processor_cache::find(const std::string &key)
+{
+    const std::lock_guard<std::mutex> lock(mtx_);
+    auto it = processors_.find(key);
+    if (it == processors_.end()) {
+        return {};
+    }
+    return it->second.lock();
+}
+
+rule_processor::base::ptr processor_cache::insert(
+    const std::string &key, rule_processor::base::ptr processor)
+{
+    const std::lock_guard<std::mutex> lock(mtx_);
+    auto &entry = processors_[key];
+    auto existing = entry.lock();
+    if (existing) {
+        return existing;
+    }
+
+    entry = processor;
+    return processor;
+}
+
+void processor_cache::cleanup()
+{
+    const std::lock_guard<std::mutex> lock(mtx_);
+    for (auto it = processors_.begin(); it != processors_.end();) {
+        if (it->second.expired()) {
+            it = processors_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace ddwaf::parser
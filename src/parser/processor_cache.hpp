@@ -0,0 +1,57 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <parameter.hpp>
+#include <rule_processor/base.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ddwaf::parser {
+
+// Interning pool for rule processors, identical processors are shared between
+// rules and reused across successive builds for as long as a ruleset still
+// references them. Only weak references are kept, so the cache never extends
+// the lifetime of a processor.
+class processor_cache {
+public:
+    processor_cache() = default;
+    ~processor_cache() = default;
+    processor_cache(const processor_cache &) = delete;
+    processor_cache(processor_cache &&) = delete;
+    processor_cache &operator=(const processor_cache &) = delete;
+    processor_cache &operator=(processor_cache &&) = delete;
+
+    // Generates a canonical key from the operator and its parameters, an
+    // empty key is returned when the processor can't be interned, e.g. when
+    // it depends on rule data or the parameters are invalid.
+    static std::string make_key(std::string_view operation, const parameter::map &params);
+
+    rule_processor::base::ptr find(const std::string &key);
+
+    // Inserts the processor in the cache, if another processor has been
+    // inserted concurrently with the same key, the existing one is returned.
+    rule_processor::base::ptr insert(const std::string &key, rule_processor::base::ptr processor);
+
+    // Removes all the entries which are no longer referenced
+    void cleanup();
+
+    [[nodiscard]] std::size_t size() const
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        return processors_.size();
+    }
+
+protected:
+    mutable std::mutex mtx_;
+    std::unordered_map<std::string, std::weak_ptr<rule_processor::base>> processors_;
+};
+
+} // namespace ddwaf::parser
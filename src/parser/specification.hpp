@@ -21,6 +21,9 @@ struct rule_spec {
     std::unordered_map<std::string, std::string> tags;
     std::vector<condition::ptr> conditions;
     std::vector<std::string> actions;
+    // Hash of the raw conditions and transformers, used to identify rules
+    // which haven't changed across updates, 0 if unavailable.
+    uint64_t fingerprint{0};
 };
 
 enum class target_type { none, id, tags };
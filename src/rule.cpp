@@ -15,6 +15,14 @@
 
 namespace ddwaf {
 
+namespace {
+uint64_t elapsed_ns(monotonic_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(monotonic_clock::now() - start)
+        .count();
+}
+} // namespace
+
 rule::rule(std::string id_, std::string name_, std::unordered_map<std::string, std::string> tags_,
     std::vector<condition::ptr> conditions_, std::vector<std::string> actions_, bool enabled_)
     : enabled(enabled_), id(std::move(id_)), name(std::move(name_)), tags(std::move(tags_)),
@@ -25,13 +33,48 @@ std::optional<event> rule::match(const object_store &store, cache_type &cache,
     const std::unordered_set<const ddwaf_object *> &objects_excluded,
     const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
     ddwaf::timer &deadline) const
+{
+    return match_impl<false>(
+        store, cache, objects_excluded, dynamic_processors, deadline, nullptr, nullptr);
+}
+
+std::optional<event> rule::match(const object_store &store, cache_type &cache,
+    const std::unordered_set<const ddwaf_object *> &objects_excluded,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, metrics::recorder &recorder) const
+{
+    if (cache.result) {
+        return std::nullopt;
+    }
+
+    const auto start = monotonic_clock::now();
+    match_stats stats;
+
+    auto result = match_impl<true>(store, cache, objects_excluded, dynamic_processors, deadline,
+        &recorder, &stats);
+
+    stats.matches = result.has_value() ? 1 : 0;
+    recorder.record(this, elapsed_ns(start), stats);
+    return result;
+}
+
+template <bool Profile>
+std::optional<event> rule::match_impl(const object_store &store, cache_type &cache,
+    const std::unordered_set<const ddwaf_object *> &objects_excluded,
+    const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+    ddwaf::timer &deadline, [[maybe_unused]] metrics::recorder *recorder,
+    [[maybe_unused]] match_stats *rule_stats) const
 {
     // An event was already produced, so we skip the rule
     if (cache.result) {
         return std::nullopt;
     }
 
-    for (const auto &cond : conditions) {
+    const bool reordered = !evaluation_order.empty();
+    for (std::size_t i = 0; i < conditions.size(); ++i) {
+        const auto position = reordered ? evaluation_order[i] : i;
+        const auto &cond = conditions[position];
+
         bool run_on_new = false;
         auto cached_result = cache.conditions.find(cond);
         if (cached_result != cache.conditions.end()) {
@@ -44,18 +87,64 @@ std::optional<event> rule::match(const object_store &store, cache_type &cache,
             cached_result = it;
         }
 
-        auto opt_match =
-            cond->match(store, objects_excluded, run_on_new, dynamic_processors, deadline);
+        // The verdict of a condition shared with other rules might already
+        // be available from the evaluation of one of them.
+        auto *verdicts = cache.verdicts;
+        if (verdicts != nullptr && !verdicts->is_shared(cond.get())) {
+            verdicts = nullptr;
+        }
+
+        std::optional<event::match> opt_match;
+        if (verdicts == nullptr || !verdicts->find(cond.get(), run_on_new, opt_match)) {
+            try {
+                if constexpr (Profile) {
+                    const auto start = monotonic_clock::now();
+                    match_stats stats;
+                    opt_match = cond->match(
+                        store, objects_excluded, run_on_new, dynamic_processors, deadline, stats);
+                    stats.matches = opt_match.has_value() ? 1 : 0;
+                    recorder->record(this, position, elapsed_ns(start), stats);
+                    rule_stats->strings += stats.strings;
+                    rule_stats->bytes += stats.bytes;
+                } else {
+                    opt_match = cond->match(
+                        store, objects_excluded, run_on_new, dynamic_processors, deadline);
+                }
+            } catch (ddwaf::timeout_exception &e) {
+                if (!e.condition.has_value()) {
+                    e.condition = position;
+                }
+                throw;
+            }
+
+            if (verdicts != nullptr) {
+                verdicts->insert(cond.get(), run_on_new, opt_match);
+            }
+        }
+
         if (!opt_match.has_value()) {
             cached_result->second = false;
             return std::nullopt;
         }
         cached_result->second = true;
         cache.event.matches.emplace_back(std::move(*opt_match));
+        if (reordered) {
+            cache.positions.emplace_back(position);
+        }
     }
 
     cache.result = true;
 
+    // Every condition has matched exactly once, so the matches can be
+    // rearranged in the order in which the conditions are defined.
+    if (reordered) {
+        std::vector<event::match> matches(conditions.size());
+        for (std::size_t i = 0; i < cache.positions.size(); ++i) {
+            matches[cache.positions[i]] = std::move(cache.event.matches[i]);
+        }
+        cache.event.matches = std::move(matches);
+    }
+
     cache.event.id = id;
     cache.event.name = name;
     cache.event.type = get_tag("type");
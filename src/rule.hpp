@@ -17,9 +17,11 @@
 #include <condition.hpp>
 #include <event.hpp>
 #include <iterator.hpp>
+#include <metrics.hpp>
 #include <object_store.hpp>
 #include <parser/specification.hpp>
 #include <rule_processor/base.hpp>
+#include <verdict_cache.hpp>
 
 namespace ddwaf {
 
@@ -31,6 +33,12 @@ public:
         bool result{false};
         std::unordered_map<condition::ptr, bool> conditions;
         ddwaf::event event;
+        // Position of the condition producing each of the matches in the
+        // event, only required when the evaluation order has been changed.
+        std::vector<std::size_t> positions;
+        // Verdicts of the conditions shared with other rules, only available
+        // when none of the objects are excluded from the rule.
+        verdict_cache *verdicts{nullptr};
     };
 
     // TODO: make fields protected, add getters, follow conventions, add cache
@@ -46,7 +54,7 @@ public:
     rule(rule &&rhs) noexcept
         : enabled(rhs.enabled), id(std::move(rhs.id)), name(std::move(rhs.name)),
           tags(std::move(rhs.tags)), conditions(std::move(rhs.conditions)),
-          actions(std::move(rhs.actions))
+          actions(std::move(rhs.actions)), evaluation_order(std::move(rhs.evaluation_order))
     {}
 
     rule &operator=(rule &&rhs) noexcept
@@ -57,6 +65,7 @@ public:
         tags = std::move(rhs.tags);
         conditions = std::move(rhs.conditions);
         actions = std::move(rhs.actions);
+        evaluation_order = std::move(rhs.evaluation_order);
         return *this;
     }
 
@@ -67,6 +76,13 @@ public:
         const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
         ddwaf::timer &deadline) const;
 
+    // Same as above, while also recording the metrics of the rule and each of
+    // the conditions evaluated.
+    std::optional<event> match(const object_store &store, cache_type &cache,
+        const std::unordered_set<const ddwaf_object *> &objects_excluded,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, metrics::recorder &recorder) const;
+
     [[nodiscard]] bool is_enabled() const { return enabled; }
     void toggle(bool value) { enabled = value; }
 
@@ -76,12 +92,22 @@ public:
         return it == tags.end() ? std::string_view() : it->second;
     }
 
+    template <bool Profile>
+    std::optional<event> match_impl(const object_store &store, cache_type &cache,
+        const std::unordered_set<const ddwaf_object *> &objects_excluded,
+        const std::unordered_map<std::string, rule_processor::base::ptr> &dynamic_processors,
+        ddwaf::timer &deadline, metrics::recorder *recorder, match_stats *rule_stats) const;
+
     bool enabled{true};
     std::string id;
     std::string name;
     std::unordered_map<std::string, std::string> tags;
     std::vector<condition::ptr> conditions;
     std::vector<std::string> actions;
+    // Positions of the conditions in the order in which they're evaluated, or
+    // empty to evaluate them in the order in which they're defined. Matches
+    // are always reported in the latter order.
+    std::vector<std::size_t> evaluation_order;
 };
 
 } // namespace ddwaf
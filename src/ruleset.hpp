@@ -6,18 +6,26 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <set>
+#include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
 #include <collection.hpp>
+#include <config.hpp>
+#include <cost.hpp>
 #include <exclusion/input_filter.hpp>
 #include <exclusion/rule_filter.hpp>
+#include <histogram.hpp>
+#include <key_paths.hpp>
 #include <manifest.hpp>
+#include <metrics.hpp>
 #include <mkmap.hpp>
 #include <obfuscator.hpp>
 #include <rule.hpp>
+#include <thread_pool.hpp>
 
 namespace ddwaf {
 
@@ -34,6 +42,7 @@ struct ruleset {
         } else {
             priority_collections[rule->get_tag("type")].insert(rule);
         }
+        schedule_collections();
     }
 
     void insert_rules(std::unordered_map<std::string_view, rule::ptr> rules_)
@@ -47,10 +56,48 @@ struct ruleset {
                 priority_collections[rule->get_tag("type")].insert(rule);
             }
         }
+        schedule_collections();
+    }
+
+    // Orders the rules of every collection by increasing cost, followed by
+    // the collections themselves.
+    void order_rules(const rule_cost_map &costs)
+    {
+        for (auto &[type, collection] : priority_collections) { collection.order(costs); }
+        for (auto &[type, collection] : collections) { collection.order(costs); }
+
+        auto by_cost = [](const auto &lhs, const auto &rhs) {
+            auto lhs_cost = lhs.second->cost();
+            auto rhs_cost = rhs.second->cost();
+            return lhs_cost != rhs_cost ? lhs_cost < rhs_cost : lhs.first < rhs.first;
+        };
+        std::sort(priority_schedule.begin(), priority_schedule.end(), by_cost);
+        std::sort(schedule.begin(), schedule.end(), by_cost);
+    }
+
+    // Resets the order in which collections are evaluated, this must be
+    // called whenever a collection is added.
+    void schedule_collections()
+    {
+        priority_schedule.clear();
+        for (const auto &[type, collection] : priority_collections) {
+            priority_schedule.emplace_back(type, &collection);
+        }
+
+        schedule.clear();
+        for (const auto &[type, collection] : collections) {
+            schedule.emplace_back(type, &collection);
+        }
     }
 
     ddwaf_object_free_fn free_fn{ddwaf_object_free};
+    ddwaf::object_limits limits;
     std::shared_ptr<ddwaf::obfuscator> event_obfuscator;
+    // Pool used to evaluate contexts in parallel, shared across updates and
+    // owned by the WAF instance
+    thread_pool_ref run_pool;
+    // Whether regular collections should be evaluated in parallel on run_pool
+    bool parallel_match{false};
 
     ddwaf::manifest manifest;
     std::unordered_map<std::string_view, exclusion::rule_filter::ptr> rule_filters;
@@ -59,10 +106,25 @@ struct ruleset {
     // Rules are ordered by rule.id
     std::unordered_map<std::string_view, rule::ptr> rules;
     std::unordered_map<std::string, rule_processor::base::ptr> dynamic_processors;
+    // Conditions referenced by more than one rule, see verdict_cache
+    std::unordered_set<const condition *> shared_conditions;
 
     // Both collections are ordered by rule.type
     std::unordered_map<std::string_view, priority_collection> priority_collections;
     std::unordered_map<std::string_view, collection> collections;
+    // Collections in the order in which they're evaluated, priority
+    // collections always being evaluated first, see order_rules.
+    std::vector<std::pair<std::string_view, const priority_collection *>> priority_schedule;
+    std::vector<std::pair<std::string_view, const collection *>> schedule;
+
+    // Key paths referenced by the ruleset, see collect_key_paths
+    key_path_map key_paths;
+
+    // Only available when profiling is enabled
+    metrics::ptr rule_metrics;
+    // Latency and input size histograms of all contexts using the ruleset,
+    // only available when enabled through the profiling configuration
+    histogram_set::ptr histograms;
 };
 
 } // namespace ddwaf
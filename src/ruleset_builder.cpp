@@ -5,7 +5,9 @@
 // Copyright 2021 Datadog, Inc.
 
 #include "parser/specification.hpp"
+#include <algorithm>
 #include <charconv>
+#include <derived_addresses.hpp>
 #include <exception.hpp>
 #include <log.hpp>
 #include <parser/common.hpp>
@@ -57,8 +59,100 @@ std::set<rule *> target_to_rules(const std::vector<parser::rule_target_spec> &ta
     return rule_targets;
 }
 
+std::set<std::string_view> target_to_ids(const std::vector<parser::rule_target_spec> &targets,
+    const std::unordered_map<std::string_view, ruleset_builder::rule_state> &states,
+    const ruleset_builder::spec_tag_map &specs_by_tags)
+{
+    std::set<std::string_view> rule_targets;
+    if (!targets.empty()) {
+        for (const auto &target : targets) {
+            if (target.type == parser::target_type::id) {
+                auto it = states.find(target.rule_id);
+                if (it == states.end()) {
+                    continue;
+                }
+                rule_targets.emplace(it->first);
+            } else if (target.type == parser::target_type::tags) {
+                auto current_targets = specs_by_tags.multifind(target.tags);
+                rule_targets.merge(current_targets);
+            }
+        }
+    } else {
+        // An empty rules target applies to all rules
+        for (const auto &[id, state] : states) { rule_targets.emplace(id); }
+    }
+    return rule_targets;
+}
+
+// A rule can be shared with the previous ruleset if its specification and
+// the outcome of the overrides haven't changed.
+bool is_unchanged(const rule &previous, const parser::rule_spec &spec,
+    const ruleset_builder::rule_state &state, uint64_t previous_fingerprint)
+{
+    if (previous.enabled != state.enabled || previous.actions != *state.actions ||
+        previous.name != spec.name || previous.tags != spec.tags) {
+        return false;
+    }
+
+    if (previous.conditions == spec.conditions) {
+        return true;
+    }
+
+    // The fingerprint only rules out changes cheaply, a match has to be
+    // confirmed structurally as different specifications can collide.
+    if (spec.fingerprint == 0 || spec.fingerprint != previous_fingerprint ||
+        previous.conditions.size() != spec.conditions.size()) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < spec.conditions.size(); ++i) {
+        const auto &lhs = previous.conditions[i];
+        const auto &rhs = spec.conditions[i];
+        if (lhs != rhs && lhs->key() != rhs->key()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::unordered_set<const condition *> collect_shared_conditions(
+    const std::unordered_map<std::string_view, rule::ptr> &rules)
+{
+    std::unordered_map<const condition *, std::size_t> references;
+    for (const auto &[id, rule] : rules) {
+        for (const auto &cond : rule->conditions) { ++references[cond.get()]; }
+    }
+
+    std::unordered_set<const condition *> shared;
+    for (const auto &[cond, count] : references) {
+        if (count > 1) {
+            shared.emplace(cond);
+        }
+    }
+    return shared;
+}
+
 } // namespace
 
+void ruleset_builder::intern_conditions(std::vector<condition::ptr> &conditions)
+{
+    for (std::size_t i = 0; i < conditions.size(); ++i) {
+        auto &entry = condition_pool_[conditions[i]->key()];
+        auto existing = entry.lock();
+        if (!existing) {
+            entry = conditions[i];
+            continue;
+        }
+
+        // The rule cache is indexed by condition, so duplicates within the
+        // same rule are kept as they are.
+        auto end = conditions.begin() + static_cast<std::ptrdiff_t>(i);
+        if (std::find(conditions.begin(), end, existing) == end) {
+            conditions[i] = std::move(existing);
+        }
+    }
+}
+
 std::shared_ptr<ruleset> ruleset_builder::build(parameter::map &root, ruleset_info &info)
 {
     // Load new rules, overrides and exclusions
@@ -68,6 +162,15 @@ std::shared_ptr<ruleset> ruleset_builder::build(parameter::map &root, ruleset_in
         return {};
     }
 
+    // The samples collected by the previous ruleset, when still in use, take
+    // precedence over the static cost estimates. The ids of the samples are
+    // owned by the previous ruleset, so it must outlive the estimation.
+    auto previous = last_ruleset_.lock();
+    std::unordered_map<std::string_view, metrics::rule_sample> samples;
+    if (previous && previous->rule_metrics) {
+        samples = previous->rule_metrics->rule_samples();
+    }
+
     constexpr static change_state rule_update = change_state::rules | change_state::overrides;
     constexpr static change_state filters_update = rule_update | change_state::filters;
     constexpr static change_state manifest_update = change_state::rules | change_state::filters;
@@ -76,49 +179,102 @@ std::shared_ptr<ruleset> ruleset_builder::build(parameter::map &root, ruleset_in
     // received, we need to regenerate the ruleset from the base rules as we
     // want to ensure that there are no side-effects on running contexts.
     if ((state & rule_update) != change_state::none) {
+        // Overrides are first resolved against the specification, so that
+        // rules which remain unchanged can be shared with the previous
+        // ruleset rather than regenerated. Shared rules must never be
+        // modified as they might be in use by running contexts.
+        std::unordered_map<std::string_view, rule_state> states;
+        spec_tag_map specs_by_tags;
+        for (const auto &[id, spec] : base_rules_) {
+            states.emplace(id, rule_state{spec.enabled, &spec.actions});
+            specs_by_tags.insert(spec.tags, std::string_view(id));
+        }
+
+        for (const auto *overrides : {&overrides_.by_tags, &overrides_.by_ids}) {
+            for (const auto &ovrd : *overrides) {
+                auto rule_targets = target_to_ids(ovrd.targets, states, specs_by_tags);
+                for (const auto &id : rule_targets) {
+                    auto &current = states[id];
+                    if (ovrd.enabled.has_value()) {
+                        current.enabled = *ovrd.enabled;
+                    }
+
+                    if (ovrd.actions.has_value()) {
+                        current.actions = &(*ovrd.actions);
+                    }
+                }
+            }
+        }
+
+        auto fingerprint_of = [this](const std::string &id) -> uint64_t {
+            auto it = rule_fingerprints_.find(id);
+            return it != rule_fingerprints_.end() ? it->second : 0;
+        };
+
+        auto previous_rules = std::move(final_rules_);
         final_rules_.clear();
         rules_by_tags_.clear();
         targets_from_rules_.clear();
 
-        // Initially, new rules are generated from their spec
-        for (const auto &[id, spec] : base_rules_) {
-            for (const auto &cond : spec.conditions) {
+        for (auto &[id, spec] : base_rules_) {
+            const auto &current = states[id];
+
+            // Identical conditions are shared across rules, so that their
+            // verdicts can be reused within the same evaluation.
+            intern_conditions(spec.conditions);
+
+            rule::ptr rule_ptr;
+            bool shared = false;
+            auto prev_it = previous_rules.find(id);
+            if (prev_it != previous_rules.end() &&
+                is_unchanged(*prev_it->second, spec, current, fingerprint_of(id))) {
+                rule_ptr = prev_it->second;
+                shared = true;
+                // The conditions of a reparsed spec are equivalent to those
+                // of the previous rule, so the latter are kept instead.
+                spec.conditions = rule_ptr->conditions;
+            } else {
+                rule_ptr = std::make_shared<ddwaf::rule>(id, spec.name, spec.tags, spec.conditions,
+                    *current.actions, current.enabled);
+            }
+
+            // Shared rules can't be modified, so a new rule is generated when
+            // the evaluation order of the conditions has to be changed.
+            auto sample_it = samples.find(id);
+            auto order = condition_order(*rule_ptr, dynamic_processors_,
+                sample_it != samples.end() ? &sample_it->second : nullptr);
+            if (order != rule_ptr->evaluation_order) {
+                if (shared) {
+                    rule_ptr = std::make_shared<ddwaf::rule>(rule_ptr->id, rule_ptr->name,
+                        rule_ptr->tags, rule_ptr->conditions, rule_ptr->actions,
+                        rule_ptr->is_enabled());
+                }
+                rule_ptr->evaluation_order = std::move(order);
+            }
+
+            for (const auto &cond : rule_ptr->conditions) {
                 for (const auto &target : cond->get_targets()) {
                     targets_from_rules_.emplace(target.root);
                 }
             }
 
-            auto rule_ptr = std::make_shared<ddwaf::rule>(
-                id, spec.name, spec.tags, spec.conditions, spec.actions, spec.enabled);
-
             // The string_view should be owned by the rule_ptr
             final_rules_.emplace(rule_ptr->id, rule_ptr);
             rules_by_tags_.insert(rule_ptr->tags, rule_ptr.get());
         }
 
-        for (const auto &ovrd : overrides_.by_tags) {
-            auto rule_targets = target_to_rules(ovrd.targets, final_rules_, rules_by_tags_);
-            for (const auto &rule_ptr : rule_targets) {
-                if (ovrd.enabled.has_value()) {
-                    rule_ptr->toggle(*ovrd.enabled);
-                }
-
-                if (ovrd.actions.has_value()) {
-                    rule_ptr->actions = *ovrd.actions;
-                }
-            }
+        rule_fingerprints_.clear();
+        for (const auto &[id, spec] : base_rules_) {
+            rule_fingerprints_.emplace(id, spec.fingerprint);
         }
 
-        for (const auto &ovrd : overrides_.by_ids) {
-            auto rule_targets = target_to_rules(ovrd.targets, final_rules_, rules_by_tags_);
-            for (const auto &rule_ptr : rule_targets) {
-                if (ovrd.enabled.has_value()) {
-                    rule_ptr->toggle(*ovrd.enabled);
-                }
-
-                if (ovrd.actions.has_value()) {
-                    rule_ptr->actions = *ovrd.actions;
-                }
+        // Conditions only referenced by the previous rules are released once
+        // the rulesets using them are gone.
+        for (auto it = condition_pool_.begin(); it != condition_pool_.end();) {
+            if (it->second.expired()) {
+                it = condition_pool_.erase(it);
+            } else {
+                ++it;
             }
         }
     }
@@ -174,12 +330,28 @@ std::shared_ptr<ruleset> ruleset_builder::build(parameter::map &root, ruleset_in
 
     auto rs = std::make_shared<ddwaf::ruleset>();
     rs->manifest = target_manifest_;
+    insert_derived_sources(rs->manifest);
     rs->insert_rules(final_rules_);
+    rs->shared_conditions = collect_shared_conditions(rs->rules);
     rs->dynamic_processors = dynamic_processors_;
     rs->rule_filters = rule_filters_;
     rs->input_filters = input_filters_;
     rs->free_fn = free_fn_;
+    rs->limits = limits_;
     rs->event_obfuscator = event_obfuscator_;
+    rs->run_pool = thread_pool_ref{run_pool_};
+    rs->parallel_match = parallel_match_;
+    rs->key_paths = collect_key_paths(*rs);
+
+    rs->order_rules(estimate_costs(rs->rules, rs->dynamic_processors, &samples));
+
+    if (profiling_.enabled) {
+        rs->rule_metrics = std::make_shared<metrics>(rs->rules);
+    }
+    if (profiling_.histograms) {
+        rs->histograms = std::make_shared<histogram_set>();
+    }
+    last_ruleset_ = rs;
 
     return rs;
 }
@@ -199,8 +371,9 @@ ruleset_builder::change_state ruleset_builder::load(parameter::map &root, rulese
         decltype(rule_data_ids_) rule_data_ids;
 
         auto rules = static_cast<parameter::vector>(it->second);
-        auto new_base_rules =
-            parser::v2::parse_rules(rules, info, target_manifest_, rule_data_ids, limits_);
+        auto new_base_rules = parser::v2::parse_rules(
+            rules, info, target_manifest_, rule_data_ids, limits_, compile_pool_.get(),
+            &processor_cache_);
 
         if (new_base_rules.empty()) {
             throw ddwaf::parsing_error("no valid rules found");
@@ -209,6 +382,10 @@ ruleset_builder::change_state ruleset_builder::load(parameter::map &root, rulese
         // Upon reaching this stage, we know our base ruleset is valid
         base_rules_ = std::move(new_base_rules);
         rule_data_ids_ = std::move(rule_data_ids);
+
+        // Processors only referenced by the previous base rules are released
+        // at this point, unless another ruleset still owns them.
+        processor_cache_.cleanup();
         state = state | change_state::rules;
     } else if (base_rules_.empty()) {
         // If we haven't received rules and our base ruleset is empty, the
@@ -220,7 +397,8 @@ ruleset_builder::change_state ruleset_builder::load(parameter::map &root, rulese
     if (it != root.end()) {
         auto rules_data = static_cast<parameter::vector>(it->second);
         if (!rules_data.empty()) {
-            auto new_processors = parser::v2::parse_rule_data(rules_data, rule_data_ids_);
+            auto new_processors =
+                parser::v2::parse_rule_data(rules_data, rule_data_ids_, compile_pool_.get());
             if (new_processors.empty()) {
                 // The rules_data array might have unrelated IDs, so we need
                 // to consider "no valid IDs" as an empty rules_data
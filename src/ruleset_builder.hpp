@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include "parser/processor_cache.hpp"
 #include "parser/specification.hpp"
+#include <config.hpp>
 #include <manifest.hpp>
 #include <memory>
 #include <parameter.hpp>
@@ -14,6 +16,7 @@
 #include <ruleset.hpp>
 #include <ruleset_info.hpp>
 #include <string>
+#include <thread_pool.hpp>
 #include <unordered_map>
 #include <vector>
 
@@ -24,9 +27,23 @@ public:
     using ptr = std::shared_ptr<ruleset_builder>;
 
     ruleset_builder(object_limits limits, ddwaf_object_free_fn free_fn,
-        std::shared_ptr<ddwaf::obfuscator> event_obfuscator)
-        : limits_(limits), free_fn_(free_fn), event_obfuscator_(std::move(event_obfuscator))
-    {}
+        std::shared_ptr<ddwaf::obfuscator> event_obfuscator, thread_config threads = {},
+        profiling_config profiling = {})
+        : limits_(limits), free_fn_(free_fn), event_obfuscator_(std::move(event_obfuscator)),
+          parallel_match_(threads.parallel_match), profiling_(profiling)
+    {
+        // The calling thread also takes part in the compilation, hence the
+        // pool only requires compile - 1 workers.
+        if (threads.compile > 1) {
+            compile_pool_ = std::make_unique<thread_pool>(threads.compile - 1);
+        }
+
+        // Same as above, the thread calling ddwaf_run_batch takes part in the
+        // evaluation of the batch.
+        if (threads.run > 1) {
+            run_pool_ = std::make_shared<thread_pool>(threads.run - 1);
+        }
+    }
 
     ~ruleset_builder() = default;
     ruleset_builder(ruleset_builder &&) = default;
@@ -42,6 +59,14 @@ public:
 
     std::shared_ptr<ruleset> build(parameter::map &root, ruleset_info &info);
 
+    // Effective state of a rule after applying all overrides
+    struct rule_state {
+        bool enabled;
+        const std::vector<std::string> *actions;
+    };
+
+    using spec_tag_map = ddwaf::multi_key_map<std::string_view, std::string_view>;
+
 protected:
     enum class change_state : uint32_t {
         none = 0,
@@ -56,11 +81,29 @@ protected:
 
     change_state load(parameter::map &root, ruleset_info &info);
 
+    // Replaces each condition with an identical one already used by another
+    // rule, if any, otherwise the condition is added to the pool.
+    void intern_conditions(std::vector<condition::ptr> &conditions);
+
     // These members are obtained through ddwaf_config and are persistent across
     // all updates.
     const object_limits limits_;
     const ddwaf_object_free_fn free_fn_;
     std::shared_ptr<ddwaf::obfuscator> event_obfuscator_;
+    // Pool used to parallelise the compilation of processors, only available
+    // when more than one compilation thread has been requested.
+    std::unique_ptr<thread_pool> compile_pool_;
+    // Pool used to evaluate batches of contexts, shared by all the rulesets
+    // generated by this builder.
+    thread_pool::ptr run_pool_;
+    const bool parallel_match_;
+    const profiling_config profiling_;
+    // Interning pool used to share identical processors across rules and
+    // updates, the cache only holds weak references.
+    parser::processor_cache processor_cache_;
+    // Interning pool of rule conditions indexed by condition::key, only weak
+    // references are kept so that unused conditions are released.
+    std::unordered_map<std::string, std::weak_ptr<condition>> condition_pool_;
 
     // The same manifest is used across updates, so we need to ensure that
     // unused targets are regularly cleaned up.
@@ -93,6 +136,13 @@ protected:
     rule_tag_map rules_by_tags_;
     // The list of tagets used by the rules in final_rules_, used for manifest cleanup
     std::unordered_set<manifest::target_type> targets_from_rules_;
+    // Fingerprint of the specification used to generate each rule, used to
+    // identify unchanged rules when the base rules are reparsed
+    std::unordered_map<std::string, uint64_t> rule_fingerprints_;
+
+    // Latest ruleset generated, used to refine the cost of each rule from the
+    // metrics collected while profiling
+    std::weak_ptr<ruleset> last_ruleset_;
 
     // Filters
     std::unordered_map<std::string_view, exclusion::rule_filter::ptr> rule_filters_;
@@ -0,0 +1,61 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <ruleset_ref.hpp>
+
+namespace ddwaf {
+
+std::size_t thread_shard_index(std::size_t shard_count)
+{
+    static std::atomic<std::size_t> next_index{0};
+    thread_local const std::size_t index = next_index.fetch_add(1);
+    return index % shard_count;
+}
+
+ruleset_ref ruleset_owner::acquire()
+{
+    auto index = thread_shard_index(shard_count);
+    shards_[index].references.fetch_add(1);
+    return {this, index};
+}
+
+void ruleset_owner::release(std::size_t index)
+{
+    auto &current = shards_[index].references;
+    auto value = current.load();
+    while ((value & retired_flag) == 0) {
+        // The object can't be reclaimed until this shard has been retired, as
+        // its count is still included in the shard.
+        if (current.compare_exchange_weak(value, value - 1)) {
+            return;
+        }
+    }
+
+    // The count of this shard has been transferred, this reference must be
+    // released from the remaining counter instead.
+    if (remaining_.fetch_sub(1) == 1) {
+        delete this;
+    }
+}
+
+void ruleset_owner::retire()
+{
+    // References can be released from the remaining counter as soon as their
+    // shard is marked as retired, which might happen before the count of the
+    // shard is transferred. The bias ensures the counter can't reach zero
+    // until all shards have been transferred.
+    for (auto &current : shards_) {
+        auto count = current.references.exchange(retired_flag);
+        remaining_.fetch_add(count);
+    }
+
+    // Drop the bias, if no references are left the object can be reclaimed
+    if (remaining_.fetch_sub(retire_bias) == retire_bias) {
+        delete this;
+    }
+}
+
+} // namespace ddwaf
@@ -0,0 +1,111 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ruleset.hpp>
+
+namespace ddwaf {
+
+// Index of the shard assigned to the calling thread, threads are assigned
+// shards in a round-robin fashion on first use.
+std::size_t thread_shard_index(std::size_t shard_count);
+
+class ruleset_ref;
+
+// Owner of a ruleset reference shared with contexts through sharded counters,
+// so that concurrent context creation and destruction on different threads
+// doesn't contend on a single reference count.
+//
+// The owner must call retire() once it no longer creates new references. At
+// this point each shard is atomically marked as retired and its count is
+// transferred to a single counter, which is then used by all subsequent
+// releases, including those racing with the transfer of their shard. The object deletes itself, releasing the ruleset, when that
+// counter reaches zero.
+class ruleset_owner {
+public:
+    explicit ruleset_owner(std::shared_ptr<ruleset> rs) : ruleset_(std::move(rs)) {}
+
+    ruleset_owner(const ruleset_owner &) = delete;
+    ruleset_owner(ruleset_owner &&) = delete;
+    ruleset_owner &operator=(const ruleset_owner &) = delete;
+    ruleset_owner &operator=(ruleset_owner &&) = delete;
+
+    ruleset_ref acquire();
+    void retire();
+
+protected:
+    friend class ruleset_ref;
+
+    static constexpr std::size_t shard_count = 32;
+
+    static constexpr uint64_t retired_flag = uint64_t{1} << 63;
+    // Larger than any number of references which can be held at once
+    static constexpr uint64_t retire_bias = uint64_t{1} << 62;
+
+    struct alignas(64) shard {
+        std::atomic<uint64_t> references{0};
+    };
+
+    ~ruleset_owner() = default;
+
+    void release(std::size_t index);
+
+    std::shared_ptr<ruleset> ruleset_;
+    std::array<shard, shard_count> shards_{};
+    // Only used after retirement, starts with a bias owned by retire()
+    std::atomic<uint64_t> remaining_{retire_bias};
+};
+
+// Reference to a ruleset held by a context, either obtained from an owner or
+// through a plain shared pointer.
+class ruleset_ref {
+public:
+    ruleset_ref() = default;
+    explicit ruleset_ref(std::shared_ptr<ruleset> rs) : ptr_(rs.get()), shared_(std::move(rs)) {}
+
+    ~ruleset_ref()
+    {
+        if (owner_ != nullptr) {
+            owner_->release(shard_);
+        }
+    }
+
+    ruleset_ref(const ruleset_ref &) = delete;
+    ruleset_ref &operator=(const ruleset_ref &) = delete;
+
+    ruleset_ref(ruleset_ref &&other) noexcept
+        : ptr_(other.ptr_), shared_(std::move(other.shared_)), owner_(other.owner_),
+          shard_(other.shard_)
+    {
+        other.ptr_ = nullptr;
+        other.owner_ = nullptr;
+    }
+
+    ruleset_ref &operator=(ruleset_ref &&) = delete;
+
+    ruleset *operator->() const { return ptr_; }
+    ruleset &operator*() const { return *ptr_; }
+    [[nodiscard]] ruleset *get() const { return ptr_; }
+
+protected:
+    friend class ruleset_owner;
+
+    ruleset_ref(ruleset_owner *owner, std::size_t shard)
+        : ptr_(owner->ruleset_.get()), owner_(owner), shard_(shard)
+    {}
+
+    ruleset *ptr_{nullptr};
+    std::shared_ptr<ruleset> shared_;
+    ruleset_owner *owner_{nullptr};
+    std::size_t shard_{0};
+};
+
+} // namespace ddwaf
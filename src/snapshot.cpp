@@ -0,0 +1,260 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <cstring>
+#include <deque>
+#include <exception.hpp>
+#include <limits>
+#include <snapshot.hpp>
+#include <vector>
+
+namespace ddwaf::snapshot {
+
+namespace {
+
+struct header {
+    char magic[sizeof(snapshot::magic)];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t node_count;
+    uint64_t string_size;
+};
+
+struct node {
+    uint64_t name_offset;
+    uint64_t name_length;
+    // String offset, numeric value or index of the first child
+    uint64_t value;
+    uint64_t entries;
+    uint32_t type;
+    uint32_t has_name;
+};
+
+constexpr std::size_t max_depth = 1024;
+
+bool is_valid_type(uint32_t type)
+{
+    switch (type) {
+    case DDWAF_OBJ_SIGNED:
+    case DDWAF_OBJ_UNSIGNED:
+    case DDWAF_OBJ_STRING:
+    case DDWAF_OBJ_ARRAY:
+    case DDWAF_OBJ_MAP:
+    case DDWAF_OBJ_BOOL:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+} // namespace
+
+bool is_snapshot(const void *buffer, std::size_t size)
+{
+    return buffer != nullptr && size >= sizeof(header) &&
+           memcmp(buffer, snapshot::magic, sizeof(snapshot::magic)) == 0;
+}
+
+std::size_t serialize(const ddwaf_object &object, void *buffer, std::size_t size)
+{
+    // First compute the layout of the snapshot
+    std::vector<const ddwaf_object *> objects;
+    uint64_t string_size = 0;
+
+    std::deque<std::pair<const ddwaf_object *, std::size_t>> queue{{&object, 0}};
+    while (!queue.empty()) {
+        auto [current, depth] = queue.front();
+        queue.pop_front();
+
+        if (!is_valid_type(current->type) || depth > max_depth) {
+            return 0;
+        }
+
+        objects.emplace_back(current);
+        if (current->parameterName != nullptr) {
+            string_size += current->parameterNameLength + 1;
+        }
+
+        if (current->type == DDWAF_OBJ_STRING) {
+            if (current->stringValue == nullptr) {
+                return 0;
+            }
+            string_size += current->nbEntries + 1;
+        } else if (current->type == DDWAF_OBJ_ARRAY || current->type == DDWAF_OBJ_MAP) {
+            if (current->nbEntries > 0 && current->array == nullptr) {
+                return 0;
+            }
+            for (std::size_t i = 0; i < current->nbEntries; ++i) {
+                queue.emplace_back(&current->array[i], depth + 1);
+            }
+        }
+    }
+
+    const std::size_t required =
+        sizeof(header) + objects.size() * sizeof(node) + static_cast<std::size_t>(string_size);
+    if (buffer == nullptr || size < required) {
+        return required;
+    }
+
+    auto *output = static_cast<char *>(buffer);
+
+    header hdr{};
+    memcpy(hdr.magic, snapshot::magic, sizeof(snapshot::magic));
+    hdr.version = snapshot::version;
+    hdr.byte_order = snapshot::byte_order;
+    hdr.node_count = objects.size();
+    hdr.string_size = string_size;
+    memcpy(output, &hdr, sizeof(hdr));
+
+    char *node_table = output + sizeof(header);
+    char *string_table = node_table + objects.size() * sizeof(node);
+
+    uint64_t string_offset = 0;
+    auto write_string = [&](const char *str, uint64_t length) {
+        auto offset = string_offset;
+        memcpy(string_table + offset, str, length);
+        string_table[offset + length] = '\0';
+        string_offset += length + 1;
+        return offset;
+    };
+
+    // Children are numbered in the same breadth-first order as the queue
+    uint64_t next_child = 1;
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        const auto *current = objects[i];
+
+        node entry{};
+        entry.type = current->type;
+        if (current->parameterName != nullptr) {
+            entry.has_name = 1;
+            entry.name_length = current->parameterNameLength;
+            entry.name_offset = write_string(current->parameterName, current->parameterNameLength);
+        }
+
+        switch (current->type) {
+        case DDWAF_OBJ_STRING:
+            entry.entries = current->nbEntries;
+            entry.value = write_string(current->stringValue, current->nbEntries);
+            break;
+        case DDWAF_OBJ_SIGNED:
+            memcpy(&entry.value, &current->intValue, sizeof(current->intValue));
+            break;
+        case DDWAF_OBJ_UNSIGNED:
+            entry.value = current->uintValue;
+            break;
+        case DDWAF_OBJ_BOOL:
+            entry.value = current->boolean ? 1 : 0;
+            break;
+        case DDWAF_OBJ_ARRAY:
+        case DDWAF_OBJ_MAP:
+            entry.entries = current->nbEntries;
+            entry.value = next_child;
+            next_child += current->nbEntries;
+            break;
+        default:
+            break;
+        }
+
+        memcpy(node_table + i * sizeof(node), &entry, sizeof(node));
+    }
+
+    return required;
+}
+
+object_view load(const void *buffer, std::size_t size)
+{
+    if (!is_snapshot(buffer, size)) {
+        throw parsing_error("invalid snapshot header");
+    }
+
+    const auto *input = static_cast<const char *>(buffer);
+
+    header hdr{};
+    memcpy(&hdr, input, sizeof(hdr));
+    if (hdr.byte_order != snapshot::byte_order) {
+        throw parsing_error("snapshot byte order mismatch");
+    }
+
+    if (hdr.version != snapshot::version) {
+        throw parsing_error("unsupported snapshot version " + std::to_string(hdr.version));
+    }
+
+    const std::size_t available = size - sizeof(header);
+    if (hdr.node_count == 0 || hdr.node_count > available / sizeof(node) ||
+        hdr.string_size > available - hdr.node_count * sizeof(node)) {
+        throw parsing_error("truncated snapshot");
+    }
+
+    const char *node_table = input + sizeof(header);
+    const char *string_table = node_table + hdr.node_count * sizeof(node);
+
+    auto read_string = [&](uint64_t offset, uint64_t length) {
+        if (offset > hdr.string_size || length >= hdr.string_size - offset ||
+            string_table[offset + length] != '\0') {
+            throw parsing_error("invalid snapshot string");
+        }
+        return string_table + offset;
+    };
+
+    std::unique_ptr<ddwaf_object[]> nodes(new ddwaf_object[hdr.node_count]);
+    for (uint64_t i = 0; i < hdr.node_count; ++i) {
+        node entry{};
+        memcpy(&entry, node_table + i * sizeof(node), sizeof(node));
+
+        if (!is_valid_type(entry.type)) {
+            throw parsing_error("invalid snapshot node type");
+        }
+
+        auto &object = nodes[i];
+        object.type = static_cast<DDWAF_OBJ_TYPE>(entry.type);
+        object.nbEntries = 0;
+        object.uintValue = 0;
+        object.parameterName = nullptr;
+        object.parameterNameLength = 0;
+
+        if (entry.has_name != 0) {
+            object.parameterName = read_string(entry.name_offset, entry.name_length);
+            object.parameterNameLength = entry.name_length;
+        }
+
+        switch (entry.type) {
+        case DDWAF_OBJ_STRING:
+            object.stringValue = read_string(entry.value, entry.entries);
+            object.nbEntries = entry.entries;
+            break;
+        case DDWAF_OBJ_SIGNED:
+            memcpy(&object.intValue, &entry.value, sizeof(object.intValue));
+            break;
+        case DDWAF_OBJ_UNSIGNED:
+            object.uintValue = entry.value;
+            break;
+        case DDWAF_OBJ_BOOL:
+            object.boolean = entry.value != 0;
+            break;
+        case DDWAF_OBJ_ARRAY:
+        case DDWAF_OBJ_MAP:
+            // Children must be located after the parent to prevent cycles
+            if (entry.entries > 0) {
+                if (entry.value <= i || entry.value > hdr.node_count ||
+                    entry.entries > hdr.node_count - entry.value) {
+                    throw parsing_error("invalid snapshot container");
+                }
+                object.array = &nodes[entry.value];
+            } else {
+                object.array = nullptr;
+            }
+            object.nbEntries = entry.entries;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return object_view{std::move(nodes)};
+}
+
+} // namespace ddwaf::snapshot
@@ -0,0 +1,59 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <cstdint>
+#include <ddwaf.h>
+#include <memory>
+
+namespace ddwaf::snapshot {
+
+// Binary snapshot of a ruleset object. The layout consists of a header,
+// followed by a flat table of fixed-size nodes and a string table:
+//
+//   header  | magic (8) | version (4) | byte order (4) | nodes (8) | strings (8)
+//   nodes   | node_count x node
+//   strings | NUL-terminated strings referenced by offset
+//
+// Nodes are stored in breadth-first order, so the children of a container
+// are always contiguous and located after their parent. This allows the
+// snapshot to be loaded with a single allocation, referencing the strings
+// directly from the provided buffer.
+//
+// Only the object tree is stored: loading a snapshot skips the decoding of
+// the original input format, but the resulting object still goes through
+// the regular parsing and compilation of the ruleset. Parsed specs hold
+// compiled processors and references into the manifest, so they can't be
+// persisted as they are.
+constexpr char magic[8] = {'D', 'D', 'W', 'A', 'F', 'S', 'N', 'P'};
+constexpr uint32_t version = 1;
+constexpr uint32_t byte_order = 0x01020304;
+
+// Returns true if the buffer starts with the snapshot magic
+bool is_snapshot(const void *buffer, std::size_t size);
+
+// Serialises the object into the buffer provided, returns the number of
+// bytes required for the snapshot, which might be larger than size, in which
+// case nothing is written. A return value of 0 indicates an invalid object.
+std::size_t serialize(const ddwaf_object &object, void *buffer, std::size_t size);
+
+// Object tree loaded from a snapshot, all strings are owned by the buffer
+// used to load it, so it must outlive this object.
+class object_view {
+public:
+    explicit object_view(std::unique_ptr<ddwaf_object[]> nodes) : nodes_(std::move(nodes)) {}
+
+    [[nodiscard]] const ddwaf_object &root() const { return nodes_[0]; }
+
+protected:
+    std::unique_ptr<ddwaf_object[]> nodes_;
+};
+
+// Loads a snapshot, throws parsing_error if the snapshot is invalid
+object_view load(const void *buffer, std::size_t size);
+
+} // namespace ddwaf::snapshot
@@ -0,0 +1,75 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <log.hpp>
+#include <thread_pool.hpp>
+
+namespace ddwaf {
+
+namespace {
+thread_local thread_pool *current_pool = nullptr;
+} // namespace
+
+thread_pool *thread_pool::current() { return current_pool; }
+
+thread_pool::thread_pool(std::size_t size)
+{
+    workers_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) { workers_.emplace_back([this]() { run(); }); }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void thread_pool::push(std::function<void()> task)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        tasks_.emplace_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void thread_pool::run()
+{
+    current_pool = this;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                // Only reachable when stopping
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception &e) {
+            DDWAF_ERROR("Uncaught exception in worker thread: %s", e.what());
+        } catch (...) {
+            DDWAF_ERROR("Uncaught unknown exception in worker thread");
+        }
+    }
+}
+
+} // namespace ddwaf
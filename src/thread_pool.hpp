@@ -0,0 +1,150 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ddwaf {
+
+// Fixed-size pool of worker threads. Tasks are executed in submission order,
+// although completion order depends on the number of workers available.
+class thread_pool {
+public:
+    using ptr = std::shared_ptr<thread_pool>;
+
+    explicit thread_pool(std::size_t size);
+    ~thread_pool();
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+    thread_pool(thread_pool &&) = delete;
+    thread_pool &operator=(thread_pool &&) = delete;
+
+    void push(std::function<void()> task);
+
+    // Calls fn(i) for every i in [0, count), distributing the work between the
+    // calling thread and the pool. Returns once all indices have been processed
+    // and rethrows the first exception raised by fn, if any.
+    //
+    // Helper tasks which haven't been picked up by a worker by the time the
+    // calling thread runs out of work are discarded, so it's safe to call this
+    // function from within a worker of the same pool.
+    template <typename F> void parallel_for(std::size_t count, F &&fn);
+
+    [[nodiscard]] std::size_t size() const { return workers_.size(); }
+
+    // Pool of the worker calling this function, null if not called from a
+    // worker thread.
+    static thread_pool *current();
+
+protected:
+    void run();
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stop_{false};
+};
+
+// Non-owning reference to a pool. Pools are owned by the WAF instance so that
+// they are always destroyed, and their workers joined, by the thread
+// destroying the instance. A worker releasing the last reference to its own
+// pool would otherwise attempt to join itself.
+//
+// Workers of the referenced pool use it directly, as it can't be destroyed
+// while they are running, while any other thread holds a reference for as
+// long as required.
+class thread_pool_ref {
+public:
+    thread_pool_ref() = default;
+    explicit thread_pool_ref(const thread_pool::ptr &pool) : weak_(pool), pool_(pool.get()) {}
+
+    // Returns the pool, or null if no longer available, along with the
+    // reference keeping it alive, if any.
+    [[nodiscard]] std::pair<thread_pool *, thread_pool::ptr> lock() const
+    {
+        if (pool_ != nullptr && thread_pool::current() == pool_) {
+            return {pool_, {}};
+        }
+
+        auto pool = weak_.lock();
+        return {pool.get(), std::move(pool)};
+    }
+
+protected:
+    std::weak_ptr<thread_pool> weak_;
+    thread_pool *pool_{nullptr};
+};
+
+template <typename F> void thread_pool::parallel_for(std::size_t count, F &&fn)
+{
+    struct shared_state {
+        std::atomic<std::size_t> next{0};
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::size_t active{0};
+        bool closed{false};
+        std::exception_ptr error;
+    };
+
+    auto state = std::make_shared<shared_state>();
+    auto work = [&fn, count](shared_state &st) {
+        for (std::size_t i = st.next++; i < count; i = st.next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                const std::lock_guard<std::mutex> lock(st.mtx);
+                if (!st.error) {
+                    st.error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::size_t helpers = count > 1 ? std::min(workers_.size(), count - 1) : 0;
+    for (std::size_t i = 0; i < helpers; ++i) {
+        push([state, &work]() {
+            {
+                const std::lock_guard<std::mutex> lock(state->mtx);
+                if (state->closed) {
+                    return;
+                }
+                ++state->active;
+            }
+
+            work(*state);
+
+            const std::lock_guard<std::mutex> lock(state->mtx);
+            if (--state->active == 0) {
+                state->cv.notify_all();
+            }
+        });
+    }
+
+    work(*state);
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->closed = true;
+    state->cv.wait(lock, [&state]() { return state->active == 0; });
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace ddwaf
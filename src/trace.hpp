@@ -0,0 +1,71 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <clock.hpp>
+#include <ddwaf.h>
+
+// Static probes are nops unless a tracer is attached to them
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define DDWAF_PROBE(name, phase, label) DTRACE_PROBE2(libddwaf, name, phase, label)
+#  endif
+#endif
+
+#ifndef DDWAF_PROBE
+#  define DDWAF_PROBE(name, phase, label) (void)0
+#endif
+// NOLINTEND(cppcoreguidelines-macro-usage)
+
+namespace ddwaf {
+
+// Invokes the trace hooks, if registered, and the static probes at the start
+// and end of the enclosing scope.
+class trace_scope {
+public:
+    trace_scope(
+        const ddwaf_trace_hooks &hooks, DDWAF_TRACE_PHASE phase, const char *name = nullptr)
+        : hooks_(hooks), phase_(phase), name_(name)
+    {
+        DDWAF_PROBE(phase_begin, phase_, name_);
+        if (hooks_.begin != nullptr) {
+            hooks_.begin(hooks_.user_data, phase_, name_, now());
+        }
+    }
+
+    ~trace_scope()
+    {
+        DDWAF_PROBE(phase_end, phase_, name_);
+        if (hooks_.end != nullptr) {
+            hooks_.end(hooks_.user_data, phase_, name_, now());
+        }
+    }
+
+    trace_scope(const trace_scope &) = delete;
+    trace_scope &operator=(const trace_scope &) = delete;
+    trace_scope(trace_scope &&) = delete;
+    trace_scope &operator=(trace_scope &&) = delete;
+
+protected:
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            monotonic_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    const ddwaf_trace_hooks &hooks_;
+    DDWAF_TRACE_PHASE phase_;
+    const char *name_;
+};
+
+} // namespace ddwaf
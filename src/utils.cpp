@@ -33,3 +33,37 @@ size_t find_string_cutoff(const char *str, size_t length, uint32_t max_string_le
 
     return pos;
 }
+
+namespace ddwaf {
+
+int from_hex(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::size_t percent_decode(const char *begin, const char *end, char *out, bool plus_as_space)
+{
+    const char *out_begin = out;
+    for (const char *in = begin; in < end; ++in) {
+        if (plus_as_space && *in == '+') {
+            *out++ = ' ';
+        } else if (*in == '%' && end - in > 2 && from_hex(in[1]) >= 0 && from_hex(in[2]) >= 0) {
+            *out++ = static_cast<char>((from_hex(in[1]) << 4) | from_hex(in[2]));
+            in += 2;
+        } else {
+            *out++ = *in;
+        }
+    }
+    return static_cast<std::size_t>(out - out_begin);
+}
+
+} // namespace ddwaf
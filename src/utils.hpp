@@ -50,4 +50,13 @@ inline bool is_scalar(const ddwaf_object *obj)
 
 inline bool isdigit(char c) { return (c >= '0' && c <= '9'); }
 
+// Value of a hexadecimal digit, -1 if the character isn't one
+int from_hex(char c);
+
+// Decodes the percent-encoded string [begin, end) into out, returning the
+// decoded length. Invalid escape sequences are copied verbatim and, if
+// plus_as_space is set, plus signs are decoded as spaces. Decoded strings are
+// never longer than their encoded form, so out can point to begin.
+std::size_t percent_decode(const char *begin, const char *end, char *out, bool plus_as_space);
+
 } // namespace ddwaf
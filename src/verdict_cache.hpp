@@ -0,0 +1,79 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <event.hpp>
+
+namespace ddwaf {
+
+class condition;
+
+// Verdicts of the conditions shared by multiple rules, so that a condition
+// evaluated on behalf of one rule can be reused by the others. The verdict of
+// a condition depends on the contents of the store and on whether only new
+// targets are considered, so the cache is only valid within a single
+// evaluation. Rules with excluded objects must not use the cache.
+class verdict_cache {
+public:
+    using verdict = std::optional<event::match>;
+
+    // The set of shared conditions must outlive the cache
+    explicit verdict_cache(const std::unordered_set<const condition *> &shared) : shared_(&shared)
+    {}
+
+    ~verdict_cache() = default;
+    verdict_cache(const verdict_cache &) = delete;
+    verdict_cache &operator=(const verdict_cache &) = delete;
+    verdict_cache(verdict_cache &&) = delete;
+    verdict_cache &operator=(verdict_cache &&) = delete;
+
+    [[nodiscard]] bool is_shared(const condition *cond) const
+    {
+        return shared_->find(cond) != shared_->end();
+    }
+
+    // Copies the verdict of the condition into output, returns false if the
+    // condition hasn't been evaluated yet.
+    bool find(const condition *cond, bool run_on_new, verdict &output) const
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        const auto &verdicts = verdicts_[run_on_new ? 1 : 0];
+        auto it = verdicts.find(cond);
+        if (it == verdicts.end()) {
+            return false;
+        }
+        output = it->second;
+        return true;
+    }
+
+    void insert(const condition *cond, bool run_on_new, const verdict &value)
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        verdicts_[run_on_new ? 1 : 0].emplace(cond, value);
+    }
+
+    void clear()
+    {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        for (auto &verdicts : verdicts_) { verdicts.clear(); }
+    }
+
+protected:
+    const std::unordered_set<const condition *> *shared_;
+    // The mutex is only contended when collections are evaluated in parallel
+    mutable std::mutex mtx_;
+    // Verdicts indexed by whether only new targets were considered
+    std::array<std::unordered_map<const condition *, verdict>, 2> verdicts_;
+};
+
+} // namespace ddwaf
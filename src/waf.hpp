@@ -9,9 +9,11 @@
 #include "parser/parser.hpp"
 #include <config.hpp>
 #include <context.hpp>
+#include <derived_addresses.hpp>
 #include <memory>
 #include <ruleset.hpp>
 #include <ruleset_builder.hpp>
+#include <ruleset_ref.hpp>
 #include <ruleset_info.hpp>
 #include <utils.hpp>
 #include <version.hpp>
@@ -21,7 +23,8 @@ namespace ddwaf {
 class waf {
 public:
     waf(ddwaf::parameter input, ddwaf::ruleset_info &info, ddwaf::object_limits limits,
-        ddwaf_object_free_fn free_fn, std::shared_ptr<ddwaf::obfuscator> event_obfuscator)
+        ddwaf_object_free_fn free_fn, std::shared_ptr<ddwaf::obfuscator> event_obfuscator,
+        ddwaf::thread_config threads = {}, ddwaf::profiling_config profiling = {})
     {
         auto input_map = static_cast<parameter::map>(input);
 
@@ -40,16 +43,35 @@ public:
         if (version == 1) {
             ddwaf::ruleset rs;
             rs.free_fn = free_fn;
+            rs.limits = limits;
             rs.event_obfuscator = event_obfuscator;
+            if (threads.run > 1) {
+                run_pool_ = std::make_shared<thread_pool>(threads.run - 1);
+                rs.run_pool = thread_pool_ref{run_pool_};
+            }
+            rs.parallel_match = threads.parallel_match;
             parser::v1::parse(input_map, info, rs, limits);
+            rs.key_paths = collect_key_paths(rs);
+            // Rules and conditions of version 1 rulesets are evaluated in the
+            // order in which they're defined, hence they're never reordered
+            // by cost.
+            insert_derived_sources(rs.manifest);
+            if (profiling.enabled) {
+                rs.rule_metrics = std::make_shared<metrics>(rs.rules);
+            }
+            if (profiling.histograms) {
+                rs.histograms = std::make_shared<histogram_set>();
+            }
             ruleset_ = std::make_shared<ddwaf::ruleset>(std::move(rs));
+            owner_ = new ruleset_owner(ruleset_);
             return;
         }
 
         if (version == 2) {
-            builder_ =
-                std::make_shared<ruleset_builder>(limits, free_fn, std::move(event_obfuscator));
+            builder_ = std::make_shared<ruleset_builder>(
+                limits, free_fn, std::move(event_obfuscator), threads, profiling);
             ruleset_ = builder_->build(input, info);
+            owner_ = new ruleset_owner(ruleset_);
             return;
         }
 
@@ -62,26 +84,85 @@ public:
         if (builder_) {
             auto ruleset = builder_->build(input, info);
             if (ruleset) {
-                return new waf{builder_, std::move(ruleset)};
+                return new waf{builder_, std::move(ruleset), hooks_};
             }
         }
         return nullptr;
     }
 
-    ddwaf::context create_context() { return context{ruleset_}; }
+    ~waf()
+    {
+        if (owner_ != nullptr) {
+            owner_->retire();
+        }
+    }
+
+    waf(const waf &) = delete;
+    waf(waf &&) = delete;
+    waf &operator=(const waf &) = delete;
+    waf &operator=(waf &&) = delete;
+
+    ddwaf::context create_context() { return context{owner_->acquire(), hooks_}; }
+
+    // Contexts created afterwards, including those of updated instances,
+    // invoke the hooks provided
+    void set_trace_hooks(const ddwaf_trace_hooks &hooks) { hooks_ = hooks; }
 
     [[nodiscard]] const std::vector<const char *> &get_root_addresses() const
     {
         return ruleset_->manifest.get_root_addresses();
     }
 
+    [[nodiscard]] const key_path_map &get_required_key_paths() const
+    {
+        return ruleset_->key_paths;
+    }
+
+    bool get_metrics(ddwaf_object &output) const
+    {
+        if (!ruleset_->rule_metrics) {
+            return false;
+        }
+
+        ruleset_->rule_metrics->to_object(*ruleset_, output);
+        return true;
+    }
+
+    [[nodiscard]] const ddwaf::ruleset::ptr &get_ruleset() const { return ruleset_; }
+
+    bool get_histograms(ddwaf_object &output) const
+    {
+        if (!ruleset_->histograms) {
+            return false;
+        }
+
+        ruleset_->histograms->to_object(output);
+        return true;
+    }
+
+    void reset_histograms()
+    {
+        if (ruleset_->histograms) {
+            ruleset_->histograms->reset();
+        }
+    }
+
 protected:
-    waf(ddwaf::ruleset_builder::ptr builder, ddwaf::ruleset::ptr ruleset)
-        : builder_(std::move(builder)), ruleset_(std::move(ruleset))
+    waf(ddwaf::ruleset_builder::ptr builder, ddwaf::ruleset::ptr ruleset,
+        ddwaf_trace_hooks hooks)
+        : builder_(std::move(builder)), ruleset_(std::move(ruleset)),
+          owner_(new ruleset_owner(ruleset_)), hooks_(hooks)
     {}
 
     ddwaf::ruleset_builder::ptr builder_;
+    // Run pool of version 1 rulesets, otherwise owned by the builder
+    thread_pool::ptr run_pool_;
     ddwaf::ruleset::ptr ruleset_;
+    // Contexts reference the ruleset through the owner rather than by copying
+    // ruleset_, which avoids contention on its reference count. The owner
+    // deletes itself once retired and no longer referenced.
+    ruleset_owner *owner_{nullptr};
+    ddwaf_trace_hooks hooks_{};
 };
 
 } // namespace ddwaf
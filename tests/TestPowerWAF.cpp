@@ -157,6 +157,44 @@ TEST(TestPowerWAF, TestLogging)
     EXPECT_EQ(lastMessage, "Combination -1 2 abc def 22 ghi");
 }
 
+TEST(TestPowerWAF, TestDeferredLogging)
+{
+    static std::vector<string> messages;
+
+    ddwaf_log_cb cb = [](DDWAF_LOG_LEVEL, const char *, const char *, unsigned,
+                          const char *message, uint64_t message_len) {
+        messages.emplace_back(message, static_cast<size_t>(message_len));
+    };
+
+    ddwaf_set_log_cb(cb, DDWAF_LOG_INFO);
+    EXPECT_TRUE(ddwaf_set_log_deferred(true));
+    messages.clear();
+
+    DDWAF_INFO("Signed %d", -25);
+    DDWAF_DEBUG("ignored message");
+    DDWAF_WARN("String %s", "thisisastring");
+    EXPECT_TRUE(messages.empty());
+
+    EXPECT_EQ(ddwaf_log_drain(1), 1);
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_EQ(messages[0], "Signed -25");
+
+    EXPECT_EQ(ddwaf_log_drain(0), 1);
+    ASSERT_EQ(messages.size(), 2);
+    EXPECT_EQ(messages[1], "String thisisastring");
+
+    // Pending messages are drained when deferred logging is disabled
+    DDWAF_INFO("Unsigned %u", 25);
+    EXPECT_TRUE(ddwaf_set_log_deferred(false));
+    ASSERT_EQ(messages.size(), 3);
+    EXPECT_EQ(messages[2], "Unsigned 25");
+
+    DDWAF_INFO("Immediate");
+    ASSERT_EQ(messages.size(), 4);
+    EXPECT_EQ(messages[3], "Immediate");
+    EXPECT_EQ(ddwaf_log_drain(0), 0);
+}
+
 TEST(TestPowerWAF, TestConfig)
 {
     auto rule = readFile("powerwaf.yaml");
@@ -6,6 +6,16 @@
 
 #include "test.h"
 
+namespace {
+
+class timer_probe : public ddwaf::timer {
+public:
+    using timer::timer;
+    [[nodiscard]] uint32_t period() const { return period_; }
+};
+
+} // namespace
+
 TEST(TestTimer, Basic)
 {
     ddwaf::timer deadline{2ms, 1};
@@ -23,6 +33,19 @@ TEST(TestTimer, ExpiredFromConstruction)
     EXPECT_TRUE(deadline.expired());
 }
 
+TEST(TestTimer, Remaining)
+{
+    ddwaf::timer deadline{1s};
+    EXPECT_GT(deadline.remaining(), 0ns);
+    EXPECT_LE(deadline.remaining(), 1s);
+
+    deadline.expire();
+    EXPECT_EQ(deadline.remaining(), 0ns);
+
+    ddwaf::timer expired{0us};
+    EXPECT_EQ(expired.remaining(), 0ns);
+}
+
 TEST(TestTimer, ValidatePeriod)
 {
     ddwaf::timer deadline{1ms, 5};
@@ -36,3 +59,103 @@ TEST(TestTimer, ValidatePeriod)
     EXPECT_TRUE(deadline.expired());
     EXPECT_TRUE(deadline.expired());
 }
+
+TEST(TestTimer, AdaptivePeriod)
+{
+    ddwaf::timer deadline{1ms};
+    EXPECT_FALSE(deadline.expired());
+
+    uint64_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!deadline.expired()) { ++calls; }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // The clock is read at least twice within the remaining time, so the
+    // deadline can't be overshot by more than a fraction of it, scheduling
+    // aside.
+    EXPECT_GT(calls, 0);
+    EXPECT_LT(elapsed, 20ms);
+    EXPECT_TRUE(deadline.expired_before());
+}
+
+TEST(TestTimer, AdaptivePeriodSlowCalls)
+{
+    ddwaf::timer deadline{5ms};
+    for (unsigned i = 0; i < 100; ++i) {
+        if (deadline.expired()) {
+            break;
+        }
+        std::this_thread::sleep_for(100us);
+    }
+    EXPECT_TRUE(deadline.expired_before());
+}
+
+TEST(TestTimer, AdaptivePeriodBounded)
+{
+    // Fast calls on a long deadline would otherwise grow the period well
+    // beyond the bound
+    timer_probe deadline{1s};
+    for (unsigned i = 0; i < 100000; ++i) {
+        ASSERT_FALSE(deadline.expired());
+        EXPECT_LE(deadline.period(), ddwaf::timer::max_check_period);
+    }
+}
+
+TEST(TestTimer, LongDeadline)
+{
+    ddwaf::timer deadline{std::chrono::microseconds::max()};
+    for (unsigned i = 0; i < 10000; ++i) { EXPECT_FALSE(deadline.expired()); }
+    EXPECT_GE(deadline.elapsed().count(), 0);
+}
+
+TEST(TestDeadlineClock, Conversions)
+{
+    using ddwaf::deadline_clock;
+
+    EXPECT_EQ(deadline_clock::to_ticks(0ns), 0);
+    EXPECT_EQ(deadline_clock::to_ticks(-1ns), 0);
+    EXPECT_GT(deadline_clock::to_ticks(std::chrono::nanoseconds::max()),
+        deadline_clock::to_ticks(std::chrono::hours(24 * 365)));
+    EXPECT_EQ(deadline_clock::to_duration(UINT64_MAX), std::chrono::nanoseconds::max());
+
+    auto round_trip = deadline_clock::to_duration(deadline_clock::to_ticks(1ms));
+    EXPECT_NEAR(static_cast<double>(round_trip.count()), 1e6, 1e3);
+}
+
+TEST(TestDeadlineClock, ElapsedMatchesMonotonicClock)
+{
+    using ddwaf::deadline_clock;
+
+    auto start = ddwaf::monotonic_clock::now();
+    auto start_ticks = deadline_clock::now();
+    std::this_thread::sleep_for(5ms);
+    auto ticks = deadline_clock::now() - start_ticks;
+    auto expected = ddwaf::monotonic_clock::now() - start;
+
+    auto elapsed = deadline_clock::to_duration(ticks);
+    EXPECT_NEAR(static_cast<double>(elapsed.count()),
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(expected).count()),
+        5e5);
+}
+
+TEST(TestDeadlineClock, Initialise)
+{
+    using ddwaf::deadline_clock;
+
+    // Calibration is only performed once
+    deadline_clock::initialise();
+    auto uses_tsc = deadline_clock::uses_tsc();
+    deadline_clock::initialise();
+    EXPECT_EQ(deadline_clock::uses_tsc(), uses_tsc);
+
+    auto start = ddwaf::monotonic_clock::now();
+    auto start_ticks = deadline_clock::now();
+    std::this_thread::sleep_for(5ms);
+    auto ticks = deadline_clock::now() - start_ticks;
+    auto expected = ddwaf::monotonic_clock::now() - start;
+
+    auto elapsed = deadline_clock::to_duration(ticks);
+    EXPECT_NEAR(static_cast<double>(elapsed.count()),
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(expected).count()),
+        5e5);
+}
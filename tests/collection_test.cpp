@@ -491,3 +491,62 @@ TEST(TestPriorityCollection, MatchAllIfMissing)
         EXPECT_NE(seen_actions.find("block"), seen_actions.end());
     }
 }
+
+TEST(TestCollectionSchedule, SkipExpensiveRules)
+{
+    std::unordered_set<std::string_view> seen_actions;
+    ddwaf::manifest manifest;
+
+    auto make_rule = [&](const std::string &id, std::vector<std::string> actions) {
+        std::vector<ddwaf::condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+        auto cond = std::make_shared<condition>(std::move(targets),
+            std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.1"}));
+
+        std::unordered_map<std::string, std::string> tags{
+            {"type", "type"}, {"category", "category"}};
+        return std::make_shared<ddwaf::rule>(id, "name", std::move(tags),
+            std::vector<condition::ptr>{std::move(cond)}, std::move(actions));
+    };
+
+    auto cheap = make_rule("cheap", {});
+    auto expensive = make_rule("expensive", {});
+    auto blocking = make_rule("blocking", {"block"});
+
+    // The expensive rule costs more than the time available, which isn't the
+    // case of the cheap rule, while rules with actions are never skipped.
+    rule_cost_map costs{{cheap.get(), collection::min_skippable_cost - 1},
+        {expensive.get(), 3600ULL * 1000 * 1000 * 1000},
+        {blocking.get(), 3600ULL * 1000 * 1000 * 1000}};
+
+    collection rule_collection;
+    rule_collection.insert(expensive);
+    rule_collection.insert(cheap);
+    rule_collection.insert(blocking);
+    rule_collection.order(costs);
+    EXPECT_EQ(rule_collection.cost(), costs[expensive.get()] * 2 + costs[cheap.get()]);
+
+    ddwaf::object_store store(manifest);
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.2"));
+    store.insert(root);
+
+    auto cache = rule_collection.get_cache();
+    std::vector<event> events;
+    ddwaf::timer deadline{2s};
+    rule_collection.match(events, seen_actions, store, cache, {}, {}, {}, deadline);
+    EXPECT_EQ(events.size(), 0);
+
+    ASSERT_EQ(cache.skipped_rules.size(), 1);
+    EXPECT_STREQ(cache.skipped_rules[0].data(), "expensive");
+
+    // Both the cheap and the blocking rules have been evaluated
+    EXPECT_EQ(cache.rule_cache.size(), 3);
+    EXPECT_FALSE(cache.rule_cache[cheap].conditions.empty());
+    EXPECT_FALSE(cache.rule_cache[blocking].conditions.empty());
+    EXPECT_TRUE(cache.rule_cache[expensive].conditions.empty());
+}
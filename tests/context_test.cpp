@@ -2148,3 +2148,347 @@ TEST(TestContext, InputFilterMultipleRulesMultipleFiltersMultipleObjects)
         EXPECT_EQ(events.size(), 0);
     }
 }
+
+namespace {
+std::shared_ptr<ddwaf::ruleset> make_multi_collection_ruleset(
+    std::size_t count, bool with_priority = true)
+{
+    auto ruleset = std::make_shared<ddwaf::ruleset>();
+    ddwaf::manifest manifest;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::vector<ddwaf::condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+        auto cond = std::make_shared<condition>(std::move(targets),
+            std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.1"}));
+
+        std::vector<std::shared_ptr<condition>> conditions{std::move(cond)};
+
+        auto index = std::to_string(i);
+        std::unordered_map<std::string, std::string> tags{
+            {"type", "type" + index}, {"category", "category"}};
+
+        // Every other rule has an action and ends up in a priority collection
+        std::vector<std::string> actions;
+        if (with_priority && i % 2 == 0) {
+            actions.emplace_back("block");
+        }
+
+        ruleset->insert_rule(std::make_shared<ddwaf::rule>("id" + index, "name" + index,
+            std::move(tags), std::move(conditions), std::move(actions)));
+    }
+    ruleset->manifest = manifest;
+    return ruleset;
+}
+
+std::vector<std::string_view> match_ids(const std::shared_ptr<ddwaf::ruleset> &ruleset)
+{
+    ddwaf::timer deadline{2s};
+    ddwaf::test::context ctx(ruleset);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+    ctx.insert(root);
+
+    std::vector<std::string_view> ids;
+    for (const auto &event : ctx.match({}, {}, deadline)) { ids.emplace_back(event.id); }
+    return ids;
+}
+} // namespace
+
+TEST(TestContext, MatchParallelCollections)
+{
+    auto ruleset = make_multi_collection_ruleset(16);
+    auto expected = match_ids(ruleset);
+    EXPECT_EQ(expected.size(), 16);
+
+    auto pool = std::make_shared<thread_pool>(3);
+    ruleset->run_pool = thread_pool_ref{pool};
+    ruleset->parallel_match = true;
+
+    // Events are produced in the same order regardless of the evaluation mode
+    for (unsigned i = 0; i < 20; ++i) { EXPECT_EQ(match_ids(ruleset), expected); }
+}
+
+TEST(TestContext, MatchParallelCollectionsTimeout)
+{
+    // Only regular collections, so the timeout is raised by a worker
+    auto ruleset = make_multi_collection_ruleset(4, false);
+    auto pool = std::make_shared<thread_pool>(3);
+    ruleset->run_pool = thread_pool_ref{pool};
+    ruleset->parallel_match = true;
+
+    ddwaf::timer deadline{0s};
+    ddwaf::test::context ctx(ruleset);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+    ctx.insert(root);
+
+    EXPECT_THROW(ctx.match({}, {}, deadline), ddwaf::timeout_exception);
+    EXPECT_TRUE(deadline.expired_before());
+}
+
+namespace {
+class slow_processor : public rule_processor::base {
+public:
+    [[nodiscard]] std::optional<event::match> match(std::string_view /*str*/) const override
+    {
+        std::this_thread::sleep_for(1ms);
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::string_view name() const override { return "slow"; }
+};
+
+const ddwaf_object *find_key(const ddwaf_object &map, std::string_view key)
+{
+    for (std::size_t i = 0; i < map.nbEntries; ++i) {
+        const auto &entry = map.array[i];
+        if (std::string_view{entry.parameterName, entry.parameterNameLength} == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+TEST(TestContext, TimeoutDiagnostics)
+{
+    ddwaf::manifest manifest;
+    auto ruleset = std::make_shared<ddwaf::ruleset>();
+
+    {
+        std::vector<ddwaf::condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+        auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.1"}));
+
+        std::vector<std::shared_ptr<condition>> conditions{std::move(cond)};
+        std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "c"}};
+
+        ruleset->insert_rule(std::make_shared<ddwaf::rule>(
+            "1", "name", std::move(tags), std::move(conditions), std::vector<std::string>{}));
+    }
+
+    {
+        std::vector<ddwaf::condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+        auto ip_cond = std::make_shared<condition>(std::move(targets),
+            std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.2"}));
+
+        targets.clear();
+        targets.push_back({manifest.insert("usr.id"), "usr.id", {}});
+        auto slow_cond = std::make_shared<condition>(
+            std::move(targets), std::vector<PW_TRANSFORM_ID>{}, std::make_unique<slow_processor>());
+
+        std::vector<std::shared_ptr<condition>> conditions{
+            std::move(ip_cond), std::move(slow_cond)};
+        std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "c"}};
+
+        ruleset->insert_rule(std::make_shared<ddwaf::rule>(
+            "2", "name", std::move(tags), std::move(conditions), std::vector<std::string>{}));
+    }
+
+    ruleset->manifest = manifest;
+    ruleset->event_obfuscator = std::make_shared<ddwaf::obfuscator>();
+
+    ddwaf::test::context ctx(ruleset);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object ids;
+    ddwaf_object_map(&root);
+    ddwaf_object_array(&ids);
+    for (unsigned i = 0; i < 64; ++i) {
+        ddwaf_object_array_add(&ids, ddwaf_object_string(&tmp, "id"));
+    }
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.2"));
+    ddwaf_object_map_add(&root, "usr.id", &ids);
+
+    ddwaf_result result;
+    EXPECT_EQ(ctx.run(root, result, 5000), DDWAF_OK);
+    EXPECT_TRUE(result.timeout);
+    ddwaf_result_free(&result);
+
+    ddwaf_object diagnostics;
+    ASSERT_TRUE(ctx.diagnostics(diagnostics));
+    ASSERT_EQ(diagnostics.type, DDWAF_OBJ_MAP);
+
+    const auto *phase = find_key(diagnostics, "phase");
+    ASSERT_NE(phase, nullptr);
+    EXPECT_STREQ(phase->stringValue, "collections");
+
+    const auto *rule = find_key(diagnostics, "rule");
+    ASSERT_NE(rule, nullptr);
+    EXPECT_STREQ(rule->stringValue, "2");
+
+    const auto *condition = find_key(diagnostics, "condition");
+    ASSERT_NE(condition, nullptr);
+    EXPECT_EQ(condition->uintValue, 1);
+
+    const auto *address = find_key(diagnostics, "address");
+    ASSERT_NE(address, nullptr);
+    EXPECT_STREQ(address->stringValue, "usr.id");
+
+    const auto *completed = find_key(diagnostics, "rules_completed");
+    ASSERT_NE(completed, nullptr);
+    EXPECT_EQ(completed->uintValue, 1);
+
+    const auto *total = find_key(diagnostics, "rules_total");
+    ASSERT_NE(total, nullptr);
+    EXPECT_EQ(total->uintValue, 2);
+    ddwaf_object_free(&diagnostics);
+}
+
+TEST(TestContext, TimeoutDiagnosticsRuleFilter)
+{
+    ddwaf::manifest manifest;
+    auto ruleset = std::make_shared<ddwaf::ruleset>();
+
+    std::vector<ddwaf::condition::target_type> targets;
+    targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+    auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::ip_match>(std::vector<std::string_view>{"192.168.0.1"}));
+
+    std::vector<std::shared_ptr<condition>> conditions{std::move(cond)};
+    auto filter = std::make_shared<rule_filter>(
+        "filter", std::move(conditions), std::set<ddwaf::rule *>{});
+    ruleset->rule_filters.emplace(filter->get_id(), filter);
+    ruleset->manifest = manifest;
+
+    ddwaf::timer deadline{0s};
+    ddwaf::test::context ctx(ruleset);
+
+    try {
+        ctx.filter_rules(deadline);
+        FAIL() << "Expected a timeout";
+    } catch (const ddwaf::timeout_exception &e) {
+        EXPECT_EQ(e.id, "filter");
+        EXPECT_FALSE(e.condition.has_value());
+    }
+}
+
+TEST(TestContext, SharedConditionWithExcludedObjects)
+{
+    ddwaf::manifest manifest;
+    condition::target_type client_ip{manifest.insert("http.client_ip"), "http.client_ip", {}};
+
+    std::vector<ddwaf::condition::target_type> targets{client_ip};
+    auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::ip_match>(std::vector<std::string_view>{"192.168.0.1"}));
+
+    std::unordered_map<std::string, std::string> tags{{"type", "type1"}, {"category", "category"}};
+    auto rule1 = std::make_shared<ddwaf::rule>("id1", "name", std::move(tags),
+        std::vector<condition::ptr>{cond}, std::vector<std::string>{});
+
+    tags = {{"type", "type2"}, {"category", "category"}};
+    auto rule2 = std::make_shared<ddwaf::rule>("id2", "name", std::move(tags),
+        std::vector<condition::ptr>{cond}, std::vector<std::string>{});
+
+    auto obj_filter = std::make_shared<object_filter>();
+    obj_filter->insert(client_ip.root);
+
+    std::vector<condition::ptr> filter_conditions;
+    std::set<ddwaf::rule *> filter_rules{rule2.get()};
+    auto filter = std::make_shared<input_filter>(
+        "1", std::move(filter_conditions), std::move(filter_rules), std::move(obj_filter));
+
+    auto ruleset = std::make_shared<ddwaf::ruleset>();
+    ruleset->insert_rule(rule1);
+    ruleset->insert_rule(rule2);
+    ruleset->shared_conditions.emplace(cond.get());
+    ruleset->manifest = manifest;
+    ruleset->input_filters.emplace(filter->get_id(), filter);
+
+    ddwaf::timer deadline{2s};
+    ddwaf::test::context ctx(ruleset);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+    ctx.insert(root);
+
+    // The verdict of the shared condition can't be reused by the rule with
+    // excluded objects, regardless of the order in which they're evaluated.
+    auto objects_to_exclude = ctx.filter_inputs({}, deadline);
+    EXPECT_EQ(objects_to_exclude.size(), 1);
+    auto events = ctx.match({}, objects_to_exclude, deadline);
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_STREQ(events[0].id.data(), "id1");
+}
+
+TEST(TestContext, SkippedRulesDiagnostics)
+{
+    ddwaf::manifest manifest;
+    auto ruleset = std::make_shared<ddwaf::ruleset>();
+
+    std::vector<rule::ptr> rules;
+    for (const auto *id : {"cheap", "expensive"}) {
+        std::vector<ddwaf::condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+        auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.1"}));
+
+        std::vector<std::shared_ptr<condition>> conditions{std::move(cond)};
+        std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "c"}};
+
+        rules.emplace_back(std::make_shared<ddwaf::rule>(
+            id, "name", std::move(tags), std::move(conditions), std::vector<std::string>{}));
+        ruleset->insert_rule(rules.back());
+    }
+
+    ruleset->order_rules({{rules[0].get(), 10}, {rules[1].get(), 3600ULL * 1000 * 1000 * 1000}});
+    ruleset->manifest = manifest;
+    ruleset->event_obfuscator = std::make_shared<ddwaf::obfuscator>();
+
+    ddwaf::test::context ctx(ruleset);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.2"));
+
+    ddwaf_result result;
+    EXPECT_EQ(ctx.run(root, result, LONG_TIME), DDWAF_OK);
+    EXPECT_FALSE(result.timeout);
+    ddwaf_result_free(&result);
+
+    ddwaf_object diagnostics;
+    ASSERT_TRUE(ctx.diagnostics(diagnostics));
+    ASSERT_EQ(diagnostics.type, DDWAF_OBJ_MAP);
+    EXPECT_EQ(find_key(diagnostics, "phase"), nullptr);
+
+    const auto *skipped = find_key(diagnostics, "skipped_rules");
+    ASSERT_NE(skipped, nullptr);
+    ASSERT_EQ(skipped->type, DDWAF_OBJ_ARRAY);
+    ASSERT_EQ(skipped->nbEntries, 1);
+    EXPECT_STREQ(skipped->array[0].stringValue, "expensive");
+    ddwaf_object_free(&diagnostics);
+
+    // Skipped rules don't accumulate across runs
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.3"));
+    EXPECT_EQ(ctx.run(root, result, LONG_TIME), DDWAF_OK);
+    ddwaf_result_free(&result);
+
+    ASSERT_TRUE(ctx.diagnostics(diagnostics));
+    skipped = find_key(diagnostics, "skipped_rules");
+    ASSERT_NE(skipped, nullptr);
+    EXPECT_EQ(skipped->nbEntries, 1);
+    ddwaf_object_free(&diagnostics);
+}
@@ -0,0 +1,176 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <cost.hpp>
+
+using namespace ddwaf;
+
+namespace {
+
+condition::ptr make_condition(manifest &m, const std::string &address,
+    rule_processor::base::ptr processor, std::vector<std::string> key_path = {},
+    std::vector<PW_TRANSFORM_ID> transformers = {})
+{
+    std::vector<condition::target_type> targets;
+    targets.push_back({m.insert(address), address, std::move(key_path)});
+    return std::make_shared<condition>(
+        std::move(targets), std::move(transformers), std::move(processor));
+}
+
+rule_processor::base::ptr make_regex(const std::string &regex)
+{
+    return std::make_shared<rule_processor::regex_match>(regex, 0, true);
+}
+
+rule_processor::base::ptr make_exact(std::vector<std::string> values)
+{
+    return std::make_shared<rule_processor::exact_match>(std::move(values));
+}
+
+rule::ptr make_rule(const std::string &id, std::vector<condition::ptr> conditions)
+{
+    std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "cat"}};
+    return std::make_shared<rule>(id, "name", std::move(tags), std::move(conditions));
+}
+
+} // namespace
+
+TEST(TestCost, ConditionCost)
+{
+    manifest m;
+    auto exact = make_condition(m, "server.request.uri.raw", make_exact({"/admin"}));
+    auto regex = make_condition(m, "server.request.uri.raw", make_regex("^/admin"));
+    auto transformed = make_condition(
+        m, "server.request.uri.raw", make_regex("^/admin"), {}, {PWT_LOWERCASE, PWT_NONULL});
+    auto key_path = make_condition(
+        m, "server.request.query", make_regex("^/admin"), std::vector<std::string>{"key"});
+    auto missing = make_condition(m, "server.request.uri.raw", nullptr);
+
+    EXPECT_LT(estimate_cost(*exact, {}), estimate_cost(*regex, {}));
+    EXPECT_LT(estimate_cost(*regex, {}), estimate_cost(*transformed, {}));
+    EXPECT_LT(estimate_cost(*key_path, {}), estimate_cost(*regex, {}));
+    EXPECT_GT(estimate_cost(*missing, {}), 0);
+}
+
+TEST(TestCost, RuleCost)
+{
+    manifest m;
+    auto exact = make_condition(m, "server.request.uri.raw", make_exact({"/admin"}));
+    auto regex = make_condition(m, "server.request.body", make_regex("^admin"));
+
+    auto single = make_rule("single", {regex});
+    auto exact_first = make_rule("exact_first", {exact, regex});
+    auto regex_first = make_rule("regex_first", {regex, exact});
+
+    // Subsequent conditions are only evaluated a fraction of the time
+    EXPECT_GT(estimate_cost(*exact_first, {}), estimate_cost(*exact, {}));
+    EXPECT_LT(estimate_cost(*exact_first, {}), estimate_cost(*single, {}));
+    EXPECT_LT(estimate_cost(*exact_first, {}), estimate_cost(*regex_first, {}));
+}
+
+TEST(TestCost, ObservedSamples)
+{
+    manifest m;
+    auto cheap = make_rule(
+        "cheap", {make_condition(m, "server.request.uri.raw", make_exact({"/admin"}))});
+    auto expensive =
+        make_rule("expensive", {make_condition(m, "server.request.body", make_regex("^admin"))});
+    auto unsampled = make_rule(
+        "unsampled", {make_condition(m, "server.request.uri.raw", make_exact({"/login"}))});
+
+    std::unordered_map<std::string_view, rule::ptr> rules{
+        {cheap->id, cheap}, {expensive->id, expensive}, {unsampled->id, unsampled}};
+
+    auto costs = estimate_costs(rules, {});
+    EXPECT_LT(costs[cheap.get()], costs[expensive.get()]);
+    EXPECT_EQ(costs[cheap.get()], costs[unsampled.get()]);
+
+    // The samples contradict the static estimates, while the rules without
+    // enough samples are scaled accordingly.
+    std::unordered_map<std::string_view, metrics::rule_sample> samples{
+        {"cheap", {{100, 100 * 50000}, {}}}, {"expensive", {{100, 100 * 1000}, {}}},
+        {"unsampled", {{1, 1}, {}}}};
+    costs = estimate_costs(rules, {}, &samples);
+    EXPECT_EQ(costs[cheap.get()], 50000);
+    EXPECT_EQ(costs[expensive.get()], 1000);
+    EXPECT_GT(costs[unsampled.get()], estimate_cost(*unsampled, {}));
+}
+
+TEST(TestCost, CollectionOrder)
+{
+    manifest m;
+    auto expensive = make_rule(
+        "0-expensive", {make_condition(m, "server.request.uri.raw", make_regex("admin"))});
+    auto cheap = make_rule(
+        "1-cheap", {make_condition(m, "server.request.uri.raw", make_exact({"/admin"}))});
+
+    std::unordered_map<std::string_view, rule::ptr> rules{
+        {expensive->id, expensive}, {cheap->id, cheap}};
+
+    collection rule_collection;
+    rule_collection.insert(expensive);
+    rule_collection.insert(cheap);
+    rule_collection.order(estimate_costs(rules, {}));
+
+    object_store store(m);
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "server.request.uri.raw", ddwaf_object_string(&tmp, "/admin"));
+    store.insert(root);
+
+    // Both rules match, only the first one evaluated is reported
+    std::unordered_set<std::string_view> seen_actions;
+    auto cache = rule_collection.get_cache();
+    std::vector<event> events;
+    ddwaf::timer deadline{2s};
+    rule_collection.match(events, seen_actions, store, cache, {}, {}, {}, deadline, nullptr);
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].id, "1-cheap");
+}
+
+TEST(TestCost, ConditionOrder)
+{
+    manifest m;
+    auto exact = make_condition(m, "server.request.uri.raw", make_exact({"/admin"}));
+    auto regex = make_condition(m, "server.request.body", make_regex("^admin"));
+
+    EXPECT_TRUE(condition_order(*make_rule("single", {regex}), {}).empty());
+    EXPECT_TRUE(condition_order(*make_rule("ordered", {exact, regex}), {}).empty());
+
+    auto reversed = make_rule("reversed", {regex, exact});
+    EXPECT_EQ(condition_order(*reversed, {}), (std::vector<std::size_t>{1, 0}));
+
+    // The evaluation order is taken into account when estimating rule costs
+    auto cost = estimate_cost(*reversed, {});
+    reversed->evaluation_order = {1, 0};
+    EXPECT_LT(estimate_cost(*reversed, {}), cost);
+}
+
+TEST(TestCost, ConditionOrderFromSamples)
+{
+    manifest m;
+    auto exact = make_condition(m, "server.request.uri.raw", make_exact({"/admin"}));
+    auto regex = make_condition(m, "server.request.body", make_regex("^admin"));
+    auto r = make_rule("rule", {exact, regex});
+
+    // The exact match is cheap but almost never rejects the evaluation, while
+    // the regex is slightly more expensive but almost always does.
+    metrics::rule_sample sample;
+    sample.conditions = {{1000, 1000 * 100, 990}, {1000, 1000 * 200, 10}};
+    EXPECT_EQ(condition_order(*r, {}, &sample), (std::vector<std::size_t>{1, 0}));
+
+    // Not enough samples, the static estimates are used
+    sample.conditions = {{1, 100, 1}, {1, 200, 0}};
+    EXPECT_TRUE(condition_order(*r, {}, &sample).empty());
+
+    // Samples which don't correspond to the rule are ignored
+    sample.conditions = {{1000, 1000 * 100, 990}};
+    EXPECT_TRUE(condition_order(*r, {}, &sample).empty());
+}
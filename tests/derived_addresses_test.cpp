@@ -0,0 +1,118 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <derived_addresses.hpp>
+
+using namespace ddwaf;
+
+namespace {
+std::string_view entry_key(const ddwaf_object &entry)
+{
+    return {entry.parameterName, static_cast<std::size_t>(entry.parameterNameLength)};
+}
+
+std::string_view entry_value(const ddwaf_object &entry, std::size_t index)
+{
+    const auto &value = entry.array[index];
+    return {value.stringValue, static_cast<std::size_t>(value.nbEntries)};
+}
+} // namespace
+
+TEST(TestDerivedAddresses, DecomposeQuery)
+{
+    decomposed_object output;
+    EXPECT_TRUE(decompose_query("/path?a=1&b=two+words&a=%3Cscript%3E&c#a=fragment", output));
+
+    const auto &root = output.root;
+    EXPECT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 3);
+
+    EXPECT_EQ(entry_key(root.array[0]), "a");
+    ASSERT_EQ(root.array[0].nbEntries, 2);
+    EXPECT_EQ(entry_value(root.array[0], 0), "1");
+    EXPECT_EQ(entry_value(root.array[0], 1), "<script>");
+
+    EXPECT_EQ(entry_key(root.array[1]), "b");
+    ASSERT_EQ(root.array[1].nbEntries, 1);
+    EXPECT_EQ(entry_value(root.array[1], 0), "two words");
+
+    EXPECT_EQ(entry_key(root.array[2]), "c");
+    ASSERT_EQ(root.array[2].nbEntries, 1);
+    EXPECT_EQ(entry_value(root.array[2], 0), "");
+}
+
+TEST(TestDerivedAddresses, DecomposeQueryReferencesSource)
+{
+    std::string uri = "/path?key=value";
+
+    decomposed_object output;
+    EXPECT_TRUE(decompose_query(uri, output));
+    ASSERT_EQ(output.root.nbEntries, 1);
+
+    // Components which don't require decoding aren't copied
+    const auto &entry = output.root.array[0];
+    EXPECT_EQ(entry.parameterName, uri.data() + 6);
+    EXPECT_EQ(entry.array[0].stringValue, uri.data() + 10);
+    EXPECT_TRUE(output.decoded.empty());
+}
+
+TEST(TestDerivedAddresses, DecomposeQueryInvalid)
+{
+    {
+        decomposed_object output;
+        EXPECT_FALSE(decompose_query("/path", output));
+    }
+
+    {
+        decomposed_object output;
+        EXPECT_FALSE(decompose_query("/path#?a=b", output));
+    }
+
+    {
+        decomposed_object output;
+        EXPECT_FALSE(decompose_query("/path?&&", output));
+    }
+
+    {
+        decomposed_object output;
+        EXPECT_TRUE(decompose_query("/path?a=%zz%4", output));
+        ASSERT_EQ(output.root.nbEntries, 1);
+        EXPECT_EQ(entry_value(output.root.array[0], 0), "%zz%4");
+    }
+}
+
+TEST(TestDerivedAddresses, DecomposeCookies)
+{
+    decomposed_object output;
+    EXPECT_TRUE(decompose_cookies(" session=abc ;theme=dark+mode; ; id=%41;session=def", output));
+
+    const auto &root = output.root;
+    EXPECT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 3);
+
+    EXPECT_EQ(entry_key(root.array[0]), "session");
+    ASSERT_EQ(root.array[0].nbEntries, 2);
+    EXPECT_EQ(entry_value(root.array[0], 0), "abc");
+    EXPECT_EQ(entry_value(root.array[0], 1), "def");
+
+    EXPECT_EQ(entry_key(root.array[1]), "theme");
+    EXPECT_EQ(entry_value(root.array[1], 0), "dark+mode");
+
+    EXPECT_EQ(entry_key(root.array[2]), "id");
+    EXPECT_EQ(entry_value(root.array[2], 0), "A");
+}
+
+TEST(TestDerivedAddresses, InsertDerivedSources)
+{
+    manifest m;
+    m.insert("server.request.query");
+
+    insert_derived_sources(m);
+    EXPECT_TRUE(m.find("server.request.uri.raw").has_value());
+    EXPECT_FALSE(m.find("server.request.cookies.raw").has_value());
+}
@@ -0,0 +1,71 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <histogram.hpp>
+
+using namespace ddwaf;
+
+TEST(TestHistogram, BucketBoundaries)
+{
+    for (uint64_t value = 0; value < histogram::sub_bucket_count; ++value) {
+        EXPECT_EQ(histogram::index(value), value);
+    }
+
+    EXPECT_EQ(histogram::index(16), 16);
+    EXPECT_EQ(histogram::index(31), 31);
+    EXPECT_EQ(histogram::index(32), 32);
+    EXPECT_EQ(histogram::index(33), 32);
+    EXPECT_EQ(histogram::index(34), 33);
+    EXPECT_EQ(histogram::index(UINT64_MAX), histogram::bucket_count - 1);
+
+    for (uint64_t value : std::vector<uint64_t>{17, 100, 1000, 123456789, 1ULL << 40, UINT64_MAX}) {
+        auto index = histogram::index(value);
+        EXPECT_LE(histogram::lowest_equivalent(index), value);
+        EXPECT_GE(histogram::highest_equivalent(index), value);
+
+        // Relative error bounded by the number of sub-buckets
+        auto width = histogram::highest_equivalent(index) - histogram::lowest_equivalent(index);
+        EXPECT_LE(width, value / histogram::sub_bucket_count);
+    }
+}
+
+TEST(TestHistogram, Quantiles)
+{
+    histogram h;
+    EXPECT_EQ(h.quantile(0.5), 0);
+
+    for (uint64_t value = 1; value <= 1000; ++value) { h.record(value); }
+
+    EXPECT_EQ(h.count(), 1000);
+    EXPECT_EQ(h.max(), 1000);
+    EXPECT_NEAR(h.quantile(0.5), 500, 500 / histogram::sub_bucket_count);
+    EXPECT_NEAR(h.quantile(0.99), 990, 990 / histogram::sub_bucket_count);
+    EXPECT_EQ(h.quantile(1.0), 1000);
+    EXPECT_EQ(h.quantile(0.0), 1);
+
+    h.reset();
+    EXPECT_EQ(h.count(), 0);
+    EXPECT_EQ(h.max(), 0);
+    EXPECT_EQ(h.quantile(0.5), 0);
+}
+
+TEST(TestHistogram, ConcurrentRecord)
+{
+    histogram h;
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < 4; ++i) {
+        threads.emplace_back([&h, i]() {
+            for (uint64_t value = 0; value < 1000; ++value) { h.record(value * (i + 1)); }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+
+    EXPECT_EQ(h.count(), 4000);
+    EXPECT_EQ(h.max(), 3996);
+}
@@ -1771,10 +1771,11 @@ TEST(TestInterface, UpdateEverything)
     for (auto *handle : {handle1, handle2, handle3, handle4, handle6, handle7, handle8, handle9}) {
         uint32_t size;
         const char *const *addresses = ddwaf_required_addresses(handle, &size);
-        EXPECT_EQ(size, 4);
+        EXPECT_EQ(size, 5);
 
+        // The raw URI is required as server.request.query can be derived from it
         std::set<std::string_view> available_addresses{"http.client_ip", "server.request.query",
-            "server.request.params", "server.response.status"};
+            "server.request.params", "server.response.status", "server.request.uri.raw"};
         while ((size--) != 0U) {
             EXPECT_NE(available_addresses.find(addresses[size]), available_addresses.end());
         }
@@ -1783,12 +1784,12 @@ TEST(TestInterface, UpdateEverything)
     for (auto *handle : {handle5}) {
         uint32_t size;
         const char *const *addresses = ddwaf_required_addresses(handle, &size);
-        EXPECT_EQ(size, 3);
+        EXPECT_EQ(size, 4);
 
         // While the ruleset contains 2 addresses, an existing object filter
-        // forces server.request.query to be kept
+        // forces server.request.query to be kept, along with its raw source
         std::set<std::string_view> available_addresses{
-            "http.client_ip", "usr.id", "server.request.query"};
+            "http.client_ip", "usr.id", "server.request.query", "server.request.uri.raw"};
         while ((size--) != 0U) {
             EXPECT_NE(available_addresses.find(addresses[size]), available_addresses.end());
         }
@@ -1804,3 +1805,995 @@ TEST(TestInterface, UpdateEverything)
     ddwaf_destroy(handle2);
     ddwaf_destroy(handle1);
 }
+
+TEST(TestInterface, ParallelCompilation)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {4}, {}};
+
+    ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.1"));
+
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        auto root = readRule(
+            R"({rules_data: [{id: usr_data, type: data_with_expiration, data: [{value: pepe, expiration: 0}]}, {id: ip_data, type: ip_with_expiration, data: [{value: 192.168.1.2, expiration: 0}]}]})");
+
+        ddwaf_handle new_handle = ddwaf_update(handle, &root, nullptr);
+        ASSERT_NE(new_handle, nullptr);
+        ddwaf_object_free(&root);
+        ddwaf_destroy(handle);
+
+        handle = new_handle;
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.1"));
+        ddwaf_object_map_add(&root, "usr.id", ddwaf_object_string(&tmp, "pepe"));
+
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, RunBatch)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    for (uint32_t threads : {0, 4}) {
+        ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+        ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {0, threads}, {}};
+
+        ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        constexpr std::size_t count = 16;
+        std::array<ddwaf_context, count> contexts{};
+        std::array<ddwaf_object, count> data{};
+        std::array<ddwaf_object *, count> data_ptrs{};
+        std::array<ddwaf_result, count> results{};
+
+        for (std::size_t i = 0; i < count; ++i) {
+            contexts[i] = ddwaf_context_init(handle);
+            ASSERT_NE(contexts[i], nullptr);
+
+            ddwaf_object tmp;
+            ddwaf_object_map(&data[i]);
+            ddwaf_object_map_add(&data[i], "http.client_ip",
+                ddwaf_object_string(&tmp, i % 2 == 0 ? "192.168.1.1" : "192.168.1.2"));
+            data_ptrs[i] = &data[i];
+        }
+
+        EXPECT_EQ(ddwaf_run_batch(contexts.data(), data_ptrs.data(), results.data(), count,
+                      LONG_TIME),
+            DDWAF_MATCH);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            EXPECT_FALSE(results[i].timeout);
+            if (i % 2 == 0) {
+                EXPECT_NE(results[i].data, nullptr);
+            } else {
+                EXPECT_EQ(results[i].data, nullptr);
+            }
+            ddwaf_result_free(&results[i]);
+            ddwaf_context_destroy(contexts[i]);
+        }
+
+        ddwaf_destroy(handle);
+    }
+
+    ddwaf_object_free(&rule);
+}
+
+TEST(TestInterface, RunBatchNoMatch)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {0, 2}, {}};
+
+    ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    std::array<ddwaf_context, 2> contexts{ddwaf_context_init(handle), ddwaf_context_init(handle)};
+    std::array<ddwaf_object, 2> data{};
+    std::array<ddwaf_object *, 2> data_ptrs{&data[0], &data[1]};
+
+    ddwaf_object tmp;
+    ddwaf_object_map(&data[0]);
+    ddwaf_object_map_add(&data[0], "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.2"));
+    ddwaf_object_map(&data[1]);
+    ddwaf_object_map_add(&data[1], "usr.id", ddwaf_object_string(&tmp, "admin"));
+
+    EXPECT_EQ(ddwaf_run_batch(contexts.data(), data_ptrs.data(), nullptr, 2, LONG_TIME), DDWAF_OK);
+
+    ddwaf_context_destroy(contexts[0]);
+    ddwaf_context_destroy(contexts[1]);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, RunBatchInvalidArguments)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object data;
+    ddwaf_object *data_ptr = &data;
+    ddwaf_object_map(&data);
+
+    EXPECT_EQ(ddwaf_run_batch(nullptr, &data_ptr, nullptr, 1, LONG_TIME),
+        DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(ddwaf_run_batch(&context, nullptr, nullptr, 1, LONG_TIME),
+        DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(ddwaf_run_batch(&context, &data_ptr, nullptr, 0, LONG_TIME), DDWAF_OK);
+
+    ddwaf_object *null_data = nullptr;
+    EXPECT_EQ(ddwaf_run_batch(&context, &null_data, nullptr, 1, LONG_TIME),
+        DDWAF_ERR_INVALID_ARGUMENT);
+
+    // The data is owned by the context after a successful call
+    EXPECT_EQ(ddwaf_run_batch(&context, &data_ptr, nullptr, 1, LONG_TIME), DDWAF_OK);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+namespace {
+struct async_state {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done{false};
+    DDWAF_RET_CODE code{DDWAF_ERR_INTERNAL};
+    bool has_data{false};
+    std::thread::id thread_id;
+};
+
+void async_callback(DDWAF_RET_CODE code, const ddwaf_result *result, void *user_data)
+{
+    auto *state = static_cast<async_state *>(user_data);
+    const std::lock_guard<std::mutex> lock(state->mtx);
+    state->code = code;
+    state->has_data = result->data != nullptr;
+    state->thread_id = std::this_thread::get_id();
+    state->done = true;
+    state->cv.notify_all();
+}
+
+void async_wait(async_state &state)
+{
+    std::unique_lock<std::mutex> lock(state.mtx);
+    ASSERT_TRUE(state.cv.wait_for(lock, 5s, [&state]() { return state.done; }));
+}
+} // namespace
+
+TEST(TestInterface, RunAsync)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    for (uint32_t threads : {0, 2}) {
+        ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+        ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {0, threads}, {}};
+
+        ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        {
+            ddwaf_object root;
+            ddwaf_object tmp;
+            ddwaf_object_map(&root);
+            ddwaf_object_map_add(&root, "usr.id", ddwaf_object_string(&tmp, "admin"));
+
+            async_state state;
+            EXPECT_EQ(ddwaf_run_async(context, &root, LONG_TIME, async_callback, &state), DDWAF_OK);
+            async_wait(state);
+            EXPECT_EQ(state.code, DDWAF_OK);
+            EXPECT_FALSE(state.has_data);
+            // Without run threads the operation is performed synchronously
+            EXPECT_EQ(state.thread_id == std::this_thread::get_id(), threads == 0);
+        }
+
+        {
+            ddwaf_object root;
+            ddwaf_object tmp;
+            ddwaf_object_map(&root);
+            ddwaf_object_map_add(
+                &root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.1"));
+
+            async_state state;
+            EXPECT_EQ(ddwaf_run_async(context, &root, LONG_TIME, async_callback, &state), DDWAF_OK);
+            async_wait(state);
+            EXPECT_EQ(state.code, DDWAF_MATCH);
+            EXPECT_TRUE(state.has_data);
+        }
+
+        ddwaf_context_destroy(context);
+        ddwaf_destroy(handle);
+    }
+
+    ddwaf_object_free(&rule);
+}
+
+TEST(TestInterface, RunAsyncDestroyContextInCallback)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {0, 2}, {}};
+
+    for (unsigned i = 0; i < 20; ++i) {
+        ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        struct destroy_state {
+            ddwaf_context context;
+            async_state async;
+        } state{ddwaf_context_init(handle), {}};
+        ASSERT_NE(state.context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.1"));
+
+        auto callback = [](DDWAF_RET_CODE code, const ddwaf_result *result, void *user_data) {
+            auto *current = static_cast<destroy_state *>(user_data);
+            ddwaf_context_destroy(current->context);
+            async_callback(code, result, &current->async);
+        };
+
+        EXPECT_EQ(ddwaf_run_async(state.context, &root, LONG_TIME, callback, &state), DDWAF_OK);
+
+        // The context might hold the last reference to the ruleset by the
+        // time the callback is invoked, in which case it's released on the
+        // worker while the handle is being destroyed.
+        ddwaf_destroy(handle);
+        async_wait(state.async);
+        EXPECT_EQ(state.async.code, DDWAF_MATCH);
+    }
+
+    ddwaf_object_free(&rule);
+}
+
+TEST(TestInterface, RunAsyncPendingOnDestroy)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {0, 2}, {}};
+
+    ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    std::vector<ddwaf_context> contexts;
+    std::vector<async_state> states(10);
+    for (auto &state : states) {
+        auto *context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+        contexts.push_back(context);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "usr.id", ddwaf_object_string(&tmp, "admin"));
+        EXPECT_EQ(ddwaf_run_async(context, &root, LONG_TIME, async_callback, &state), DDWAF_OK);
+    }
+
+    // Pending operations are completed before the handle is destroyed
+    ddwaf_destroy(handle);
+    for (auto &state : states) { EXPECT_TRUE(state.done); }
+
+    for (auto *context : contexts) { ddwaf_context_destroy(context); }
+}
+
+TEST(TestInterface, RunAsyncInvalidArguments)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object root;
+    ddwaf_object_map(&root);
+
+    async_state state;
+    EXPECT_EQ(ddwaf_run_async(nullptr, &root, LONG_TIME, async_callback, &state),
+        DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(ddwaf_run_async(context, nullptr, LONG_TIME, async_callback, &state),
+        DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(ddwaf_run_async(context, &root, LONG_TIME, nullptr, &state),
+        DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_FALSE(state.done);
+
+    ddwaf_object_free(&root);
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+namespace {
+struct provider_state {
+    const char *value;
+    unsigned calls{0};
+};
+
+bool string_provider(ddwaf_object *object, void *user_data)
+{
+    auto *state = static_cast<provider_state *>(user_data);
+    ++state->calls;
+    ddwaf_object_string(object, state->value);
+    return true;
+}
+} // namespace
+
+TEST(TestInterface, ContextProvide)
+{
+    auto rule = readFile("rule_data_with_data.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        provider_state state{"paco"};
+        EXPECT_TRUE(ddwaf_context_provide(context, "usr.id", string_provider, &state));
+        EXPECT_FALSE(
+            ddwaf_context_provide(context, "server.request.body", string_provider, &state));
+
+        ddwaf_object root;
+        ddwaf_object_map(&root);
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+        EXPECT_EQ(state.calls, 1);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        // The provider is invoked at most once, regardless of the number of runs
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        provider_state state{"pepe"};
+        EXPECT_TRUE(ddwaf_context_provide(context, "usr.id", string_provider, &state));
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.1"));
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+        EXPECT_EQ(state.calls, 1);
+
+        ddwaf_object_map(&root);
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_OK);
+        EXPECT_EQ(state.calls, 1);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        provider_state state{"paco"};
+        EXPECT_FALSE(ddwaf_context_provide(nullptr, "usr.id", string_provider, &state));
+        EXPECT_FALSE(ddwaf_context_provide(context, nullptr, string_provider, &state));
+        EXPECT_FALSE(ddwaf_context_provide(context, "usr.id", nullptr, &state));
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, RequiredKeyPaths)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: server.request.headers, key_path: [user-agent]}, {address: server.request.query}], regex: rule1}}]}]})");
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_object output;
+    ASSERT_TRUE(ddwaf_required_key_paths(handle, &output));
+    ASSERT_EQ(ddwaf_object_size(&output), 2);
+
+    auto *headers = ddwaf_object_get_index(&output, 0);
+    EXPECT_STREQ(headers->parameterName, "server.request.headers");
+    EXPECT_FALSE(ddwaf_object_get_bool(ddwaf_object_get_index(headers, 0)));
+
+    auto *paths = ddwaf_object_get_index(headers, 1);
+    ASSERT_EQ(ddwaf_object_size(paths), 1);
+    EXPECT_STREQ(ddwaf_object_get_string(
+                     ddwaf_object_get_index(ddwaf_object_get_index(paths, 0), 0), nullptr),
+        "user-agent");
+
+    auto *query = ddwaf_object_get_index(&output, 1);
+    EXPECT_STREQ(query->parameterName, "server.request.query");
+    EXPECT_TRUE(ddwaf_object_get_bool(ddwaf_object_get_index(query, 0)));
+
+    ddwaf_object_free(&output);
+
+    EXPECT_FALSE(ddwaf_required_key_paths(nullptr, &output));
+    EXPECT_FALSE(ddwaf_required_key_paths(handle, nullptr));
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, RunChunk)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: server.request.body}], regex: attack}}]}]})");
+
+    // Windows of at most 16 bytes, overlapping by 8 bytes
+    ddwaf_config config{{0, 0, 16}, {nullptr, nullptr}, nullptr};
+    ddwaf_handle handle = ddwaf_init(&rule, &config, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    {
+        // Match spanning two chunks
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        EXPECT_EQ(ddwaf_run_chunk(context, "server.request.body", "xxxxxxatt", 9, false, nullptr,
+                      LONG_TIME),
+            DDWAF_OK);
+
+        ddwaf_result result;
+        EXPECT_EQ(ddwaf_run_chunk(
+                      context, "server.request.body", "ackyyy", 6, true, &result, LONG_TIME),
+            DDWAF_MATCH);
+        EXPECT_NE(result.data, nullptr);
+        ddwaf_result_free(&result);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        // Match beyond the maximum string length within a single chunk
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        std::string body(64, 'x');
+        body.replace(50, 6, "attack");
+
+        EXPECT_EQ(ddwaf_run_chunk(context, "server.request.body", body.c_str(), body.size(), true,
+                      nullptr, LONG_TIME),
+            DDWAF_MATCH);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        // The last chunk resets the value
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        EXPECT_EQ(ddwaf_run_chunk(
+                      context, "server.request.body", "xxatt", 5, true, nullptr, LONG_TIME),
+            DDWAF_OK);
+        EXPECT_EQ(
+            ddwaf_run_chunk(context, "server.request.body", "ack", 3, true, nullptr, LONG_TIME),
+            DDWAF_OK);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        EXPECT_EQ(ddwaf_run_chunk(nullptr, "server.request.body", "x", 1, true, nullptr, LONG_TIME),
+            DDWAF_ERR_INVALID_ARGUMENT);
+        EXPECT_EQ(ddwaf_run_chunk(context, nullptr, "x", 1, true, nullptr, LONG_TIME),
+            DDWAF_ERR_INVALID_ARGUMENT);
+        EXPECT_EQ(ddwaf_run_chunk(
+                      context, "server.request.body", nullptr, 1, true, nullptr, LONG_TIME),
+            DDWAF_ERR_INVALID_ARGUMENT);
+        EXPECT_EQ(
+            ddwaf_run_chunk(context, "server.request.body", nullptr, 0, true, nullptr, LONG_TIME),
+            DDWAF_OK);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, RunChunkWithInputExclusion)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: server.request.body}], regex: attack}}]}], exclusions: [{id: 1, inputs: [{address: server.request.body}]}]})");
+
+    ddwaf_config config{{0, 0, 16}, {nullptr, nullptr}, nullptr};
+    ddwaf_handle handle = ddwaf_init(&rule, &config, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    // The objects excluded on each window remain referenced by the context
+    // while subsequent windows are evaluated
+    for (unsigned i = 0; i < 4; ++i) {
+        EXPECT_EQ(ddwaf_run_chunk(context, "server.request.body", "xxattackxx", 10, false,
+                      nullptr, LONG_TIME),
+            DDWAF_OK);
+    }
+    EXPECT_EQ(
+        ddwaf_run_chunk(context, "server.request.body", "attack", 6, true, nullptr, LONG_TIME),
+        DDWAF_OK);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, ContextProvideRaw)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: server.request.body, key_path: [user, name]}], regex: admin}}]}]})");
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        std::string body = R"({"user": {"name": "admin", "role": "admin"}, "other": "admin"})";
+        EXPECT_TRUE(ddwaf_context_provide_raw(context, "server.request.body", body.c_str(),
+            body.size(), "application/json; charset=utf-8"));
+
+        ddwaf_object root;
+        ddwaf_object_map(&root);
+
+        ddwaf_result result;
+        EXPECT_EQ(ddwaf_run(context, &root, &result, LONG_TIME), DDWAF_MATCH);
+        EXPECT_NE(result.data, nullptr);
+        ddwaf_result_free(&result);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        std::string body = "user=admin&name=admin";
+        EXPECT_TRUE(ddwaf_context_provide_raw(context, "server.request.body", body.c_str(),
+            body.size(), "application/x-www-form-urlencoded"));
+
+        ddwaf_object root;
+        ddwaf_object_map(&root);
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_OK);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        std::string body = R"({"user": {"name": "admin")";
+        EXPECT_TRUE(ddwaf_context_provide_raw(
+            context, "server.request.body", body.c_str(), body.size(), "application/json"));
+        EXPECT_FALSE(ddwaf_context_provide_raw(
+            context, "server.request.body", body.c_str(), body.size(), "text/plain"));
+        EXPECT_FALSE(ddwaf_context_provide_raw(
+            context, "server.request.query", body.c_str(), body.size(), "application/json"));
+        EXPECT_FALSE(ddwaf_context_provide_raw(
+            context, "server.request.body", nullptr, body.size(), "application/json"));
+
+        // Invalid documents are treated as unavailable
+        ddwaf_object root;
+        ddwaf_object_map(&root);
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_OK);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, DerivedAddresses)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: server.request.query, key_path: [a]}, {address: server.request.cookies, key_path: [session]}], regex: attack}}]}]})");
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    uint32_t size;
+    const char *const *addresses = ddwaf_required_addresses(handle, &size);
+    std::set<std::string_view> required{addresses, addresses + size};
+    EXPECT_NE(required.find("server.request.uri.raw"), required.end());
+    EXPECT_NE(required.find("server.request.cookies.raw"), required.end());
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "server.request.uri.raw",
+            ddwaf_object_string(&tmp, "/path?b=attack&a=safe&a=%61ttack"));
+
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "server.request.cookies.raw",
+            ddwaf_object_string(&tmp, "theme=attack; session=attack"));
+
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+        ddwaf_context_destroy(context);
+    }
+
+    {
+        // Explicitly provided addresses take precedence over derived ones
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object query;
+        ddwaf_object_map(&root);
+        ddwaf_object_map(&query);
+        ddwaf_object_map_add(&query, "a", ddwaf_object_string(&tmp, "safe"));
+        ddwaf_object_map_add(&root, "server.request.query", &query);
+        ddwaf_object_map_add(
+            &root, "server.request.uri.raw", ddwaf_object_string(&tmp, "/path?a=attack"));
+
+        EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_OK);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, InitExtPartialSize)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: value1}], regex: rule1}}]}]})");
+
+    // Members beyond the size provided are ignored, as they might not be
+    // known by the caller.
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {}, {true}};
+    ext.size = offsetof(ddwaf_config_ext, profiling);
+
+    ddwaf_handle handle = ddwaf_init_ext(&rule, nullptr, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+
+    ddwaf_object output;
+    EXPECT_FALSE(ddwaf_get_metrics(handle, &output));
+    ddwaf_destroy(handle);
+
+    ext.size = sizeof(ddwaf_config_ext);
+    handle = ddwaf_init_ext(&rule, nullptr, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    EXPECT_TRUE(ddwaf_get_metrics(handle, &output));
+    ddwaf_object_free(&output);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, GetMetrics)
+{
+    auto rule = readRule(
+        R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: value1}], regex: rule1}}]}]})");
+
+    {
+        ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        ddwaf_object output;
+        EXPECT_FALSE(ddwaf_get_metrics(handle, &output));
+
+        ddwaf_destroy(handle);
+    }
+
+    ddwaf_config config{{0}, {nullptr, nullptr}, ddwaf_object_free};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {}, {true}};
+    ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    for (const auto *value : {"rule1", "other"}) {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, value));
+        ddwaf_run(context, &root, nullptr, LONG_TIME);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_object output;
+    ASSERT_TRUE(ddwaf_get_metrics(handle, &output));
+    ASSERT_EQ(ddwaf_object_type(&output), DDWAF_OBJ_MAP);
+    ASSERT_EQ(ddwaf_object_size(&output), 2);
+
+    auto *rules = ddwaf_object_get_index(&output, 0);
+    EXPECT_STREQ(rules->parameterName, "rules");
+    ASSERT_EQ(ddwaf_object_size(rules), 1);
+
+    auto *rule1 = ddwaf_object_get_index(rules, 0);
+    EXPECT_STREQ(rule1->parameterName, "1");
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(rule1, 0)), 2);
+
+    auto *processors = ddwaf_object_get_index(&output, 1);
+    EXPECT_STREQ(processors->parameterName, "processors");
+    auto *regex = ddwaf_object_get_index(processors, 0);
+    EXPECT_STREQ(regex->parameterName, "match_regex");
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(regex, 3)), 2);
+
+    ddwaf_object_free(&output);
+
+    EXPECT_FALSE(ddwaf_get_metrics(nullptr, &output));
+    EXPECT_FALSE(ddwaf_get_metrics(handle, nullptr));
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, ContextDiagnostics)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object output;
+    EXPECT_FALSE(ddwaf_context_diagnostics(nullptr, &output));
+    EXPECT_FALSE(ddwaf_context_diagnostics(context, nullptr));
+
+    // No diagnostics are available before the first run
+    EXPECT_FALSE(ddwaf_context_diagnostics(context, &output));
+    EXPECT_EQ(output.type, DDWAF_OBJ_INVALID);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, "rule1"));
+
+    ddwaf_result result;
+    EXPECT_EQ(ddwaf_run(context, &root, &result, LONG_TIME), DDWAF_MATCH);
+    EXPECT_FALSE(result.timeout);
+    ddwaf_result_free(&result);
+
+    // Nor after a run which neither timed out nor skipped rules
+    EXPECT_FALSE(ddwaf_context_diagnostics(context, &output));
+    EXPECT_EQ(output.type, DDWAF_OBJ_INVALID);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, Histograms)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    {
+        // Histograms are only collected when enabled
+        ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        ddwaf_object output;
+        EXPECT_FALSE(ddwaf_get_histograms(handle, &output));
+        ddwaf_reset_histograms(handle);
+
+        ddwaf_destroy(handle);
+    }
+
+    ddwaf_config config{{0, 0, 0}, {nullptr, nullptr}, nullptr};
+    ddwaf_config_ext ext{sizeof(ddwaf_config_ext), {}, {false, true}};
+    ddwaf_handle handle = ddwaf_init_ext(&rule, &config, &ext, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    for (unsigned i = 0; i < 3; ++i) {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, "rule1"));
+
+        ddwaf_result result;
+        EXPECT_EQ(ddwaf_run(context, &root, &result, LONG_TIME), DDWAF_MATCH);
+        ddwaf_result_free(&result);
+
+        ddwaf_context_destroy(context);
+    }
+
+    ddwaf_object output;
+    ASSERT_TRUE(ddwaf_get_histograms(handle, &output));
+    ASSERT_EQ(ddwaf_object_size(&output), 6);
+
+    auto *run = ddwaf_object_get_index(&output, 0);
+    EXPECT_STREQ(run->parameterName, "run");
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(run, 0)), 3);
+
+    auto *serialization = ddwaf_object_get_index(&output, 4);
+    EXPECT_STREQ(serialization->parameterName, "serialization");
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(serialization, 0)), 3);
+
+    // Each input consists of a map and a string
+    auto *input_size = ddwaf_object_get_index(&output, 5);
+    EXPECT_STREQ(input_size->parameterName, "input_size");
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(input_size, 2)), 2);
+    ddwaf_object_free(&output);
+
+    ddwaf_reset_histograms(handle);
+    ASSERT_TRUE(ddwaf_get_histograms(handle, &output));
+    run = ddwaf_object_get_index(&output, 0);
+    EXPECT_EQ(ddwaf_object_get_unsigned(ddwaf_object_get_index(run, 0)), 0);
+    ddwaf_object_free(&output);
+
+    EXPECT_FALSE(ddwaf_get_histograms(nullptr, &output));
+    EXPECT_FALSE(ddwaf_get_histograms(handle, nullptr));
+    ddwaf_reset_histograms(nullptr);
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestInterface, TraceHooks)
+{
+    struct trace_event {
+        bool begin;
+        DDWAF_TRACE_PHASE phase;
+        std::string name;
+        uint64_t timestamp;
+    };
+    std::vector<trace_event> trace;
+
+    ddwaf_trace_hooks hooks{&trace,
+        [](void *user_data, DDWAF_TRACE_PHASE phase, const char *name, uint64_t timestamp) {
+            static_cast<std::vector<trace_event> *>(user_data)->push_back(
+                {true, phase, name != nullptr ? name : "", timestamp});
+        },
+        [](void *user_data, DDWAF_TRACE_PHASE phase, const char *name, uint64_t timestamp) {
+            static_cast<std::vector<trace_event> *>(user_data)->push_back(
+                {false, phase, name != nullptr ? name : "", timestamp});
+        }};
+
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_TRUE(ddwaf_set_trace_hooks(handle, &hooks));
+    EXPECT_FALSE(ddwaf_set_trace_hooks(nullptr, &hooks));
+
+    auto run = [](ddwaf_handle handle) {
+        ddwaf_context context = ddwaf_context_init(handle);
+        ASSERT_NE(context, nullptr);
+
+        ddwaf_object root;
+        ddwaf_object tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, "rule1"));
+
+        ddwaf_result result;
+        EXPECT_EQ(ddwaf_run(context, &root, &result, LONG_TIME), DDWAF_MATCH);
+        ddwaf_result_free(&result);
+        ddwaf_context_destroy(context);
+    };
+
+    run(handle);
+
+    // Each phase is reported as a pair of begin and end events
+    ASSERT_EQ(trace.size(), 10);
+    std::set<std::string> collections;
+    for (std::size_t i = 0; i < trace.size(); i += 2) {
+        EXPECT_TRUE(trace[i].begin);
+        EXPECT_FALSE(trace[i + 1].begin);
+        EXPECT_EQ(trace[i].phase, trace[i + 1].phase);
+        EXPECT_EQ(trace[i].name, trace[i + 1].name);
+        EXPECT_LE(trace[i].timestamp, trace[i + 1].timestamp);
+        if (i > 0) {
+            EXPECT_LE(trace[i - 1].timestamp, trace[i].timestamp);
+        }
+
+        if (trace[i].phase == DDWAF_TRACE_COLLECTION) {
+            collections.emplace(trace[i].name);
+        } else {
+            EXPECT_TRUE(trace[i].name.empty());
+        }
+    }
+    EXPECT_EQ(trace[0].phase, DDWAF_TRACE_RULE_FILTERS);
+    EXPECT_EQ(trace[2].phase, DDWAF_TRACE_INPUT_FILTERS);
+    EXPECT_EQ(trace[8].phase, DDWAF_TRACE_SERIALIZATION);
+    EXPECT_EQ(collections, (std::set<std::string>{"flow1", "flow2"}));
+
+    // Hooks are preserved across updates
+    trace.clear();
+    ddwaf_handle updated = ddwaf_update(handle, &rule, nullptr);
+    ASSERT_NE(updated, nullptr);
+    ddwaf_object_free(&rule);
+
+    run(updated);
+    EXPECT_EQ(trace.size(), 10);
+
+    trace.clear();
+    EXPECT_TRUE(ddwaf_set_trace_hooks(handle, nullptr));
+    run(handle);
+    EXPECT_TRUE(trace.empty());
+
+    ddwaf_destroy(updated);
+    ddwaf_destroy(handle);
+}
@@ -0,0 +1,239 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+#include <json_loader.hpp>
+
+TEST(TestJsonLoader, ParseScalars)
+{
+    std::string json = R"({"string": "value", "escaped": "a\"b\\c", "signed": -5, "unsigned": 42, "bool": true, "null": null, "double": 1.5})";
+
+    auto tree = json::parse_insitu(json.data(), json.size());
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 7);
+
+    EXPECT_STRV(std::string_view(root.array[0].parameterName, root.array[0].parameterNameLength),
+        "string");
+    EXPECT_EQ(root.array[0].type, DDWAF_OBJ_STRING);
+    EXPECT_STRV(std::string_view(root.array[0].stringValue, root.array[0].nbEntries), "value");
+
+    EXPECT_EQ(root.array[1].type, DDWAF_OBJ_STRING);
+    EXPECT_STRV(std::string_view(root.array[1].stringValue, root.array[1].nbEntries), "a\"b\\c");
+    // Strings are always NUL-terminated
+    EXPECT_EQ(root.array[1].stringValue[root.array[1].nbEntries], '\0');
+
+    EXPECT_EQ(root.array[2].type, DDWAF_OBJ_SIGNED);
+    EXPECT_EQ(root.array[2].intValue, -5);
+
+    EXPECT_EQ(root.array[3].type, DDWAF_OBJ_UNSIGNED);
+    EXPECT_EQ(root.array[3].uintValue, 42);
+
+    EXPECT_EQ(root.array[4].type, DDWAF_OBJ_BOOL);
+    EXPECT_TRUE(root.array[4].boolean);
+
+    EXPECT_EQ(root.array[5].type, DDWAF_OBJ_INVALID);
+    EXPECT_EQ(root.array[6].type, DDWAF_OBJ_INVALID);
+}
+
+TEST(TestJsonLoader, ParseContainers)
+{
+    std::string json = R"({"array": [1, [], {}, ["a", "b"]], "map": {"key": {"nested": "value"}}})";
+
+    auto tree = json::parse_insitu(json.data(), json.size());
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 2);
+
+    const auto &array = root.array[0];
+    ASSERT_EQ(array.type, DDWAF_OBJ_ARRAY);
+    ASSERT_EQ(array.nbEntries, 4);
+    EXPECT_EQ(array.array[0].parameterName, nullptr);
+    EXPECT_EQ(array.array[1].type, DDWAF_OBJ_ARRAY);
+    EXPECT_EQ(array.array[1].nbEntries, 0);
+    EXPECT_EQ(array.array[2].type, DDWAF_OBJ_MAP);
+    EXPECT_EQ(array.array[2].nbEntries, 0);
+    EXPECT_EQ(array.array[3].nbEntries, 2);
+    EXPECT_STRV(std::string_view(array.array[3].array[1].stringValue, 1), "b");
+
+    const auto &map = root.array[1];
+    ASSERT_EQ(map.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(map.nbEntries, 1);
+    ASSERT_EQ(map.array[0].nbEntries, 1);
+    EXPECT_STRV(std::string_view(map.array[0].array[0].parameterName,
+                    map.array[0].array[0].parameterNameLength),
+        "nested");
+}
+
+TEST(TestJsonLoader, BufferNotTerminated)
+{
+    std::string json = R"({"key": "value"}XXXX)";
+
+    auto tree = json::parse_insitu(json.data(), json.size() - 4);
+    ASSERT_EQ(tree.root().nbEntries, 1);
+    EXPECT_STRV(std::string_view(tree.root().array[0].stringValue, 5), "value");
+}
+
+TEST(TestJsonLoader, InvalidJson)
+{
+    for (std::string json : {R"({"key": "value")", R"({"key": "value"} {})", R"({"key" "value"})",
+             R"()"}) {
+        EXPECT_THROW(json::parse_insitu(json.data(), json.size()), parsing_error);
+    }
+}
+
+TEST(TestJsonLoader, ParseWithKeyPaths)
+{
+    std::string json =
+        R"({"a": {"b": "kept", "c": "dropped", "d": {"e": 1}}, "f": ["dropped"], "g": {"h": [1, 2]}, "i": "dropped"})";
+
+    std::set<std::vector<std::string>> paths{{"a", "b"}, {"a", "d"}, {"f", "x"}, {"g"}};
+    json::parse_options options;
+    options.key_paths = &paths;
+
+    auto tree = json::parse_insitu(json.data(), json.size(), options);
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 3);
+
+    const auto &a = root.array[0];
+    EXPECT_STRV(std::string_view(a.parameterName, a.parameterNameLength), "a");
+    ASSERT_EQ(a.nbEntries, 2);
+    EXPECT_STRV(std::string_view(a.array[0].stringValue, a.array[0].nbEntries), "kept");
+    EXPECT_STRV(std::string_view(a.array[1].parameterName, a.array[1].parameterNameLength), "d");
+    EXPECT_EQ(a.array[1].nbEntries, 1);
+
+    // Arrays can't be traversed through key paths
+    const auto &f = root.array[1];
+    EXPECT_STRV(std::string_view(f.parameterName, f.parameterNameLength), "f");
+    EXPECT_EQ(f.type, DDWAF_OBJ_ARRAY);
+    EXPECT_EQ(f.nbEntries, 0);
+
+    const auto &g = root.array[2];
+    EXPECT_STRV(std::string_view(g.parameterName, g.parameterNameLength), "g");
+    ASSERT_EQ(g.nbEntries, 1);
+    EXPECT_EQ(g.array[0].nbEntries, 2);
+}
+
+TEST(TestJsonLoader, ParseWithLimits)
+{
+    std::string json = R"({"a": [1, 2, 3, 4], "b": {"c": {"d": "e"}}, "f": 5})";
+
+    json::parse_options options;
+    options.max_depth = 2;
+    options.max_container_size = 2;
+
+    auto tree = json::parse_insitu(json.data(), json.size(), options);
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 2);
+    EXPECT_EQ(root.array[0].nbEntries, 2);
+
+    // Containers beyond the maximum depth are kept without their children
+    const auto &b = root.array[1];
+    ASSERT_EQ(b.nbEntries, 1);
+    EXPECT_EQ(b.array[0].type, DDWAF_OBJ_MAP);
+    EXPECT_EQ(b.array[0].nbEntries, 0);
+}
+
+TEST(TestJsonLoader, ParseForm)
+{
+    std::string form = "a=1&b=hello+world&&c=%3Cscript%3E&d&a=%zz&=e";
+
+    auto tree = json::parse_form_insitu(form.data(), form.size());
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(root.nbEntries, 6);
+
+    std::vector<std::pair<std::string_view, std::string_view>> expected{{"a", "1"},
+        {"b", "hello world"}, {"c", "<script>"}, {"d", ""}, {"a", "%zz"}, {"", "e"}};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        const auto &entry = root.array[i];
+        EXPECT_EQ(entry.type, DDWAF_OBJ_STRING);
+        EXPECT_EQ(std::string_view(entry.parameterName, entry.parameterNameLength),
+            expected[i].first);
+        EXPECT_EQ(std::string_view(entry.stringValue, entry.nbEntries), expected[i].second);
+        EXPECT_EQ(entry.stringValue[entry.nbEntries], '\0');
+    }
+}
+
+TEST(TestJsonLoader, ParseFormWithKeyPaths)
+{
+    std::string form = "a=1&b=2&c=3";
+
+    std::set<std::vector<std::string>> paths{{"b"}, {"c", "d"}};
+    json::parse_options options;
+    options.key_paths = &paths;
+
+    auto tree = json::parse_form_insitu(form.data(), form.size(), options);
+    const auto &root = tree.root();
+
+    ASSERT_EQ(root.nbEntries, 1);
+    EXPECT_EQ(std::string_view(root.array[0].stringValue, root.array[0].nbEntries), "2");
+}
+
+TEST(TestJsonLoader, InitFromJsonFile)
+{
+    ddwaf_ruleset_info info;
+    ddwaf_handle handle = ddwaf_init_from_file("json/interface.json", nullptr, &info);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ(info.loaded, 3);
+    EXPECT_EQ(info.failed, 0);
+    ddwaf_ruleset_info_free(&info);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "value2", ddwaf_object_string(&tmp, "rule3"));
+
+    EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestJsonLoader, InitFromSnapshotFile)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    std::vector<char> buffer(ddwaf_ruleset_serialize(&rule, nullptr, 0));
+    ASSERT_EQ(ddwaf_ruleset_serialize(&rule, buffer.data(), buffer.size()), buffer.size());
+    ddwaf_object_free(&rule);
+
+    std::string path = "snapshot_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+    ddwaf_handle handle = ddwaf_init_from_file(path.c_str(), nullptr, nullptr);
+    std::remove(path.c_str());
+    ASSERT_NE(handle, nullptr);
+
+    uint32_t size;
+    ddwaf_required_addresses(handle, &size);
+    EXPECT_EQ(size, 2);
+
+    ddwaf_destroy(handle);
+}
+
+TEST(TestJsonLoader, InitFromInvalidFile)
+{
+    EXPECT_EQ(ddwaf_init_from_file(nullptr, nullptr, nullptr), nullptr);
+    EXPECT_EQ(ddwaf_init_from_file("json/does_not_exist.json", nullptr, nullptr), nullptr);
+    EXPECT_EQ(ddwaf_init_from_file("json/bad.json", nullptr, nullptr), nullptr);
+}
@@ -0,0 +1,134 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <key_paths.hpp>
+
+using namespace ddwaf;
+
+namespace {
+rule::ptr make_rule(ddwaf::manifest &manifest, const std::string &id,
+    const std::vector<std::pair<std::string, std::vector<std::string>>> &inputs,
+    bool enabled = true)
+{
+    std::vector<ddwaf::condition::target_type> targets;
+    for (const auto &[address, key_path] : inputs) {
+        targets.push_back({manifest.insert(address), address, key_path});
+    }
+
+    auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::ip_match>(std::vector<std::string_view>{"192.168.0.1"}));
+
+    std::vector<std::shared_ptr<condition>> conditions{std::move(cond)};
+    std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "category"}};
+
+    return std::make_shared<ddwaf::rule>(id, "name", std::move(tags), std::move(conditions),
+        std::vector<std::string>{}, enabled);
+}
+} // namespace
+
+TEST(TestKeyPaths, CollectFromRules)
+{
+    ddwaf::manifest manifest;
+    ddwaf::ruleset rs;
+    rs.insert_rule(make_rule(manifest, "1",
+        {{"server.request.headers", {"user-agent"}}, {"server.request.query", {}}}));
+    rs.insert_rule(make_rule(manifest, "2",
+        {{"server.request.headers", {"referer"}}, {"server.request.query", {"q"}}}));
+    rs.insert_rule(make_rule(manifest, "3", {{"server.request.body", {"a", "b"}}}));
+    rs.insert_rule(make_rule(manifest, "4", {{"server.request.body", {"a"}}}));
+    rs.insert_rule(make_rule(manifest, "5", {{"server.request.body", {"ab"}}}));
+    rs.insert_rule(make_rule(manifest, "6", {{"server.request.cookies", {}}}, false));
+
+    auto interest = collect_key_paths(rs);
+    EXPECT_EQ(interest.size(), 3);
+
+    {
+        const auto &entry = interest["server.request.headers"];
+        EXPECT_FALSE(entry.full);
+        std::set<std::vector<std::string>> expected{{"referer"}, {"user-agent"}};
+        EXPECT_EQ(entry.paths, expected);
+    }
+
+    {
+        const auto &entry = interest["server.request.query"];
+        EXPECT_TRUE(entry.full);
+        EXPECT_TRUE(entry.paths.empty());
+    }
+
+    {
+        // [a, b] is already covered by [a]
+        const auto &entry = interest["server.request.body"];
+        EXPECT_FALSE(entry.full);
+        std::set<std::vector<std::string>> expected{{"a"}, {"ab"}};
+        EXPECT_EQ(entry.paths, expected);
+    }
+
+    EXPECT_EQ(interest.find("server.request.cookies"), interest.end());
+}
+
+TEST(TestKeyPaths, CollectFromFilters)
+{
+    ddwaf::manifest manifest;
+    ddwaf::ruleset rs;
+    auto rule = make_rule(manifest, "1", {{"server.request.headers", {"user-agent"}}});
+    rs.insert_rule(rule);
+
+    std::vector<ddwaf::condition::target_type> targets;
+    targets.push_back({manifest.insert("usr.id"), "usr.id", {}});
+    auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::exact_match>(std::vector<std::string>{"admin"}));
+
+    rs.rule_filters.emplace("filter", std::make_shared<exclusion::rule_filter>("filter",
+                                          std::vector<condition::ptr>{std::move(cond)},
+                                          std::set<ddwaf::rule *>{rule.get()}));
+
+    auto interest = collect_key_paths(rs);
+    EXPECT_EQ(interest.size(), 2);
+    EXPECT_TRUE(interest["usr.id"].full);
+    EXPECT_FALSE(interest["server.request.headers"].full);
+}
+
+TEST(TestKeyPaths, ToObject)
+{
+    key_path_map interest;
+    interest["server.request.query"].full = true;
+    interest["server.request.headers"].paths.insert({"user-agent"});
+    interest["server.request.headers"].paths.insert({"x-forwarded-for", "0"});
+
+    ddwaf_object output;
+    key_paths_to_object(interest, output);
+
+    ASSERT_EQ(output.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(ddwaf_object_size(&output), 2);
+
+    // Addresses are ordered
+    auto *headers = ddwaf_object_get_index(&output, 0);
+    EXPECT_STREQ(headers->parameterName, "server.request.headers");
+    ASSERT_EQ(ddwaf_object_size(headers), 2);
+
+    auto *full = ddwaf_object_get_index(headers, 0);
+    EXPECT_STREQ(full->parameterName, "full");
+    EXPECT_FALSE(ddwaf_object_get_bool(full));
+
+    auto *paths = ddwaf_object_get_index(headers, 1);
+    EXPECT_STREQ(paths->parameterName, "key_paths");
+    ASSERT_EQ(ddwaf_object_size(paths), 2);
+
+    auto *path = ddwaf_object_get_index(paths, 1);
+    ASSERT_EQ(ddwaf_object_size(path), 2);
+    EXPECT_STREQ(ddwaf_object_get_string(ddwaf_object_get_index(path, 0), nullptr),
+        "x-forwarded-for");
+    EXPECT_STREQ(ddwaf_object_get_string(ddwaf_object_get_index(path, 1), nullptr), "0");
+
+    auto *query = ddwaf_object_get_index(&output, 1);
+    EXPECT_STREQ(query->parameterName, "server.request.query");
+    EXPECT_TRUE(ddwaf_object_get_bool(ddwaf_object_get_index(query, 0)));
+    EXPECT_EQ(ddwaf_object_size(ddwaf_object_get_index(query, 1)), 0);
+
+    ddwaf_object_free(&output);
+}
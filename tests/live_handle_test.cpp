@@ -0,0 +1,111 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+namespace {
+
+DDWAF_RET_CODE run(ddwaf_context context, const char *address, const char *value)
+{
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, address, ddwaf_object_string(&tmp, value));
+    return ddwaf_run(context, &root, nullptr, LONG_TIME);
+}
+
+} // namespace
+
+TEST(TestLiveHandle, InitAndDestroy)
+{
+    EXPECT_EQ(ddwaf_live_init(nullptr, nullptr, nullptr), nullptr);
+
+    auto rule = readRule("{}");
+    EXPECT_EQ(ddwaf_live_init(&rule, nullptr, nullptr), nullptr);
+    ddwaf_object_free(&rule);
+
+    rule = readFile("interface.yaml");
+    ddwaf_live_handle handle = ddwaf_live_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_live_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    // The context outlives the handle
+    ddwaf_live_destroy(handle);
+
+    EXPECT_EQ(run(context, "value1", "rule1"), DDWAF_MATCH);
+    ddwaf_context_destroy(context);
+
+    EXPECT_EQ(ddwaf_live_context_init(nullptr), nullptr);
+    ddwaf_live_destroy(nullptr);
+}
+
+TEST(TestLiveHandle, Update)
+{
+    auto rule = readFile("interface.yaml");
+    ddwaf_live_handle handle = ddwaf_live_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context old_context = ddwaf_live_context_init(handle);
+    ASSERT_NE(old_context, nullptr);
+
+    auto overrides = readRule(R"({rules_override: [{rules_target: [{rule_id: 1}], enabled: false}]})");
+    EXPECT_TRUE(ddwaf_live_update(handle, &overrides, nullptr));
+    ddwaf_object_free(&overrides);
+
+    EXPECT_FALSE(ddwaf_live_update(handle, nullptr, nullptr));
+    EXPECT_FALSE(ddwaf_live_update(nullptr, &overrides, nullptr));
+
+    ddwaf_context new_context = ddwaf_live_context_init(handle);
+    ASSERT_NE(new_context, nullptr);
+
+    EXPECT_EQ(run(old_context, "value1", "rule1"), DDWAF_MATCH);
+    EXPECT_EQ(run(new_context, "value1", "rule1"), DDWAF_OK);
+
+    ddwaf_context_destroy(old_context);
+    ddwaf_context_destroy(new_context);
+    ddwaf_live_destroy(handle);
+}
+
+TEST(TestLiveHandle, ConcurrentUpdates)
+{
+    auto rule = readFile("interface.yaml");
+    ddwaf_live_handle handle = ddwaf_live_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> failures{0};
+    std::vector<std::thread> readers;
+    for (unsigned i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                ddwaf_context context = ddwaf_live_context_init(handle);
+                if (context == nullptr || run(context, "value2", "rule3") != DDWAF_MATCH) {
+                    failures++;
+                }
+                ddwaf_context_destroy(context);
+            }
+        });
+    }
+
+    auto disable = readRule(R"({rules_override: [{rules_target: [{rule_id: 1}], enabled: false}]})");
+    auto enable = readRule(R"({rules_override: []})");
+    for (unsigned i = 0; i < 50; ++i) {
+        EXPECT_TRUE(ddwaf_live_update(handle, (i % 2) == 0 ? &disable : &enable, nullptr));
+    }
+    ddwaf_object_free(&disable);
+    ddwaf_object_free(&enable);
+
+    stop = true;
+    for (auto &reader : readers) { reader.join(); }
+
+    EXPECT_EQ(failures, 0);
+    ddwaf_live_destroy(handle);
+}
@@ -0,0 +1,202 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <array>
+#include <log_ring.hpp>
+#include <thread>
+
+using namespace ddwaf;
+
+namespace {
+
+struct log_record {
+    DDWAF_LOG_LEVEL level;
+    std::string function;
+    std::string file;
+    unsigned line;
+    std::string message;
+};
+
+std::vector<log_record> records;
+
+void collect(DDWAF_LOG_LEVEL level, const char *function, const char *file, unsigned line,
+    const char *message, uint64_t length)
+{
+    EXPECT_EQ(strlen(message), length);
+    records.push_back({level, function, file, line, std::string{message, length}});
+}
+
+void discard(DDWAF_LOG_LEVEL /*level*/, const char * /*function*/, const char * /*file*/,
+    unsigned /*line*/, const char * /*message*/, uint64_t /*length*/)
+{}
+
+} // namespace
+
+TEST(TestLogRing, FormatOnDrain)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    char buffer[] = "buffer";
+    const char *null_str = nullptr;
+    std::string str{"string"};
+
+    log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 42, "no arguments %%");
+    log_ring::push(DDWAF_LOG_DEBUG, "function", "file.cpp", 43, "%d %u %s %" PRIu64 " %.2f", -1,
+        2U, "abc", uint64_t{1} << 40, 0.5);
+    log_ring::push(DDWAF_LOG_WARN, "function", "file.cpp", 44, "%s %s %s", buffer, null_str,
+        str.c_str());
+
+    // Arguments are copied on push
+    buffer[0] = 'X';
+    str = "modified";
+
+    EXPECT_EQ(log_ring::drain(collect), 3);
+    ASSERT_EQ(records.size(), 3);
+
+    EXPECT_EQ(records[0].level, DDWAF_LOG_INFO);
+    EXPECT_EQ(records[0].function, "function");
+    EXPECT_EQ(records[0].file, "file.cpp");
+    EXPECT_EQ(records[0].line, 42);
+    EXPECT_EQ(records[0].message, "no arguments %");
+
+    EXPECT_EQ(records[1].level, DDWAF_LOG_DEBUG);
+    EXPECT_EQ(records[1].message, "-1 2 abc 1099511627776 0.50");
+
+    EXPECT_EQ(records[2].level, DDWAF_LOG_WARN);
+    EXPECT_EQ(records[2].message, "buffer (null) string");
+
+    EXPECT_EQ(log_ring::drain(collect), 0);
+}
+
+TEST(TestLogRing, TruncateLongStrings)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    std::string long_str(1024, 'a');
+    log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%s %d", long_str.c_str(), 5);
+
+    EXPECT_EQ(log_ring::drain(collect), 1);
+    ASSERT_EQ(records.size(), 1);
+
+    // The trailing arguments are preserved
+    const auto &message = records[0].message;
+    EXPECT_LT(message.size(), log_ring::payload_size);
+    EXPECT_EQ(message.substr(message.size() - 2), " 5");
+    EXPECT_EQ(message.find_first_not_of('a'), message.size() - 2);
+}
+
+TEST(TestLogRing, StringPrecision)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    // The string isn't null-terminated within its precision, nor is the
+    // buffer following it
+    std::array<char, 4> unterminated{'a', 'b', 'c', 'd'};
+    log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%.*s %*d %.*s|%%.*s %s", 3,
+        unterminated.data(), 4, 5, -1, "all", "plain");
+
+    EXPECT_EQ(log_ring::drain(collect), 1);
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_EQ(records[0].message, "abc    5 all|%.*s plain");
+}
+
+TEST(TestLogRing, LongMessage)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%01000d", 7);
+
+    EXPECT_EQ(log_ring::drain(collect), 1);
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_EQ(records[0].message, std::string(999, '0') + "7");
+}
+
+TEST(TestLogRing, DropWhenFull)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    for (unsigned i = 0; i < log_ring::capacity + 10; ++i) {
+        log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%u", i);
+    }
+
+    EXPECT_EQ(log_ring::drain(collect), log_ring::capacity);
+    ASSERT_EQ(records.size(), log_ring::capacity + 1);
+    for (unsigned i = 0; i < log_ring::capacity; ++i) {
+        EXPECT_EQ(records[i].message, std::to_string(i));
+    }
+    EXPECT_EQ(records.back().level, DDWAF_LOG_WARN);
+    EXPECT_EQ(records.back().message, "10 log records dropped, the log buffer was full");
+
+    // The ring is usable once drained
+    records.clear();
+    log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%s", "again");
+    EXPECT_EQ(log_ring::drain(collect), 1);
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_EQ(records[0].message, "again");
+}
+
+TEST(TestLogRing, DrainLimit)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    for (unsigned i = 0; i < 10; ++i) {
+        log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%u", i);
+    }
+
+    EXPECT_EQ(log_ring::drain(collect, 4), 4);
+    EXPECT_EQ(log_ring::drain(collect, 4), 4);
+    EXPECT_EQ(log_ring::drain(collect), 2);
+
+    ASSERT_EQ(records.size(), 10);
+    for (unsigned i = 0; i < 10; ++i) { EXPECT_EQ(records[i].message, std::to_string(i)); }
+}
+
+TEST(TestLogRing, MultipleThreads)
+{
+    log_ring::drain(discard);
+    records.clear();
+
+    constexpr unsigned thread_count = 4;
+    constexpr unsigned per_thread = 100;
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (unsigned t = 0; t < thread_count; ++t) {
+        threads.emplace_back([t]() {
+            for (unsigned i = 0; i < per_thread; ++i) {
+                log_ring::push(DDWAF_LOG_INFO, "function", "file.cpp", 1, "%u %u", t, i);
+            }
+        });
+    }
+
+    // Drain concurrently with the producers
+    std::size_t relayed = 0;
+    for (unsigned i = 0; i < 10; ++i) { relayed += log_ring::drain(collect); }
+
+    for (auto &thread : threads) { thread.join(); }
+    relayed += log_ring::drain(collect);
+
+    EXPECT_EQ(relayed, thread_count * per_thread);
+    ASSERT_EQ(records.size(), thread_count * per_thread);
+
+    // Records of each thread are relayed in order
+    std::vector<unsigned> next(thread_count, 0);
+    for (const auto &record : records) {
+        unsigned t;
+        unsigned i;
+        ASSERT_EQ(sscanf(record.message.c_str(), "%u %u", &t, &i), 2);
+        ASSERT_LT(t, thread_count);
+        EXPECT_EQ(i, next[t]++);
+    }
+}
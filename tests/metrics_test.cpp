@@ -0,0 +1,192 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+#include <metrics.hpp>
+
+using namespace ddwaf;
+
+namespace {
+rule::ptr make_rule(ddwaf::manifest &manifest, const std::string &id,
+    std::vector<PW_TRANSFORM_ID> transformers = {})
+{
+    std::vector<ddwaf::condition::target_type> targets;
+    targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+    auto ip_cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::ip_match>(std::vector<std::string_view>{"192.168.0.1"}));
+
+    targets.clear();
+    targets.push_back({manifest.insert("usr.id"), "usr.id", {}});
+    auto regex_cond = std::make_shared<condition>(std::move(targets), std::move(transformers),
+        std::make_unique<rule_processor::regex_match>("admin", 0, true));
+
+    std::vector<std::shared_ptr<condition>> conditions{std::move(ip_cond), std::move(regex_cond)};
+    std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "category"}};
+
+    return std::make_shared<ddwaf::rule>(
+        id, "name", std::move(tags), std::move(conditions), std::vector<std::string>{});
+}
+
+const ddwaf_object *find(const ddwaf_object &map, std::string_view key)
+{
+    for (std::size_t i = 0; i < map.nbEntries; ++i) {
+        const auto &entry = map.array[i];
+        if (std::string_view{entry.parameterName, entry.parameterNameLength} == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t counter(const ddwaf_object &map, std::string_view key)
+{
+    const auto *value = find(map, key);
+    return value != nullptr ? value->uintValue : 0;
+}
+} // namespace
+
+TEST(TestMetrics, RecordAndMerge)
+{
+    ddwaf::manifest manifest;
+    ddwaf::ruleset rs;
+    rs.insert_rule(make_rule(manifest, "1"));
+
+    metrics m(rs.rules);
+    const auto &rule = rs.rules.begin()->second;
+    EXPECT_EQ(m.index(rule.get()), 0);
+    EXPECT_EQ(m.index(rule->conditions[0].get()), 1);
+    EXPECT_EQ(m.index(rule->conditions[1].get()), 2);
+    EXPECT_EQ(m.index(&rs), metrics::npos);
+
+    {
+        metrics::recorder recorder{m};
+        recorder.record(rule.get(), 100, {2, 10});
+        recorder.record(rule->conditions[1].get(), 40, {1, 10});
+    }
+
+    std::thread([&]() {
+        metrics::recorder recorder{m};
+        recorder.record(rule.get(), 300, {1, 0});
+        recorder.record(&rs, 300);
+    }).join();
+
+    ddwaf_object output;
+    m.to_object(rs, output);
+
+    const auto *rules = find(output, "rules");
+    ASSERT_NE(rules, nullptr);
+    const auto *rule_object = find(*rules, "1");
+    ASSERT_NE(rule_object, nullptr);
+    EXPECT_EQ(counter(*rule_object, "calls"), 2);
+    EXPECT_EQ(counter(*rule_object, "total_ns"), 400);
+    EXPECT_EQ(counter(*rule_object, "max_ns"), 300);
+    EXPECT_EQ(counter(*rule_object, "strings"), 3);
+    EXPECT_EQ(counter(*rule_object, "bytes"), 10);
+
+    const auto *conditions = find(*rule_object, "conditions");
+    ASSERT_NE(conditions, nullptr);
+    ASSERT_EQ(conditions->nbEntries, 2);
+    EXPECT_EQ(counter(conditions->array[0], "calls"), 0);
+    EXPECT_EQ(counter(conditions->array[1], "calls"), 1);
+    EXPECT_EQ(counter(conditions->array[1], "total_ns"), 40);
+
+    const auto *processor = find(conditions->array[1], "processor");
+    ASSERT_NE(processor, nullptr);
+    EXPECT_STREQ(processor->stringValue, "match_regex");
+
+    const auto *processors = find(output, "processors");
+    ASSERT_NE(processors, nullptr);
+    ASSERT_EQ(processors->nbEntries, 2);
+    EXPECT_EQ(counter(*find(*processors, "match_regex"), "bytes"), 10);
+    EXPECT_EQ(counter(*find(*processors, "ip_match"), "calls"), 0);
+
+    ddwaf_object_free(&output);
+}
+
+TEST(TestMetrics, AlternateInstances)
+{
+    ddwaf::manifest manifest;
+    ddwaf::ruleset rs;
+    rs.insert_rule(make_rule(manifest, "1"));
+    const auto *rule = rs.rules.begin()->second.get();
+
+    // More instances than shards cached per thread
+    std::vector<std::unique_ptr<metrics>> instances;
+    for (unsigned i = 0; i < 6; ++i) {
+        instances.emplace_back(std::make_unique<metrics>(rs.rules));
+    }
+
+    for (unsigned round = 0; round < 3; ++round) {
+        for (std::size_t i = 0; i < instances.size(); ++i) {
+            metrics::recorder recorder{*instances[i]};
+            recorder.record(rule, i + 1);
+        }
+    }
+
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+        ddwaf_object output;
+        instances[i]->to_object(rs, output);
+
+        const auto *rules = find(output, "rules");
+        ASSERT_NE(rules, nullptr);
+        const auto *rule_object = find(*rules, "1");
+        ASSERT_NE(rule_object, nullptr);
+        EXPECT_EQ(counter(*rule_object, "calls"), 3);
+        EXPECT_EQ(counter(*rule_object, "total_ns"), 3 * (i + 1));
+
+        ddwaf_object_free(&output);
+    }
+}
+
+TEST(TestMetrics, ProfiledCollectionMatch)
+{
+    ddwaf::manifest manifest;
+    ddwaf::ruleset rs;
+    rs.insert_rule(make_rule(manifest, "1", {PWT_LOWERCASE}));
+
+    metrics m(rs.rules);
+    const auto &rule = rs.rules.begin()->second;
+
+    ddwaf::collection rule_collection;
+    rule_collection.insert(rule);
+
+    auto cache = rule_collection.get_cache();
+    ddwaf::object_store store(manifest);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+    ddwaf_object_map_add(&root, "usr.id", ddwaf_object_string(&tmp, "Admin"));
+    store.insert(root);
+
+    std::unordered_set<std::string_view> seen_actions;
+    std::vector<event> events;
+    ddwaf::timer deadline{2s};
+    rule_collection.match(events, seen_actions, store, cache, {}, {}, {}, deadline, &m);
+    EXPECT_EQ(events.size(), 1);
+
+    ddwaf_object output;
+    m.to_object(rs, output);
+
+    const auto *rule_object = find(*find(output, "rules"), "1");
+    ASSERT_NE(rule_object, nullptr);
+    EXPECT_EQ(counter(*rule_object, "calls"), 1);
+    EXPECT_EQ(counter(*rule_object, "strings"), 2);
+    EXPECT_EQ(counter(*rule_object, "bytes"), 5);
+
+    const auto *conditions = find(*rule_object, "conditions");
+    ASSERT_EQ(conditions->nbEntries, 2);
+    EXPECT_EQ(counter(conditions->array[0], "calls"), 1);
+    EXPECT_EQ(counter(conditions->array[0], "strings"), 1);
+    EXPECT_EQ(counter(conditions->array[0], "bytes"), 0);
+    EXPECT_EQ(counter(conditions->array[1], "calls"), 1);
+    EXPECT_EQ(counter(conditions->array[1], "strings"), 1);
+    EXPECT_EQ(counter(conditions->array[1], "bytes"), 5);
+
+    ddwaf_object_free(&output);
+}
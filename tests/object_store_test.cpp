@@ -223,3 +223,107 @@ TEST(TestObjectStore, InsertMultipleOverlappingObjects)
         EXPECT_STREQ(object->stringValue, "bye");
     }
 }
+
+TEST(TestObjectStore, InsertProvider)
+{
+    ddwaf::manifest manifest;
+    auto query = manifest.insert("query");
+    auto url = manifest.insert("url");
+
+    object_store store(manifest);
+
+    unsigned calls = 0;
+    EXPECT_TRUE(store.insert_provider("query", [&calls](ddwaf_object &object) {
+        ++calls;
+        ddwaf_object_string(&object, "hello");
+        return true;
+    }));
+    EXPECT_EQ(calls, 0);
+
+    // The provider is considered new data on the next insertion
+    ddwaf_object root;
+    ddwaf_object_map(&root);
+    store.insert(root);
+
+    EXPECT_TRUE(store.is_new_target(query));
+    EXPECT_FALSE(store.is_new_target(url));
+    EXPECT_EQ(calls, 0);
+
+    const auto *object = store.get_target(query);
+    ASSERT_NE(object, nullptr);
+    EXPECT_EQ(object->type, DDWAF_OBJ_STRING);
+    EXPECT_STREQ(object->stringValue, "hello");
+
+    // The value is cached after the first invocation
+    EXPECT_EQ(store.get_target(query), object);
+    EXPECT_EQ(calls, 1);
+
+    ddwaf_object_map(&root);
+    store.insert(root);
+    EXPECT_FALSE(store.is_new_target(query));
+    EXPECT_EQ(store.get_target(query), object);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TestObjectStore, InsertProviderUnknownAddress)
+{
+    ddwaf::manifest manifest;
+    manifest.insert("query");
+
+    object_store store(manifest);
+
+    bool called = false;
+    EXPECT_FALSE(store.insert_provider("url", [&called](ddwaf_object &) {
+        called = true;
+        return false;
+    }));
+
+    ddwaf_object root;
+    ddwaf_object_map(&root);
+    store.insert(root);
+
+    EXPECT_FALSE(store.has_new_targets());
+    EXPECT_FALSE(called);
+}
+
+TEST(TestObjectStore, InsertProviderFailure)
+{
+    ddwaf::manifest manifest;
+    auto query = manifest.insert("query");
+
+    object_store store(manifest);
+
+    unsigned calls = 0;
+    EXPECT_TRUE(store.insert_provider("query", [&calls](ddwaf_object &) {
+        ++calls;
+        return false;
+    }));
+
+    EXPECT_EQ(store.get_target(query), nullptr);
+    EXPECT_EQ(store.get_target(query), nullptr);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TestObjectStore, InsertProviderReplacedByObject)
+{
+    ddwaf::manifest manifest;
+    auto query = manifest.insert("query");
+
+    object_store store(manifest);
+
+    EXPECT_TRUE(store.insert_provider("query", [](ddwaf_object &object) {
+        ddwaf_object_string(&object, "provided");
+        return true;
+    }));
+    ASSERT_NE(store.get_target(query), nullptr);
+    EXPECT_STREQ(store.get_target(query)->stringValue, "provided");
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "query", ddwaf_object_string(&tmp, "inserted"));
+    store.insert(root);
+
+    ASSERT_NE(store.get_target(query), nullptr);
+    EXPECT_STREQ(store.get_target(query)->stringValue, "inserted");
+}
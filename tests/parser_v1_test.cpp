@@ -228,3 +228,32 @@ TEST(TestParserV1, TestInvalidDuplicate)
 
     ddwaf_destroy(handle);
 }
+
+TEST(TestParserV1, SpecificationOrder)
+{
+    // Both rules match, the first one defined must be the one reported even
+    // though it's more expensive to evaluate
+    auto rule = readRule(
+        R"({version: '1.1', events: [{id: 2, name: rule2, tags: {type: flow1, category: category1}, conditions: [{operation: match_regex, parameters: {inputs: [arg1, arg2], regex: .*}}, {operation: match_regex, parameters: {inputs: [arg1], regex: '^string'}}]}, {id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operation: match_regex, parameters: {inputs: [arg1], regex: .*}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param, tmp;
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "arg1", ddwaf_object_string(&tmp, "string 1"));
+
+    ddwaf_result ret;
+    EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_MATCH);
+    EXPECT_STREQ(ret.data,
+        R"([{"rule":{"id":"2","name":"rule2","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"match_regex","operator_value":".*","parameters":[{"address":"arg1","key_path":[],"value":"string 1","highlight":["string 1"]}]},{"operator":"match_regex","operator_value":"^string","parameters":[{"address":"arg1","key_path":[],"value":"string 1","highlight":["string"]}]}]}])");
+    ddwaf_result_free(&ret);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
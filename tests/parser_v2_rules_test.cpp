@@ -186,3 +186,36 @@ TEST(TestParserV2Rules, ParseMultipleRulesOneDuplicate)
         EXPECT_STR(rule.tags["category"], "category1");
     }
 }
+
+TEST(TestParserV2Rules, ParseMultipleRulesInParallel)
+{
+    ddwaf::object_limits limits;
+    ruleset_info info;
+    ddwaf::manifest manifest;
+    std::unordered_map<std::string, std::string> rule_data_ids;
+    thread_pool pool(3);
+
+    auto rule_object = readRule(
+        R"([{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: .*}}, {operator: phrase_match, parameters: {inputs: [{address: arg2}], list: [abc, def]}}]}, {id: 2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: "["}}]}, {id: 3, name: rule3, tags: {type: flow3, category: category3}, conditions: [{operator: is_xss, parameters: {inputs: [{address: arg3}]}}]}, {id: 4, name: rule4, tags: {type: flow4, category: category4}, conditions: [{operator: ip_match, parameters: {inputs: [{address: http.client_ip}], data: blocked_ips}}]}])");
+
+    auto rule_array = static_cast<parameter::vector>(parameter(rule_object));
+    EXPECT_EQ(rule_array.size(), 4);
+
+    auto rules =
+        parser::v2::parse_rules(rule_array, info, manifest, rule_data_ids, limits, &pool);
+    ddwaf_object_free(&rule_object);
+
+    // The rule with an invalid regex is reported as an error
+    EXPECT_EQ(rules.size(), 3);
+    EXPECT_NE(rules.find("1"), rules.end());
+    EXPECT_EQ(rules.find("2"), rules.end());
+    EXPECT_NE(rules.find("3"), rules.end());
+    EXPECT_NE(rules.find("4"), rules.end());
+
+    EXPECT_EQ(rules["1"].conditions.size(), 2);
+    EXPECT_EQ(rules["3"].conditions.size(), 1);
+    EXPECT_EQ(rules["4"].conditions.size(), 1);
+
+    EXPECT_EQ(rule_data_ids.size(), 1);
+    EXPECT_STR(rule_data_ids["blocked_ips"], "ip_match");
+}
@@ -0,0 +1,117 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+namespace {
+
+std::string make_key(std::string_view operation, const std::string &params_yaml)
+{
+    auto object = readRule(params_yaml.c_str());
+    auto params = static_cast<parameter::map>(parameter(object));
+    auto key = parser::processor_cache::make_key(operation, params);
+    ddwaf_object_free(&object);
+    return key;
+}
+
+} // namespace
+
+TEST(TestProcessorCache, RegexKey)
+{
+    auto key = make_key("match_regex", R"({regex: .*, options: {case_sensitive: true}})");
+    EXPECT_FALSE(key.empty());
+
+    EXPECT_EQ(key, make_key("match_regex", R"({regex: .*, options: {case_sensitive: true}})"));
+    EXPECT_NE(key, make_key("match_regex", R"({regex: .*})"));
+    EXPECT_NE(key, make_key("match_regex",
+                       R"({regex: .*, options: {case_sensitive: true, min_length: 2}})"));
+    EXPECT_NE(key, make_key("match_regex", R"({regex: .+, options: {case_sensitive: true}})"));
+}
+
+TEST(TestProcessorCache, ListKey)
+{
+    auto key = make_key("phrase_match", R"({list: [ab, c]})");
+    EXPECT_FALSE(key.empty());
+
+    EXPECT_EQ(key, make_key("phrase_match", R"({list: [ab, c]})"));
+    EXPECT_NE(key, make_key("phrase_match", R"({list: [a, bc]})"));
+    EXPECT_NE(key, make_key("exact_match", R"({list: [ab, c]})"));
+}
+
+TEST(TestProcessorCache, NonCacheableKey)
+{
+    EXPECT_TRUE(make_key("ip_match", R"({data: blocked_ips})").empty());
+    EXPECT_TRUE(make_key("exact_match", R"({data: blocked_users})").empty());
+    EXPECT_TRUE(make_key("phrase_match", R"({list: [a, {b: c}]})").empty());
+    EXPECT_TRUE(make_key("match_regex", R"({options: {case_sensitive: true}})").empty());
+    EXPECT_TRUE(make_key("unknown", R"({})").empty());
+    EXPECT_FALSE(make_key("is_xss", R"({})").empty());
+}
+
+TEST(TestProcessorCache, InsertAndCleanup)
+{
+    parser::processor_cache cache;
+
+    auto processor = std::make_shared<rule_processor::is_xss>();
+    EXPECT_EQ(cache.insert("key", processor), processor);
+    EXPECT_EQ(cache.find("key"), processor);
+
+    // Insertion of a different processor under the same key returns the original
+    EXPECT_EQ(cache.insert("key", std::make_shared<rule_processor::is_xss>()), processor);
+
+    cache.cleanup();
+    EXPECT_EQ(cache.size(), 1);
+
+    processor.reset();
+    EXPECT_FALSE(cache.find("key"));
+
+    cache.cleanup();
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(TestProcessorCache, SharedAcrossRules)
+{
+    ddwaf::object_limits limits;
+    ruleset_info info;
+    ddwaf::manifest manifest;
+    std::unordered_map<std::string, std::string> rule_data_ids;
+    parser::processor_cache cache;
+
+    auto rule_object = readRule(
+        R"([{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: .*}}]}, {id: 2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg2}], regex: .*}}, {operator: match_regex, parameters: {inputs: [{address: arg2}], regex: .*, options: {case_sensitive: true}}}]}])");
+
+    auto rule_array = static_cast<parameter::vector>(parameter(rule_object));
+    auto rules = parser::v2::parse_rules(
+        rule_array, info, manifest, rule_data_ids, limits, nullptr, &cache);
+
+    EXPECT_EQ(rules.size(), 2);
+    EXPECT_EQ(cache.size(), 2);
+
+    ddwaf_object_free(&rule_object);
+
+    // Both rules and the local reference
+    auto processor = cache.find(make_key("match_regex", R"({regex: .*})"));
+    ASSERT_TRUE(processor);
+    EXPECT_EQ(processor.use_count(), 3);
+
+    // A subsequent parse reuses the same processors
+    rule_object = readRule(
+        R"([{id: 3, name: rule3, tags: {type: flow3, category: category3}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg3}], regex: .*}}]}])");
+    rule_array = static_cast<parameter::vector>(parameter(rule_object));
+    auto new_rules = parser::v2::parse_rules(
+        rule_array, info, manifest, rule_data_ids, limits, nullptr, &cache);
+    ddwaf_object_free(&rule_object);
+
+    EXPECT_EQ(new_rules.size(), 1);
+    EXPECT_EQ(processor.use_count(), 4);
+
+    rules.clear();
+    new_rules.clear();
+    processor.reset();
+
+    cache.cleanup();
+    EXPECT_EQ(cache.size(), 0);
+}
@@ -385,3 +385,117 @@ TEST(TestRule, ExcludeObject)
     auto event = rule.match(store, cache, {&root.array[0]}, {}, deadline);
     EXPECT_FALSE(event.has_value());
 }
+
+TEST(TestRule, ReorderedConditionsMatchInSpecOrder)
+{
+    ddwaf::manifest manifest;
+    std::vector<std::shared_ptr<condition>> conditions;
+    {
+        std::vector<condition::target_type> targets;
+        targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+        conditions.emplace_back(std::make_shared<condition>(std::move(targets),
+            std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::ip_match>(
+                std::vector<std::string_view>{"192.168.0.1"})));
+    }
+
+    {
+        std::vector<condition::target_type> targets;
+        targets.push_back({manifest.insert("usr.id"), "usr.id", {}});
+
+        conditions.emplace_back(std::make_shared<condition>(std::move(targets),
+            std::vector<PW_TRANSFORM_ID>{},
+            std::make_unique<rule_processor::exact_match>(std::vector<std::string>{"admin"})));
+    }
+
+    std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "category"}};
+    ddwaf::rule rule("id", "name", std::move(tags), std::move(conditions));
+    rule.evaluation_order = {1, 0};
+
+    ddwaf::object_store store(manifest);
+    rule::cache_type cache;
+
+    // The second condition is evaluated first and matches on the first run
+    {
+        ddwaf_object root, tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "usr.id", ddwaf_object_string(&tmp, "admin"));
+        store.insert(root);
+
+        ddwaf::timer deadline{2s};
+        EXPECT_FALSE(rule.match(store, cache, {}, {}, deadline).has_value());
+    }
+
+    {
+        ddwaf_object root, tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+        store.insert(root);
+
+        ddwaf::timer deadline{2s};
+        auto event = rule.match(store, cache, {}, {}, deadline);
+        ASSERT_TRUE(event.has_value());
+        ASSERT_EQ(event->matches.size(), 2);
+        EXPECT_STREQ(event->matches[0].operator_name.data(), "ip_match");
+        EXPECT_STREQ(event->matches[1].operator_name.data(), "exact_match");
+    }
+}
+
+TEST(TestRule, SharedConditionVerdict)
+{
+    std::vector<condition::target_type> targets;
+
+    ddwaf::manifest manifest;
+    targets.push_back({manifest.insert("http.client_ip"), "http.client_ip", {}});
+
+    auto cond = std::make_shared<condition>(std::move(targets), std::vector<PW_TRANSFORM_ID>{},
+        std::make_unique<rule_processor::ip_match>(std::vector<std::string_view>{"192.168.0.1"}));
+
+    std::unordered_map<std::string, std::string> tags{{"type", "type"}, {"category", "category"}};
+    ddwaf::rule rule1("id1", "name", tags, {cond});
+    ddwaf::rule rule2("id2", "name", tags, {cond});
+
+    std::unordered_set<const condition *> shared{cond.get()};
+    verdict_cache verdicts(shared);
+
+    ddwaf::object_store store(manifest);
+    {
+        ddwaf_object root, tmp;
+        ddwaf_object_map(&root);
+        ddwaf_object_map_add(&root, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.1"));
+        store.insert(root);
+    }
+
+    ddwaf::timer deadline{2s};
+    rule::cache_type cache1;
+    cache1.verdicts = &verdicts;
+    auto event = rule1.match(store, cache1, {}, {}, deadline);
+    ASSERT_TRUE(event.has_value());
+
+    verdict_cache::verdict verdict;
+    ASSERT_TRUE(verdicts.find(cond.get(), false, verdict));
+    ASSERT_TRUE(verdict.has_value());
+    EXPECT_STREQ(verdict->resolved.c_str(), "192.168.0.1");
+
+    // The second rule reuses the verdict of the first one, so a modified
+    // verdict is reflected in its event
+    verdict->resolved = "192.168.0.2";
+    verdicts.clear();
+    verdicts.insert(cond.get(), false, verdict);
+
+    rule::cache_type cache2;
+    cache2.verdicts = &verdicts;
+    event = rule2.match(store, cache2, {}, {}, deadline);
+    ASSERT_TRUE(event.has_value());
+    ASSERT_EQ(event->matches.size(), 1);
+    EXPECT_STREQ(event->matches[0].resolved.c_str(), "192.168.0.2");
+
+    // Negative verdicts are reused as well
+    verdicts.clear();
+    verdicts.insert(cond.get(), false, std::nullopt);
+
+    rule::cache_type cache3;
+    cache3.verdicts = &verdicts;
+    EXPECT_FALSE(rule2.match(store, cache3, {}, {}, deadline).has_value());
+}
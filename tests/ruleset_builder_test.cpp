@@ -0,0 +1,126 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+namespace {
+
+constexpr std::string_view base_rules =
+    R"({version: '2.1', rules: [{id: id1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: .*}}]}, {id: id2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg2}], regex: .*}}]}]})";
+
+ddwaf::ruleset::ptr build(ruleset_builder &builder, std::string_view yaml)
+{
+    ruleset_info info;
+    auto object = readRule(yaml.data());
+    auto rs = builder.build(parameter(object), info);
+    ddwaf_object_free(&object);
+    return rs;
+}
+
+} // namespace
+
+TEST(TestRulesetBuilder, OverrideSharesUnchangedRules)
+{
+    ruleset_builder builder{{}, ddwaf_object_free, std::make_shared<ddwaf::obfuscator>()};
+
+    auto first = build(builder, base_rules);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->rules.size(), 2);
+
+    auto second =
+        build(builder, R"({rules_override: [{rules_target: [{rule_id: id1}], enabled: false}]})");
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->rules.size(), 2);
+
+    EXPECT_NE(first->rules["id1"], second->rules["id1"]);
+    EXPECT_EQ(first->rules["id2"], second->rules["id2"]);
+
+    // The previous ruleset must not be affected by the override
+    EXPECT_TRUE(first->rules["id1"]->is_enabled());
+    EXPECT_FALSE(second->rules["id1"]->is_enabled());
+
+    // Conditions are shared regardless
+    EXPECT_EQ(first->rules["id1"]->conditions, second->rules["id1"]->conditions);
+
+    auto third = build(builder, R"({rules_override: []})");
+    ASSERT_TRUE(third);
+    EXPECT_NE(second->rules["id1"], third->rules["id1"]);
+    EXPECT_TRUE(third->rules["id1"]->is_enabled());
+    EXPECT_EQ(first->rules["id2"], third->rules["id2"]);
+}
+
+TEST(TestRulesetBuilder, OverrideActionsSharesUnchangedRules)
+{
+    ruleset_builder builder{{}, ddwaf_object_free, std::make_shared<ddwaf::obfuscator>()};
+
+    auto first = build(builder, base_rules);
+    ASSERT_TRUE(first);
+
+    auto second = build(builder,
+        R"({rules_override: [{rules_target: [{tags: {type: flow2}}], on_match: [block]}]})");
+    ASSERT_TRUE(second);
+
+    EXPECT_EQ(first->rules["id1"], second->rules["id1"]);
+    EXPECT_NE(first->rules["id2"], second->rules["id2"]);
+    EXPECT_TRUE(first->rules["id2"]->actions.empty());
+    EXPECT_EQ(second->rules["id2"]->actions.size(), 1);
+}
+
+TEST(TestRulesetBuilder, ReparsedRulesSharedWhenUnchanged)
+{
+    ruleset_builder builder{{}, ddwaf_object_free, std::make_shared<ddwaf::obfuscator>()};
+
+    auto first = build(builder, base_rules);
+    ASSERT_TRUE(first);
+
+    auto second = build(builder, base_rules);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(first->rules["id1"], second->rules["id1"]);
+    EXPECT_EQ(first->rules["id2"], second->rules["id2"]);
+
+    auto third = build(builder,
+        R"({rules: [{id: id1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: .*}}]}, {id: id2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg3}], regex: .*}}]}]})");
+    ASSERT_TRUE(third);
+    EXPECT_EQ(first->rules["id1"], third->rules["id1"]);
+    EXPECT_NE(first->rules["id2"], third->rules["id2"]);
+
+    auto fourth = build(builder,
+        R"({rules: [{id: id1, name: renamed, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: .*}}]}]})");
+    ASSERT_TRUE(fourth);
+    EXPECT_EQ(fourth->rules.size(), 1);
+    EXPECT_NE(first->rules["id1"], fourth->rules["id1"]);
+    EXPECT_STR(fourth->rules["id1"]->name, "renamed");
+}
+
+TEST(TestRulesetBuilder, IdenticalConditionsShared)
+{
+    ruleset_builder builder{{}, ddwaf_object_free, std::make_shared<ddwaf::obfuscator>()};
+
+    constexpr std::string_view rules =
+        R"({version: '2.1', rules: [{id: id1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: admin}}]}, {id: id2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg1}], regex: admin}}, {operator: match_regex, parameters: {inputs: [{address: arg1}], regex: admin}}]}, {id: id3, name: rule3, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg2}], regex: admin}}]}]})";
+
+    auto first = build(builder, rules);
+    ASSERT_TRUE(first);
+
+    const auto &cond1 = first->rules["id1"]->conditions;
+    const auto &cond2 = first->rules["id2"]->conditions;
+    const auto &cond3 = first->rules["id3"]->conditions;
+    EXPECT_EQ(cond1[0], cond2[0]);
+    EXPECT_NE(cond1[0], cond3[0]);
+
+    // Duplicates within the same rule are kept
+    EXPECT_NE(cond2[0], cond2[1]);
+
+    EXPECT_EQ(first->shared_conditions.size(), 1);
+    EXPECT_EQ(first->shared_conditions.count(cond1[0].get()), 1);
+
+    // Reparsed conditions are replaced by the existing ones
+    auto second = build(builder, rules);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->rules["id1"]->conditions[0], cond1[0]);
+    EXPECT_EQ(second->rules["id2"]->conditions[0], cond1[0]);
+    EXPECT_EQ(second->shared_conditions, first->shared_conditions);
+}
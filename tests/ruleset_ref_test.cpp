@@ -0,0 +1,143 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <ruleset_ref.hpp>
+
+TEST(TestRulesetRef, SharedPointer)
+{
+    auto rs = std::make_shared<ruleset>();
+    std::weak_ptr<ruleset> weak = rs;
+
+    {
+        ruleset_ref ref{std::move(rs)};
+        EXPECT_FALSE(weak.expired());
+        EXPECT_EQ(ref.get(), weak.lock().get());
+    }
+
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(TestRulesetRef, RetireWithoutReferences)
+{
+    auto rs = std::make_shared<ruleset>();
+    std::weak_ptr<ruleset> weak = rs;
+
+    auto *owner = new ruleset_owner(std::move(rs));
+    EXPECT_FALSE(weak.expired());
+
+    owner->retire();
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(TestRulesetRef, RetireWithReferences)
+{
+    auto rs = std::make_shared<ruleset>();
+    std::weak_ptr<ruleset> weak = rs;
+
+    auto *owner = new ruleset_owner(std::move(rs));
+    std::optional<ruleset_ref> first{owner->acquire()};
+    std::optional<ruleset_ref> second{owner->acquire()};
+    EXPECT_EQ(first->get(), second->get());
+
+    owner->retire();
+    EXPECT_FALSE(weak.expired());
+
+    first.reset();
+    EXPECT_FALSE(weak.expired());
+
+    // Moved references are only released once
+    ruleset_ref moved{std::move(*second)};
+    second.reset();
+    EXPECT_FALSE(weak.expired());
+    EXPECT_NE(moved.get(), nullptr);
+
+    {
+        auto released = std::move(moved);
+    }
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(TestRulesetRef, ConcurrentReleaseAndRetire)
+{
+    for (unsigned iteration = 0; iteration < 20; ++iteration) {
+        auto rs = std::make_shared<ruleset>();
+        std::weak_ptr<ruleset> weak = rs;
+        auto *owner = new ruleset_owner(std::move(rs));
+
+        std::vector<std::vector<ruleset_ref>> references(4);
+        for (auto &refs : references) {
+            for (unsigned i = 0; i < 100; ++i) { refs.emplace_back(owner->acquire()); }
+        }
+
+        std::vector<std::thread> threads;
+        for (auto &refs : references) {
+            threads.emplace_back([&refs]() { refs.clear(); });
+        }
+        owner->retire();
+
+        for (auto &thread : threads) { thread.join(); }
+        EXPECT_TRUE(weak.expired());
+    }
+}
+
+TEST(TestRulesetRef, ContextOutlivesHandle)
+{
+    auto rule = readFile("interface.yaml");
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context first = ddwaf_context_init(handle);
+    ddwaf_context second = ddwaf_context_init(handle);
+    ddwaf_destroy(handle);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, "rule1"));
+    EXPECT_EQ(ddwaf_run(first, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+    ddwaf_context_destroy(first);
+    ddwaf_context_destroy(second);
+}
+
+TEST(TestRulesetRef, ConcurrentContextDestroyAndDestroy)
+{
+    auto rule = readFile("interface.yaml");
+
+    for (unsigned iteration = 0; iteration < 20; ++iteration) {
+        ddwaf_handle handle = ddwaf_init(&rule, nullptr, nullptr);
+        ASSERT_NE(handle, nullptr);
+
+        // Contexts are created on each thread so that they are spread across
+        // shards, then destroyed while the handle is being destroyed.
+        std::atomic<unsigned> ready{0};
+        std::atomic<bool> start{false};
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < 4; ++i) {
+            threads.emplace_back([&]() {
+                std::vector<ddwaf_context> contexts;
+                for (unsigned j = 0; j < 100; ++j) {
+                    contexts.push_back(ddwaf_context_init(handle));
+                }
+
+                ready.fetch_add(1);
+                while (!start.load()) {}
+
+                for (auto *ctx : contexts) { ddwaf_context_destroy(ctx); }
+            });
+        }
+
+        while (ready.load() < threads.size()) {}
+        start.store(true);
+        ddwaf_destroy(handle);
+
+        for (auto &thread : threads) { thread.join(); }
+    }
+
+    ddwaf_object_free(&rule);
+}
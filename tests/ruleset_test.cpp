@@ -57,3 +57,28 @@ TEST(TestRuleset, InsertContainer)
     EXPECT_EQ(ruleset.rules.size(), 6);
     EXPECT_EQ(ruleset.collections.size(), 3);
 }
+
+TEST(TestRuleset, ScheduleCollections)
+{
+    ddwaf::ruleset ruleset;
+    auto rules = test_rules();
+    for (const auto &rule : rules) { ruleset.insert_rule(rule); }
+
+    EXPECT_EQ(ruleset.schedule.size(), 3);
+    EXPECT_TRUE(ruleset.priority_schedule.empty());
+
+    // Collections are evaluated by increasing cost
+    rule_cost_map costs;
+    for (std::size_t i = 0; i < rules.size(); ++i) { costs.emplace(rules[i].get(), 10 - i); }
+    ruleset.order_rules(costs);
+
+    ASSERT_EQ(ruleset.schedule.size(), 3);
+    EXPECT_EQ(ruleset.schedule[0].first, "type0");
+    EXPECT_EQ(ruleset.schedule[1].first, "type1");
+    EXPECT_EQ(ruleset.schedule[2].first, "type2");
+    EXPECT_EQ(ruleset.schedule[0].second, &ruleset.collections["type0"]);
+
+    costs[rules[0].get()] = 100;
+    ruleset.order_rules(costs);
+    EXPECT_EQ(ruleset.schedule[2].first, "type0");
+}
@@ -0,0 +1,169 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <snapshot.hpp>
+
+namespace {
+
+bool same_object(const ddwaf_object &lhs, const ddwaf_object &rhs)
+{
+    if (lhs.type != rhs.type || lhs.nbEntries != rhs.nbEntries ||
+        (lhs.parameterName == nullptr) != (rhs.parameterName == nullptr)) {
+        return false;
+    }
+
+    if (lhs.parameterName != nullptr &&
+        std::string_view(lhs.parameterName, lhs.parameterNameLength) !=
+            std::string_view(rhs.parameterName, rhs.parameterNameLength)) {
+        return false;
+    }
+
+    switch (lhs.type) {
+    case DDWAF_OBJ_STRING:
+        return std::string_view(lhs.stringValue, lhs.nbEntries) ==
+               std::string_view(rhs.stringValue, rhs.nbEntries);
+    case DDWAF_OBJ_SIGNED:
+        return lhs.intValue == rhs.intValue;
+    case DDWAF_OBJ_UNSIGNED:
+        return lhs.uintValue == rhs.uintValue;
+    case DDWAF_OBJ_BOOL:
+        return lhs.boolean == rhs.boolean;
+    case DDWAF_OBJ_ARRAY:
+    case DDWAF_OBJ_MAP:
+        for (std::size_t i = 0; i < lhs.nbEntries; ++i) {
+            if (!same_object(lhs.array[i], rhs.array[i])) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+std::vector<char> serialize(const ddwaf_object &object)
+{
+    auto size = ddwaf_ruleset_serialize(&object, nullptr, 0);
+    std::vector<char> buffer(size);
+    EXPECT_EQ(ddwaf_ruleset_serialize(&object, buffer.data(), buffer.size()), size);
+    return buffer;
+}
+
+} // namespace
+
+TEST(TestSnapshot, Roundtrip)
+{
+    auto object = readRule(
+        R"({version: '2.1', rules: [{id: 1, enabled: false, tags: {type: flow1}, conditions: []}], signed: -5, unsigned: 5, empty: [], nested: {a: [b, {c: ""}]}})");
+    ddwaf_object tmp;
+    ddwaf_object_map_add(&object, "bool", ddwaf_object_bool(&tmp, true));
+    ddwaf_object_map_add(&object, "signed_int", ddwaf_object_signed_force(&tmp, -42));
+    ddwaf_object_map_add(&object, "unsigned_int", ddwaf_object_unsigned_force(&tmp, 42));
+
+    auto buffer = serialize(object);
+    ASSERT_TRUE(snapshot::is_snapshot(buffer.data(), buffer.size()));
+
+    auto view = snapshot::load(buffer.data(), buffer.size());
+    EXPECT_TRUE(same_object(object, view.root()));
+
+    ddwaf_object_free(&object);
+}
+
+TEST(TestSnapshot, BufferTooSmall)
+{
+    auto object = readRule(R"({rules: [{id: 1}]})");
+
+    auto size = ddwaf_ruleset_serialize(&object, nullptr, 0);
+    EXPECT_GT(size, 0);
+
+    std::vector<char> buffer(size - 1, 0);
+    EXPECT_EQ(ddwaf_ruleset_serialize(&object, buffer.data(), buffer.size()), size);
+    EXPECT_FALSE(snapshot::is_snapshot(buffer.data(), buffer.size()));
+
+    ddwaf_object_free(&object);
+}
+
+TEST(TestSnapshot, InvalidRuleset)
+{
+    EXPECT_EQ(ddwaf_ruleset_serialize(nullptr, nullptr, 0), 0);
+
+    ddwaf_object object;
+    ddwaf_object_array(&object);
+    EXPECT_EQ(ddwaf_ruleset_serialize(&object, nullptr, 0), 0);
+    ddwaf_object_free(&object);
+}
+
+TEST(TestSnapshot, InvalidSnapshot)
+{
+    auto object = readRule(R"({rules: [{id: 1, name: rule1}]})");
+    auto buffer = serialize(object);
+    ddwaf_object_free(&object);
+
+    // Truncated
+    EXPECT_THROW(snapshot::load(buffer.data(), buffer.size() - 1), parsing_error);
+    EXPECT_THROW(snapshot::load(buffer.data(), 8), parsing_error);
+
+    // Invalid magic
+    {
+        auto copy = buffer;
+        copy[0] = 'X';
+        EXPECT_THROW(snapshot::load(copy.data(), copy.size()), parsing_error);
+    }
+
+    // Unsupported version
+    {
+        auto copy = buffer;
+        uint32_t version = snapshot::version + 1;
+        memcpy(&copy[sizeof(snapshot::magic)], &version, sizeof(version));
+        EXPECT_THROW(snapshot::load(copy.data(), copy.size()), parsing_error);
+    }
+
+    // Missing string terminator
+    {
+        auto copy = buffer;
+        copy.back() = 'X';
+        EXPECT_THROW(snapshot::load(copy.data(), copy.size()), parsing_error);
+    }
+
+    EXPECT_EQ(ddwaf_init_from_snapshot(buffer.data(), buffer.size() - 1, nullptr, nullptr),
+        nullptr);
+    EXPECT_EQ(ddwaf_init_from_snapshot(nullptr, 0, nullptr, nullptr), nullptr);
+}
+
+TEST(TestSnapshot, InitFromSnapshot)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    auto buffer = serialize(rule);
+    ddwaf_object_free(&rule);
+
+    ddwaf_ruleset_info info;
+    ddwaf_handle handle =
+        ddwaf_init_from_snapshot(buffer.data(), buffer.size(), nullptr, &info);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ(info.loaded, 3);
+    EXPECT_EQ(info.failed, 0);
+    ddwaf_ruleset_info_free(&info);
+
+    // The snapshot is no longer required
+    std::vector<char>().swap(buffer);
+
+    ddwaf_context context = ddwaf_context_init(handle);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object root;
+    ddwaf_object tmp;
+    ddwaf_object_map(&root);
+    ddwaf_object_map_add(&root, "value1", ddwaf_object_string(&tmp, "rule1"));
+
+    EXPECT_EQ(ddwaf_run(context, &root, nullptr, LONG_TIME), DDWAF_MATCH);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
@@ -0,0 +1,83 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <thread_pool.hpp>
+
+TEST(TestThreadPool, PushTasks)
+{
+    std::atomic<unsigned> counter{0};
+    {
+        thread_pool pool(4);
+        EXPECT_EQ(pool.size(), 4);
+
+        for (unsigned i = 0; i < 100; ++i) {
+            pool.push([&counter]() { counter++; });
+        }
+    }
+
+    // The destructor waits for all pending tasks
+    EXPECT_EQ(counter, 100);
+}
+
+TEST(TestThreadPool, ParallelFor)
+{
+    thread_pool pool(3);
+
+    std::vector<unsigned> values(1000, 0);
+    pool.parallel_for(values.size(), [&values](std::size_t i) { values[i] = i * 2; });
+
+    for (std::size_t i = 0; i < values.size(); ++i) { EXPECT_EQ(values[i], i * 2); }
+}
+
+TEST(TestThreadPool, ParallelForNoWorkers)
+{
+    thread_pool pool(0);
+
+    std::vector<unsigned> values(10, 0);
+    pool.parallel_for(values.size(), [&values](std::size_t i) { values[i] = i + 1; });
+
+    for (std::size_t i = 0; i < values.size(); ++i) { EXPECT_EQ(values[i], i + 1); }
+}
+
+TEST(TestThreadPool, ParallelForEmpty)
+{
+    thread_pool pool(2);
+
+    bool called = false;
+    pool.parallel_for(0, [&called](std::size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+TEST(TestThreadPool, ParallelForException)
+{
+    thread_pool pool(2);
+
+    std::atomic<unsigned> counter{0};
+    EXPECT_THROW(pool.parallel_for(100,
+                     [&counter](std::size_t i) {
+                         counter++;
+                         if (i == 50) {
+                             throw std::runtime_error("failure");
+                         }
+                     }),
+        std::runtime_error);
+
+    // All other indices are still processed
+    EXPECT_EQ(counter, 100);
+}
+
+TEST(TestThreadPool, NestedParallelFor)
+{
+    thread_pool pool(2);
+
+    std::atomic<unsigned> counter{0};
+    pool.parallel_for(4, [&](std::size_t) {
+        pool.parallel_for(10, [&counter](std::size_t) { counter++; });
+    });
+
+    EXPECT_EQ(counter, 40);
+}